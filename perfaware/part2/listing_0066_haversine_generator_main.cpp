@@ -31,6 +31,7 @@
 
 typedef uint32_t u32;
 typedef uint64_t u64;
+typedef int32_t b32;
 typedef double f64;
 #define U64Max UINT64_MAX
 
@@ -109,6 +110,112 @@ static FILE *Open(long long unsigned PairCount, char const *Label, char const *E
     return Result;
 }
 
+/* NOTE: Optional binary output, so that the haversine programs can skip JSON parsing when the
+   input doesn't change. After a 64-byte header, the four coordinates are stored as separate
+   f64 columns (X0s, then Y0s, X1s, Y1s), each starting on a 64-byte boundary. A reader can map
+   the file and use the columns in place. This header has to stay in sync with the reader in
+   part3 (listing_0136_haversine_pair_file.cpp). */
+
+#define HAVERSINE_PAIR_FILE_MAGIC 0x52505648 // NOTE: "HVPR" in little-endian
+#define HAVERSINE_PAIR_FILE_VERSION 1
+#define HAVERSINE_PAIR_LAYOUT_F64_COLUMNS 1
+#define HAVERSINE_PAIR_COLUMN_ALIGNMENT 64
+
+struct haversine_pair_file_header
+{
+    u32 Magic;
+    u32 Version;
+    u64 PairCount;
+    u32 Layout;
+    u32 ColumnCount;
+    u64 ColumnOffset[4]; // NOTE: Byte offsets from the start of the file, X0/Y0/X1/Y1
+    u64 Reserved;
+};
+
+#define PAIR_COLUMN_BLOCK_COUNT 4096
+
+struct pair_column_writer
+{
+    FILE *File;
+    haversine_pair_file_header Header;
+    u64 Written;
+    u32 BlockCount;
+    f64 Block[4][PAIR_COLUMN_BLOCK_COUNT];
+};
+
+static u64 AlignColumn(u64 Offset)
+{
+    u64 Result = (Offset + HAVERSINE_PAIR_COLUMN_ALIGNMENT - 1) & ~(u64)(HAVERSINE_PAIR_COLUMN_ALIGNMENT - 1);
+    return Result;
+}
+
+static void SeekTo(FILE *File, u64 Offset)
+{
+    // NOTE: Plain fseek takes a long, which is only 32 bits on Windows
+#if _WIN32
+    _fseeki64(File, Offset, SEEK_SET);
+#else
+    fseeko(File, Offset, SEEK_SET);
+#endif
+}
+
+static void BeginPairColumns(pair_column_writer *Writer, FILE *File, u64 PairCount)
+{
+    Writer->File = File;
+    Writer->Written = 0;
+    Writer->BlockCount = 0;
+    
+    haversine_pair_file_header *Header = &Writer->Header;
+    *Header = {};
+    Header->Magic = HAVERSINE_PAIR_FILE_MAGIC;
+    Header->Version = HAVERSINE_PAIR_FILE_VERSION;
+    Header->PairCount = PairCount;
+    Header->Layout = HAVERSINE_PAIR_LAYOUT_F64_COLUMNS;
+    Header->ColumnCount = 4;
+    
+    u64 Offset = AlignColumn(sizeof(haversine_pair_file_header));
+    for(u32 Column = 0; Column < 4; ++Column)
+    {
+        Header->ColumnOffset[Column] = Offset;
+        Offset = AlignColumn(Offset + PairCount*sizeof(f64));
+    }
+    
+    // NOTE: Writing the header at the start and a zero at the very end sizes the file up front,
+    // including the padding between columns, so the column blocks can be written in any order
+    fwrite(Header, sizeof(*Header), 1, File);
+    SeekTo(File, Offset - 1);
+    fputc(0, File);
+}
+
+static void FlushPairColumns(pair_column_writer *Writer)
+{
+    if(Writer->BlockCount)
+    {
+        for(u32 Column = 0; Column < 4; ++Column)
+        {
+            SeekTo(Writer->File, Writer->Header.ColumnOffset[Column] + Writer->Written*sizeof(f64));
+            fwrite(Writer->Block[Column], sizeof(f64), Writer->BlockCount, Writer->File);
+        }
+        
+        Writer->Written += Writer->BlockCount;
+        Writer->BlockCount = 0;
+    }
+}
+
+static void WritePairColumns(pair_column_writer *Writer, f64 X0, f64 Y0, f64 X1, f64 Y1)
+{
+    u32 Index = Writer->BlockCount++;
+    Writer->Block[0][Index] = X0;
+    Writer->Block[1][Index] = Y0;
+    Writer->Block[2][Index] = X1;
+    Writer->Block[3][Index] = Y1;
+    
+    if(Writer->BlockCount == PAIR_COLUMN_BLOCK_COUNT)
+    {
+        FlushPairColumns(Writer);
+    }
+}
+
 static f64 RandomDegree(random_series *Series, f64 Center, f64 Radius, f64 MaxAllowed)
 {
     f64 MinVal = Center - Radius;
@@ -129,7 +236,8 @@ static f64 RandomDegree(random_series *Series, f64 Center, f64 Radius, f64 MaxAl
 
 int main(int ArgCount, char **Args)
 {
-    if(ArgCount == 4)
+    b32 WriteBinary = ((ArgCount == 5) && (strcmp(Args[4], "binary") == 0));
+    if((ArgCount == 4) || WriteBinary)
     {
         u64 ClusterCountLeft = U64Max;
         f64 MaxAllowedX = 180;
@@ -162,7 +270,23 @@ int main(int ArgCount, char **Args)
             
             FILE *FlexJSON = Open(PairCount, "flex", "json");
             FILE *HaverAnswers = Open(PairCount, "haveranswer", "f64");
-            if(FlexJSON && HaverAnswers)
+            FILE *PairColumns = WriteBinary ? Open(PairCount, "flex", "hvpairs") : 0;
+            
+            pair_column_writer *ColumnWriter = 0;
+            if(PairColumns)
+            {
+                ColumnWriter = (pair_column_writer *)malloc(sizeof(pair_column_writer));
+                if(ColumnWriter)
+                {
+                    BeginPairColumns(ColumnWriter, PairColumns, PairCount);
+                }
+                else
+                {
+                    fprintf(stderr, "Unable to allocate memory for writing the binary pairs.\n");
+                }
+            }
+            
+            if(FlexJSON && HaverAnswers && (ColumnWriter || !WriteBinary))
             {
                 fprintf(FlexJSON, "{\"pairs\":[\n");
                 f64 Sum = 0;
@@ -192,10 +316,21 @@ int main(int ArgCount, char **Args)
                     fprintf(FlexJSON, "    {\"x0\":%.16f, \"y0\":%.16f, \"x1\":%.16f, \"y1\":%.16f}%s", X0, Y0, X1, Y1, JSONSep);
                     
                     fwrite(&HaversineDistance, sizeof(HaversineDistance), 1, HaverAnswers);
+                    
+                    if(ColumnWriter)
+                    {
+                        WritePairColumns(ColumnWriter, X0, Y0, X1, Y1);
+                    }
+                }
+                
+                if(ColumnWriter)
+                {
+                    FlushPairColumns(ColumnWriter);
                 }
+                
                 fprintf(FlexJSON, "]}\n");
                 fwrite(&Sum, sizeof(Sum), 1, HaverAnswers);
-        
+                
                 fprintf(stdout, "Method: %s\n", MethodName);
                 fprintf(stdout, "Random seed: %llu\n", SeedValue);
                 fprintf(stdout, "Pair count: %llu\n", PairCount);
@@ -204,6 +339,8 @@ int main(int ArgCount, char **Args)
             
             if(FlexJSON) fclose(FlexJSON);
             if(HaverAnswers) fclose(HaverAnswers);
+            if(PairColumns) fclose(PairColumns);
+            free(ColumnWriter);
         }
         else
         {
@@ -212,9 +349,9 @@ int main(int ArgCount, char **Args)
     }
     else
     {
-        fprintf(stderr, "Usage: %s [uniform/cluster] [random seed] [number of coordinate pairs to generate]\n", Args[0]);
+        fprintf(stderr, "Usage: %s [uniform/cluster] [random seed] [number of coordinate pairs to generate] [binary]\n", Args[0]);
     }
     
     return 0;
 }
-    
\ No newline at end of file
+
@@ -429,53 +429,58 @@ static f64 ConvertJSONNumber(buffer Source, u64 *AtResult)
     return Result;
 }
 
-static f64 ConvertElementToF64(json_element *Object, buffer ElementName)
+static f64 ConvertJSONValueToF64(buffer Source)
 {
-    f64 Result = 0.0;
+    u64 At = 0;
     
-    json_element *Element = LookupElement(Object, ElementName);
-    if(Element)
+    f64 Sign = ConvertJSONSign(Source, &At);
+    f64 Number = ConvertJSONNumber(Source, &At);
+    
+    if(IsInBounds(Source, At) && (Source.Data[At] == '.'))
     {
-        buffer Source = Element->Value;
-        u64 At = 0;
-        
-        f64 Sign = ConvertJSONSign(Source, &At);
-        f64 Number = ConvertJSONNumber(Source, &At);
-        
-        if(IsInBounds(Source, At) && (Source.Data[At] == '.'))
+        ++At;
+        f64 C = 1.0 / 10.0;
+        while(IsInBounds(Source, At))
         {
-            ++At;
-            f64 C = 1.0 / 10.0;
-            while(IsInBounds(Source, At))
+            u8 Char = Source.Data[At] - (u8)'0';
+            if(Char < 10)
             {
-                u8 Char = Source.Data[At] - (u8)'0';
-                if(Char < 10)
-                {
-                    Number = Number + C*(f64)Char;
-                    C *= 1.0 / 10.0;
-                    ++At;
-                }
-                else
-                {
-                    break;
-                }
+                Number = Number + C*(f64)Char;
+                C *= 1.0 / 10.0;
+                ++At;
+            }
+            else
+            {
+                break;
             }
         }
-        
-        if(IsInBounds(Source, At) && ((Source.Data[At] == 'e') || (Source.Data[At] == 'E')))
+    }
+    
+    if(IsInBounds(Source, At) && ((Source.Data[At] == 'e') || (Source.Data[At] == 'E')))
+    {
+        ++At;
+        if(IsInBounds(Source, At) && (Source.Data[At] == '+'))
         {
             ++At;
-            if(IsInBounds(Source, At) && (Source.Data[At] == '+'))
-            {
-                ++At;
-            }
-
-            f64 ExponentSign = ConvertJSONSign(Source, &At);
-            f64 Exponent = ExponentSign*ConvertJSONNumber(Source, &At);
-            Number *= pow(10.0, Exponent);
         }
-        
-        Result = Sign*Number;
+
+        f64 ExponentSign = ConvertJSONSign(Source, &At);
+        f64 Exponent = ExponentSign*ConvertJSONNumber(Source, &At);
+        Number *= pow(10.0, Exponent);
+    }
+    
+    f64 Result = Sign*Number;
+    return Result;
+}
+
+static f64 ConvertElementToF64(json_element *Object, buffer ElementName)
+{
+    f64 Result = 0.0;
+    
+    json_element *Element = LookupElement(Object, ElementName);
+    if(Element)
+    {
+        Result = ConvertJSONValueToF64(Element->Value);
     }
     
     return Result;
@@ -88,10 +88,9 @@ static u64 ReadOSPageFaultCount(void)
     //       ru_majflt  the number of page faults serviced that required I/O activity.
     struct rusage Usage = {};
     getrusage(RUSAGE_SELF, &Usage);
-    int Result = Usage.ru_minflt + Usage.ru_majflt;
+    u64 Result = Usage.ru_minflt + Usage.ru_majflt;
     return Result;
 }
-}
 
 static void InitializeOSMetrics(void)
 {
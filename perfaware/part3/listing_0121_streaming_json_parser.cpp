@@ -0,0 +1,246 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 121
+   ======================================================================== */
+
+/* NOTE: This is a pull parser layered on the tokenizer from listing 94. Instead of building
+   a json_element tree and then looking values up in it, the caller asks for the next token,
+   key or number and decides what to do with it on the spot. Nothing is allocated, so parsing
+   needs no memory beyond the input and the output, regardless of input size. */
+
+static json_token NextJSONToken(json_parser *Parser)
+{
+    json_token Result = GetJSONToken(Parser);
+    return Result;
+}
+
+static b32 ExpectJSONToken(json_parser *Parser, json_token_type Type)
+{
+    json_token Token = NextJSONToken(Parser);
+    b32 Result = (Token.Type == Type);
+    if(!Result)
+    {
+        Error(Parser, Token, "Unexpected token in JSON");
+    }
+    
+    return Result;
+}
+
+static b32 NextJSONKey(json_parser *Parser, buffer *Key, json_token_type EndType)
+{
+    // NOTE: Reads the `"name":` that starts a field. Returns false at EndType (or on an error),
+    // which ends the object.
+    b32 Result = false;
+    
+    json_token Token = NextJSONToken(Parser);
+    if(Token.Type == Token_string_literal)
+    {
+        *Key = Token.Value;
+        Result = ExpectJSONToken(Parser, Token_colon);
+    }
+    else if(Token.Type != EndType)
+    {
+        Error(Parser, Token, "Expected field name");
+    }
+    
+    return Result;
+}
+
+static b32 NextJSONListSeparator(json_parser *Parser, json_token_type EndType)
+{
+    // NOTE: Reads what comes after a value in a list. Returns true if another value follows.
+    b32 Result = false;
+    
+    json_token Token = NextJSONToken(Parser);
+    if(Token.Type == Token_comma)
+    {
+        Result = IsParsing(Parser);
+    }
+    else if(Token.Type != EndType)
+    {
+        Error(Parser, Token, "Unexpected token in JSON");
+    }
+    
+    return Result;
+}
+
+static void SkipJSONValue(json_parser *Parser, json_token First)
+{
+    // NOTE: Objects and arrays are skipped by counting nesting depth, so that skipping
+    // doesn't need a stack. The tokenizer has already dealt with brackets inside strings.
+    if((First.Type == Token_open_brace) || (First.Type == Token_open_bracket))
+    {
+        u64 Depth = 1;
+        while(Depth && IsParsing(Parser))
+        {
+            json_token Token = NextJSONToken(Parser);
+            if((Token.Type == Token_open_brace) || (Token.Type == Token_open_bracket))
+            {
+                ++Depth;
+            }
+            else if((Token.Type == Token_close_brace) || (Token.Type == Token_close_bracket))
+            {
+                --Depth;
+            }
+            else if(Token.Type == Token_error)
+            {
+                Error(Parser, Token, "Unexpected token in JSON");
+            }
+        }
+    }
+    else if(First.Type == Token_error)
+    {
+        Error(Parser, First, "Unexpected token in JSON");
+    }
+}
+
+static b32 NextJSONNumber(json_parser *Parser, f64 *Value)
+{
+    // NOTE: Like LookupElement + ConvertElementToF64, any scalar value converts (non-numbers
+    // convert to 0), and only objects and arrays are rejected (and skipped).
+    json_token Token = NextJSONToken(Parser);
+    
+    b32 Result = ((Token.Type == Token_number) ||
+                  (Token.Type == Token_string_literal) ||
+                  (Token.Type == Token_true) ||
+                  (Token.Type == Token_false) ||
+                  (Token.Type == Token_null));
+    if(Result)
+    {
+        // NOTE: The same conversion ConvertElementToF64 does, so results are bit-identical to the tree parser
+        *Value = ConvertJSONValueToF64(Token.Value);
+    }
+    else
+    {
+        SkipJSONValue(Parser, Token);
+    }
+    
+    return Result;
+}
+
+static void ParseHaversinePairStreaming(json_parser *Parser, haversine_pair *Pair)
+{
+    // NOTE: Fields that are missing come out as 0, and if a field appears more than
+    // once, the first one wins. That is what LookupElement does on the tree.
+    buffer FieldNames[] =
+    {
+        CONSTANT_STRING("x0"),
+        CONSTANT_STRING("y0"),
+        CONSTANT_STRING("x1"),
+        CONSTANT_STRING("y1"),
+    };
+    f64 *Fields[] = {&Pair->X0, &Pair->Y0, &Pair->X1, &Pair->Y1};
+    u32 FoundMask = 0;
+    
+    *Pair = {};
+    
+    buffer Key = {};
+    while(NextJSONKey(Parser, &Key, Token_close_brace))
+    {
+        u32 FieldIndex = 0;
+        while((FieldIndex < ArrayCount(FieldNames)) && !AreEqual(Key, FieldNames[FieldIndex]))
+        {
+            ++FieldIndex;
+        }
+        
+        if((FieldIndex < ArrayCount(FieldNames)) && !(FoundMask & (1 << FieldIndex)))
+        {
+            f64 Value = 0.0;
+            if(NextJSONNumber(Parser, &Value))
+            {
+                *Fields[FieldIndex] = Value;
+            }
+            FoundMask |= (1 << FieldIndex);
+        }
+        else
+        {
+            SkipJSONValue(Parser, NextJSONToken(Parser));
+        }
+        
+        if(!NextJSONListSeparator(Parser, Token_close_brace))
+        {
+            break;
+        }
+    }
+}
+
+static u64 ParseHaversinePairsStreaming(buffer InputJSON, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    TimeFunction;
+    
+    u64 PairCount = 0;
+    
+    json_parser Parser = {};
+    Parser.Source = InputJSON;
+    
+    b32 FoundPairs = false;
+    if(ExpectJSONToken(&Parser, Token_open_brace))
+    {
+        buffer Key = {};
+        while(NextJSONKey(&Parser, &Key, Token_close_brace))
+        {
+            json_token Value = NextJSONToken(&Parser);
+            if(!FoundPairs && AreEqual(Key, CONSTANT_STRING("pairs")))
+            {
+                FoundPairs = true;
+                if(Value.Type == Token_open_bracket)
+                {
+                    for(;;)
+                    {
+                        json_token Element = NextJSONToken(&Parser);
+                        if((Element.Type == Token_close_bracket) || !IsParsing(&Parser))
+                        {
+                            break;
+                        }
+                        
+                        haversine_pair Pair = {};
+                        if(Element.Type == Token_open_brace)
+                        {
+                            ParseHaversinePairStreaming(&Parser, &Pair);
+                        }
+                        else
+                        {
+                            SkipJSONValue(&Parser, Element);
+                        }
+                        
+                        if(PairCount < MaxPairCount)
+                        {
+                            Pairs[PairCount++] = Pair;
+                        }
+                        
+                        if(!NextJSONListSeparator(&Parser, Token_close_bracket))
+                        {
+                            break;
+                        }
+                    }
+                }
+                else
+                {
+                    SkipJSONValue(&Parser, Value);
+                }
+            }
+            else
+            {
+                SkipJSONValue(&Parser, Value);
+            }
+            
+            if(!NextJSONListSeparator(&Parser, Token_close_brace))
+            {
+                break;
+            }
+        }
+    }
+    
+    return PairCount;
+}
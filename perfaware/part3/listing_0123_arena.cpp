@@ -0,0 +1,255 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 123
+   ======================================================================== */
+
+/* NOTE: A linear arena. Allocation bumps a pointer in the current block, and a new block
+   (at least double the size of the last) is taken from the OS when it runs out. Nothing is
+   freed individually. Instead, ResetArena throws everything away at once, and keeps the
+   memory so that the next round of allocations doesn't have to go back to the OS. */
+
+#if _WIN32
+
+#include <windows.h>
+#pragma comment (lib, "advapi32.lib")
+
+static b32 TryToEnableLargePages(void)
+{
+    // NOTE: Windows only hands out large pages to processes holding SeLockMemoryPrivilege,
+    // which has to be granted to the user account in the local security policy first.
+    b32 Result = false;
+    
+    HANDLE TokenHandle;
+    if(OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES|TOKEN_QUERY, &TokenHandle))
+    {
+        TOKEN_PRIVILEGES Privs = {};
+        Privs.PrivilegeCount = 1;
+        Privs.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if(LookupPrivilegeValue(0, SE_LOCK_MEMORY_NAME, &Privs.Privileges[0].Luid))
+        {
+            AdjustTokenPrivileges(TokenHandle, FALSE, &Privs, 0, 0, 0);
+            Result = (GetLastError() == ERROR_SUCCESS);
+        }
+        
+        CloseHandle(TokenHandle);
+    }
+    
+    return Result;
+}
+
+static u64 GetLargePageSize(void)
+{
+    u64 Result = GetLargePageMinimum();
+    return Result;
+}
+
+static u8 *OSAllocate(u64 Size, b32 LargePages)
+{
+    u8 *Result = 0;
+    if(LargePages)
+    {
+        Result = (u8 *)VirtualAlloc(0, Size, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+    }
+    
+    if(!Result)
+    {
+        Result = (u8 *)VirtualAlloc(0, Size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    }
+    
+    return Result;
+}
+
+static void OSFree(u8 *Memory, u64 Size)
+{
+    (void)Size;
+    VirtualFree(Memory, 0, MEM_RELEASE);
+}
+
+#else
+
+#include <sys/mman.h>
+
+static b32 TryToEnableLargePages(void)
+{
+    // NOTE: Nothing needs enabling on Linux. Explicit huge pages come from the pool reserved in
+    // /proc/sys/vm/nr_hugepages, and OSAllocate falls back to asking for transparent huge pages.
+    return true;
+}
+
+static u64 GetLargePageSize(void)
+{
+    return 2*1024*1024;
+}
+
+static u8 *OSAllocate(u64 Size, b32 LargePages)
+{
+    u8 *Result = 0;
+    if(LargePages)
+    {
+        void *Memory = mmap(0, Size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if(Memory != MAP_FAILED)
+        {
+            Result = (u8 *)Memory;
+        }
+    }
+    
+    if(!Result)
+    {
+        void *Memory = mmap(0, Size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if(Memory != MAP_FAILED)
+        {
+            Result = (u8 *)Memory;
+            if(LargePages)
+            {
+                madvise(Result, Size, MADV_HUGEPAGE);
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static void OSFree(u8 *Memory, u64 Size)
+{
+    munmap(Memory, Size);
+}
+
+#endif
+
+struct arena_block
+{
+    arena_block *Prev;
+    u64 Size;
+    u64 Used;
+};
+
+struct arena
+{
+    arena_block *Current;
+    u64 MinimumBlockSize;
+    b32 LargePages;
+    
+    // NOTE: Statistics, so tests can report how much memory the allocations cost
+    u64 BlockCount;
+    u64 TotalBlockSize;
+    u64 TotalUsed;
+};
+
+static u64 const DEFAULT_ARENA_BLOCK_SIZE = 1024*1024;
+
+static u64 AlignPow2(u64 Value, u64 Alignment)
+{
+    u64 Result = (Value + (Alignment - 1)) & ~(Alignment - 1);
+    return Result;
+}
+
+static arena_block *AllocateArenaBlock(arena *Arena, u64 Size)
+{
+    u64 Granularity = Arena->LargePages ? GetLargePageSize() : 4096;
+    if(!Granularity)
+    {
+        Granularity = 4096;
+    }
+    
+    Size = AlignPow2(Size, Granularity);
+    
+    arena_block *Result = (arena_block *)OSAllocate(Size, Arena->LargePages);
+    if(Result)
+    {
+        Result->Prev = Arena->Current;
+        Result->Size = Size;
+        Result->Used = sizeof(arena_block);
+        
+        Arena->Current = Result;
+        ++Arena->BlockCount;
+        Arena->TotalBlockSize += Size;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %llu bytes for arena.\n", Size);
+    }
+    
+    return Result;
+}
+
+static void *PushSize(arena *Arena, u64 Size, u64 Alignment = 16)
+{
+    void *Result = 0;
+    
+    arena_block *Block = Arena->Current;
+    u64 Offset = Block ? AlignPow2(Block->Used, Alignment) : 0;
+    if(!Block || ((Offset + Size) > Block->Size))
+    {
+        u64 BlockSize = Arena->MinimumBlockSize ? Arena->MinimumBlockSize : DEFAULT_ARENA_BLOCK_SIZE;
+        if(Block && (BlockSize < 2*Block->Size))
+        {
+            BlockSize = 2*Block->Size;
+        }
+        
+        u64 Needed = AlignPow2(sizeof(arena_block), Alignment) + Size;
+        if(BlockSize < Needed)
+        {
+            BlockSize = Needed;
+        }
+        
+        Block = AllocateArenaBlock(Arena, BlockSize);
+        Offset = Block ? AlignPow2(Block->Used, Alignment) : 0;
+    }
+    
+    if(Block)
+    {
+        Result = (u8 *)Block + Offset;
+        Arena->TotalUsed += (Offset + Size) - Block->Used;
+        Block->Used = Offset + Size;
+    }
+    
+    return Result;
+}
+
+#define PushStruct(Arena, type) (type *)PushSize(Arena, sizeof(type), alignof(type))
+#define PushArray(Arena, Count, type) (type *)PushSize(Arena, (Count)*sizeof(type), alignof(type))
+
+static void FreeArena(arena *Arena)
+{
+    while(Arena->Current)
+    {
+        arena_block *Block = Arena->Current;
+        Arena->Current = Block->Prev;
+        OSFree((u8 *)Block, Block->Size);
+    }
+    
+    Arena->BlockCount = 0;
+    Arena->TotalBlockSize = 0;
+    Arena->TotalUsed = 0;
+}
+
+static void ResetArena(arena *Arena)
+{
+    // NOTE: If the last round of allocations spilled into more than one block, they are
+    // replaced by a single block big enough for all of them. After one round, repeating
+    // the same work allocates nothing from the OS.
+    if(Arena->BlockCount > 1)
+    {
+        u64 TotalSize = Arena->TotalBlockSize;
+        FreeArena(Arena);
+        AllocateArenaBlock(Arena, TotalSize);
+    }
+    
+    if(Arena->Current)
+    {
+        Arena->Current->Used = sizeof(arena_block);
+    }
+    
+    Arena->TotalUsed = 0;
+}
@@ -0,0 +1,215 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 125
+   ======================================================================== */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0103_repetition_tester.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0124_arena_json_parser.cpp"
+
+struct parse_parameters
+{
+    buffer InputJSON;
+    u64 MaxPairCount;
+    haversine_pair *Pairs;
+    arena *ReusedArena;
+    b32 LargePages;
+};
+
+typedef void parse_test_func(repetition_tester *Tester, parse_parameters *Params);
+
+static void ParseWithMalloc(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        ParseHaversinePairs(Params->InputJSON, Params->MaxPairCount, Params->Pairs);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseWithFreshArena(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Arena.LargePages = Params->LargePages;
+        ParseHaversinePairs(Params->InputJSON, Params->MaxPairCount, Params->Pairs, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseWithReusedArena(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        ParseHaversinePairs(Params->InputJSON, Params->MaxPairCount, Params->Pairs, Params->ReusedArena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+struct test_function
+{
+    char const *Name;
+    parse_test_func *Func;
+};
+test_function TestFunctions[] =
+{
+    {"malloc + FreeJSON", ParseWithMalloc},
+    {"fresh arena", ParseWithFreshArena},
+    {"reused arena", ParseWithReusedArena},
+};
+
+static buffer ReadEntireFile(char *FileName)
+{
+    buffer Result = {};
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        Result = AllocateBuffer(Stat.st_size);
+        if(Result.Data)
+        {
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&BeginProfile;
+    (void)&EndAndPrintProfile;
+    
+    u64 CPUTimerFreq = EstimateCPUTimerFreq();
+    
+    b32 LargePages = ((ArgCount == 3) && (strcmp(Args[2], "-largepages") == 0));
+    if((ArgCount == 2) || LargePages)
+    {
+        if(LargePages && !TryToEnableLargePages())
+        {
+            fprintf(stderr, "WARNING: Unable to enable large pages, arenas will use regular pages.\n");
+        }
+        
+        parse_parameters Params = {};
+        Params.InputJSON = ReadEntireFile(Args[1]);
+        Params.LargePages = LargePages;
+        
+        u32 MinimumJSONPairEncoding = 6*4;
+        Params.MaxPairCount = Params.InputJSON.Count / MinimumJSONPairEncoding;
+        
+        buffer ParsedValues = AllocateBuffer(Params.MaxPairCount*sizeof(haversine_pair));
+        Params.Pairs = (haversine_pair *)ParsedValues.Data;
+        
+        arena ReusedArena = {};
+        ReusedArena.LargePages = LargePages;
+        Params.ReusedArena = &ReusedArena;
+        
+        if(Params.MaxPairCount && ParsedValues.Count)
+        {
+            repetition_tester Testers[ArrayCount(TestFunctions)] = {};
+            
+            for(;;)
+            {
+                for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+                {
+                    repetition_tester *Tester = Testers + FuncIndex;
+                    test_function TestFunc = TestFunctions[FuncIndex];
+                    
+                    printf("\n--- %s ---\n", TestFunc.Name);
+                    NewTestWave(Tester, Params.InputJSON.Count, CPUTimerFreq);
+                    TestFunc.Func(Tester, &Params);
+                }
+                
+                printf("\nReused arena: %llu block(s), %llu bytes\n", ReusedArena.BlockCount, ReusedArena.TotalBlockSize);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Malformed input JSON\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [haversine_input.json]\n", Args[0]);
+        fprintf(stderr, "       %s [haversine_input.json] -largepages\n", Args[0]);
+    }
+    
+    return 0;
+}
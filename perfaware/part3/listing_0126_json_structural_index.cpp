@@ -0,0 +1,323 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 126
+   ======================================================================== */
+
+/* NOTE: The first stage of a two-stage JSON tokenizer. Instead of looking at the input one
+   byte at a time, 64 bytes at a time are compared against the interesting characters with
+   SIMD, giving a bitmask per character class. Bit tricks on those masks then work out which
+   quotes are escaped, which bytes are inside strings, and where every token starts. The
+   result is a list of positions ("structurals") that the second stage walks instead of the
+   raw bytes:
+       
+       - every {}[],: that is not inside a string
+       - every unescaped quote (so each string contributes its opening AND closing quote)
+       - the first byte of every number/true/false/null
+   
+   Positions are produced a window at a time as the second stage asks for them, so the
+   memory used does not grow with the input. */
+
+#include <immintrin.h>
+
+#if _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#define STRUCTURAL_INDEX_WINDOW 4096
+
+struct json_block_masks
+{
+    u64 Backslash;
+    u64 Quote;
+    u64 Whitespace;
+    u64 Operator;
+};
+
+typedef json_block_masks classify_json_block_func(u8 *Block);
+
+struct json_structural_indexer
+{
+    buffer Source;
+    u64 BlockAt;
+    classify_json_block_func *Classify;
+    
+    // NOTE: State carried from one 64-byte block to the next
+    u64 PrevEndsOddBackslash;
+    u64 PrevInString;
+    u64 PrevScalar;
+    
+    u64 Count;
+    u64 Next;
+    u64 Positions[STRUCTURAL_INDEX_WINDOW + 64]; // NOTE: +64 so a whole block always fits
+};
+
+static u32 CountTrailingZeros(u64 Value)
+{
+#if _MSC_VER
+    unsigned long Result;
+    _BitScanForward64(&Result, Value);
+    return Result;
+#else
+    return __builtin_ctzll(Value);
+#endif
+}
+
+static void ReadCPUID(u32 Leaf, u32 SubLeaf, u32 *Regs)
+{
+#if _MSC_VER
+    __cpuidex((int *)Regs, Leaf, SubLeaf);
+#else
+    __cpuid_count(Leaf, SubLeaf, Regs[0], Regs[1], Regs[2], Regs[3]);
+#endif
+}
+
+static u64 ReadXCR0(void)
+{
+#if _MSC_VER
+    u64 Result = _xgetbv(0);
+#else
+    u32 Low, High;
+    __asm__ volatile("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+    u64 Result = ((u64)High << 32) | Low;
+#endif
+    return Result;
+}
+
+static b32 CPUHasAVX2(void)
+{
+    // NOTE: The AVX2 bit alone isn't enough. The OS (or VM) also has to have turned on saving
+    // the YMM registers, otherwise the first AVX2 instruction faults.
+    u32 Leaf0[4] = {};
+    u32 Leaf1[4] = {};
+    u32 Leaf7[4] = {};
+    ReadCPUID(0, 0, Leaf0);
+    if(Leaf0[0] >= 7)
+    {
+        ReadCPUID(1, 0, Leaf1);
+        ReadCPUID(7, 0, Leaf7);
+    }
+    
+    b32 HasOSXSAVE = (Leaf1[2] & (1 << 27)) != 0;
+    u64 XCR0 = HasOSXSAVE ? ReadXCR0() : 0;
+    
+    b32 Result = (HasOSXSAVE &&
+                  ((XCR0 & 0x6) == 0x6) &&  // NOTE: XMM and YMM state
+                  (Leaf1[2] & (1 << 28)) && // NOTE: AVX
+                  (Leaf7[1] & (1 << 5)));   // NOTE: AVX2
+    return Result;
+}
+
+static json_block_masks ClassifyJSONBlockSSE2(u8 *Block)
+{
+    json_block_masks Result = {};
+    
+    __m128i Backslash = _mm_set1_epi8('\\');
+    __m128i Quote = _mm_set1_epi8('"');
+    __m128i Space = _mm_set1_epi8(' ');
+    __m128i Tab = _mm_set1_epi8('\t');
+    __m128i LineFeed = _mm_set1_epi8('\n');
+    __m128i Return = _mm_set1_epi8('\r');
+    __m128i Comma = _mm_set1_epi8(',');
+    __m128i Colon = _mm_set1_epi8(':');
+    __m128i OpenBracket = _mm_set1_epi8('[');
+    __m128i CloseBracket = _mm_set1_epi8(']');
+    
+    // NOTE: { and } are [ and ] with bit 5 set, so or-ing in 0x20 catches all four brackets with two compares
+    __m128i Bit5 = _mm_set1_epi8(0x20);
+    
+    for(u32 Part = 0; Part < 4; ++Part)
+    {
+        __m128i Bytes = _mm_loadu_si128((__m128i *)(Block + 16*Part));
+        __m128i Lowered = _mm_or_si128(Bytes, Bit5);
+        
+        __m128i IsWhitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Bytes, Space), _mm_cmpeq_epi8(Bytes, Tab)),
+                                            _mm_or_si128(_mm_cmpeq_epi8(Bytes, LineFeed), _mm_cmpeq_epi8(Bytes, Return)));
+        __m128i IsOperator = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Bytes, Comma), _mm_cmpeq_epi8(Bytes, Colon)),
+                                          _mm_or_si128(_mm_cmpeq_epi8(Lowered, _mm_or_si128(OpenBracket, Bit5)),
+                                                       _mm_cmpeq_epi8(Lowered, _mm_or_si128(CloseBracket, Bit5))));
+        
+        u32 Shift = 16*Part;
+        Result.Backslash |= (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, Backslash)) << Shift;
+        Result.Quote |= (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, Quote)) << Shift;
+        Result.Whitespace |= (u64)(u16)_mm_movemask_epi8(IsWhitespace) << Shift;
+        Result.Operator |= (u64)(u16)_mm_movemask_epi8(IsOperator) << Shift;
+    }
+    
+    return Result;
+}
+
+#if !_MSC_VER
+__attribute__((target("avx2")))
+#endif
+static json_block_masks ClassifyJSONBlockAVX2(u8 *Block)
+{
+    json_block_masks Result = {};
+    
+    __m256i Backslash = _mm256_set1_epi8('\\');
+    __m256i Quote = _mm256_set1_epi8('"');
+    __m256i Space = _mm256_set1_epi8(' ');
+    __m256i Tab = _mm256_set1_epi8('\t');
+    __m256i LineFeed = _mm256_set1_epi8('\n');
+    __m256i Return = _mm256_set1_epi8('\r');
+    __m256i Comma = _mm256_set1_epi8(',');
+    __m256i Colon = _mm256_set1_epi8(':');
+    __m256i LowerOpen = _mm256_set1_epi8('{');
+    __m256i LowerClose = _mm256_set1_epi8('}');
+    __m256i Bit5 = _mm256_set1_epi8(0x20);
+    
+    for(u32 Part = 0; Part < 2; ++Part)
+    {
+        __m256i Bytes = _mm256_loadu_si256((__m256i *)(Block + 32*Part));
+        __m256i Lowered = _mm256_or_si256(Bytes, Bit5);
+        
+        __m256i IsWhitespace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Bytes, Space), _mm256_cmpeq_epi8(Bytes, Tab)),
+                                               _mm256_or_si256(_mm256_cmpeq_epi8(Bytes, LineFeed), _mm256_cmpeq_epi8(Bytes, Return)));
+        __m256i IsOperator = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Bytes, Comma), _mm256_cmpeq_epi8(Bytes, Colon)),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(Lowered, LowerOpen), _mm256_cmpeq_epi8(Lowered, LowerClose)));
+        
+        u32 Shift = 32*Part;
+        Result.Backslash |= (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Backslash)) << Shift;
+        Result.Quote |= (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Quote)) << Shift;
+        Result.Whitespace |= (u64)(u32)_mm256_movemask_epi8(IsWhitespace) << Shift;
+        Result.Operator |= (u64)(u32)_mm256_movemask_epi8(IsOperator) << Shift;
+    }
+    
+    return Result;
+}
+
+static u64 FindEscapedCharacters(u64 Backslash, u64 *PrevEndsOddBackslash)
+{
+    // NOTE: A character is escaped if it follows an odd-length run of backslashes. Adding each
+    // run's start bit to the run carries out of its end, and the parity of where the run started
+    // vs. where it ended says whether the run was odd. (This is the trick from simdjson.)
+    u64 EvenBits = 0x5555555555555555ull;
+    u64 OddBits = ~EvenBits;
+    
+    u64 StartEdges = Backslash & ~(Backslash << 1);
+    u64 EvenStartMask = EvenBits ^ *PrevEndsOddBackslash;
+    u64 EvenStarts = StartEdges & EvenStartMask;
+    u64 OddStarts = StartEdges & ~EvenStartMask;
+    
+    u64 EvenCarries = Backslash + EvenStarts;
+    u64 OddCarries = Backslash + OddStarts;
+    b32 EndsOdd = (OddCarries < Backslash);
+    OddCarries |= *PrevEndsOddBackslash;
+    *PrevEndsOddBackslash = EndsOdd ? 1 : 0;
+    
+    u64 EvenCarryEnds = EvenCarries & ~Backslash;
+    u64 OddCarryEnds = OddCarries & ~Backslash;
+    
+    u64 Result = (EvenCarryEnds & OddBits) | (OddCarryEnds & EvenBits);
+    return Result;
+}
+
+static u64 PrefixXOR(u64 Value)
+{
+    // NOTE: Each bit becomes the XOR of itself and every bit below it, so a mask of quotes
+    // turns into a mask of everything from an opening quote up to (not including) its closing quote
+    Value ^= Value << 1;
+    Value ^= Value << 2;
+    Value ^= Value << 4;
+    Value ^= Value << 8;
+    Value ^= Value << 16;
+    Value ^= Value << 32;
+    return Value;
+}
+
+static void IndexJSONBlock(json_structural_indexer *Indexer, u8 *Block, u64 BlockBase)
+{
+    json_block_masks Masks = Indexer->Classify(Block);
+    
+    u64 Escaped = FindEscapedCharacters(Masks.Backslash, &Indexer->PrevEndsOddBackslash);
+    u64 Quote = Masks.Quote & ~Escaped;
+    
+    u64 InString = PrefixXOR(Quote) ^ Indexer->PrevInString;
+    Indexer->PrevInString = (u64)((s64)InString >> 63);
+    
+    u64 Scalar = ~(Masks.Operator | Masks.Whitespace | Quote | InString);
+    u64 ScalarStart = Scalar & ~((Scalar << 1) | Indexer->PrevScalar);
+    Indexer->PrevScalar = Scalar >> 63;
+    
+    u64 Structurals = (Masks.Operator & ~InString) | Quote | ScalarStart;
+    while(Structurals)
+    {
+        Indexer->Positions[Indexer->Count++] = BlockBase + CountTrailingZeros(Structurals);
+        Structurals &= Structurals - 1;
+    }
+}
+
+static void RefillStructuralIndex(json_structural_indexer *Indexer)
+{
+    Indexer->Count = 0;
+    Indexer->Next = 0;
+    
+    buffer Source = Indexer->Source;
+    while((Indexer->Count < STRUCTURAL_INDEX_WINDOW) && (Indexer->BlockAt < Source.Count))
+    {
+        u64 Remaining = Source.Count - Indexer->BlockAt;
+        if(Remaining >= 64)
+        {
+            IndexJSONBlock(Indexer, Source.Data + Indexer->BlockAt, Indexer->BlockAt);
+        }
+        else
+        {
+            // NOTE: The last partial block is padded with whitespace, which never produces a structural
+            u8 Padded[64];
+            for(u32 Index = 0; Index < 64; ++Index)
+            {
+                Padded[Index] = (Index < Remaining) ? Source.Data[Indexer->BlockAt + Index] : ' ';
+            }
+            IndexJSONBlock(Indexer, Padded, Indexer->BlockAt);
+        }
+        
+        Indexer->BlockAt += 64;
+    }
+}
+
+static void BeginStructuralIndex(json_structural_indexer *Indexer, buffer Source)
+{
+    Indexer->Source = Source;
+    Indexer->BlockAt = 0;
+    Indexer->Classify = CPUHasAVX2() ? ClassifyJSONBlockAVX2 : ClassifyJSONBlockSSE2;
+    Indexer->PrevEndsOddBackslash = 0;
+    Indexer->PrevInString = 0;
+    Indexer->PrevScalar = 0;
+    Indexer->Count = 0;
+    Indexer->Next = 0;
+}
+
+static u64 PeekStructural(json_structural_indexer *Indexer)
+{
+    // NOTE: Returns Source.Count once there are no structurals left
+    if(Indexer->Next == Indexer->Count)
+    {
+        RefillStructuralIndex(Indexer);
+    }
+    
+    u64 Result = (Indexer->Next < Indexer->Count) ? Indexer->Positions[Indexer->Next] : Indexer->Source.Count;
+    return Result;
+}
+
+static u64 NextStructural(json_structural_indexer *Indexer)
+{
+    u64 Result = PeekStructural(Indexer);
+    if(Indexer->Next < Indexer->Count)
+    {
+        ++Indexer->Next;
+    }
+    
+    return Result;
+}
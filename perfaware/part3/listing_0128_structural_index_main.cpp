@@ -0,0 +1,274 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 128
+   ======================================================================== */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0103_repetition_tester.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0127_indexed_json_parser.cpp"
+
+struct parse_parameters
+{
+    buffer InputJSON;
+    u64 MaxPairCount;
+    haversine_pair *Pairs;
+    arena *Arena;
+};
+
+typedef void parse_test_func(repetition_tester *Tester, parse_parameters *Params);
+
+static void IndexOnly(repetition_tester *Tester, parse_parameters *Params, classify_json_block_func *Classify)
+{
+    json_structural_indexer Index;
+    
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        BeginStructuralIndex(&Index, Params->InputJSON);
+        Index.Classify = Classify;
+        
+        u64 StructuralCount = 0;
+        while(NextStructural(&Index) < Params->InputJSON.Count)
+        {
+            ++StructuralCount;
+        }
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+        
+        // NOTE: Written out so the loop above can't be optimized away
+        Params->Pairs[0].X0 = (f64)StructuralCount;
+    }
+}
+
+static void IndexOnlySSE2(repetition_tester *Tester, parse_parameters *Params)
+{
+    IndexOnly(Tester, Params, ClassifyJSONBlockSSE2);
+}
+
+static void IndexOnlyAVX2(repetition_tester *Tester, parse_parameters *Params)
+{
+    IndexOnly(Tester, Params, ClassifyJSONBlockAVX2);
+}
+
+static void ParseTree(repetition_tester *Tester, parse_parameters *Params, b32 ByteAtATime)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        ParseJSON(Params->InputJSON, Params->Arena, ByteAtATime);
+        ResetArena(Params->Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseTreeByteAtATime(repetition_tester *Tester, parse_parameters *Params)
+{
+    ParseTree(Tester, Params, true);
+}
+
+static void ParseTreeFromIndex(repetition_tester *Tester, parse_parameters *Params)
+{
+    ParseTree(Tester, Params, false);
+}
+
+struct test_function
+{
+    char const *Name;
+    parse_test_func *Func;
+    b32 NeedsAVX2;
+};
+test_function TestFunctions[] =
+{
+    {"index only (SSE2)", IndexOnlySSE2},
+    {"index only (AVX2)", IndexOnlyAVX2, true},
+    {"tree, byte at a time", ParseTreeByteAtATime},
+    {"tree, structural index", ParseTreeFromIndex},
+};
+
+static u64 ParsePairs(buffer InputJSON, u64 MaxPairCount, haversine_pair *Pairs, arena *Arena, b32 ByteAtATime)
+{
+    u64 PairCount = 0;
+    
+    json_element *JSON = ParseJSON(InputJSON, Arena, ByteAtATime);
+    json_element *PairsArray = LookupElement(JSON, CONSTANT_STRING("pairs"));
+    if(PairsArray)
+    {
+        for(json_element *Element = PairsArray->FirstSubElement;
+            Element && (PairCount < MaxPairCount);
+            Element = Element->NextSibling)
+        {
+            haversine_pair *Pair = Pairs + PairCount++;
+            
+            Pair->X0 = ConvertElementToF64(Element, CONSTANT_STRING("x0"));
+            Pair->Y0 = ConvertElementToF64(Element, CONSTANT_STRING("y0"));
+            Pair->X1 = ConvertElementToF64(Element, CONSTANT_STRING("x1"));
+            Pair->Y1 = ConvertElementToF64(Element, CONSTANT_STRING("y1"));
+        }
+    }
+    
+    ResetArena(Arena);
+    
+    return PairCount;
+}
+
+static buffer ReadEntireFile(char *FileName)
+{
+    buffer Result = {};
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        Result = AllocateBuffer(Stat.st_size);
+        if(Result.Data)
+        {
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&BeginProfile;
+    (void)&EndAndPrintProfile;
+    (void)&FreeJSON;
+    (void)&ParseHaversinePairs;
+    (void)&TryToEnableLargePages;
+    
+    u64 CPUTimerFreq = EstimateCPUTimerFreq();
+    
+    if(ArgCount == 2)
+    {
+        parse_parameters Params = {};
+        Params.InputJSON = ReadEntireFile(Args[1]);
+        
+        u32 MinimumJSONPairEncoding = 6*4;
+        Params.MaxPairCount = Params.InputJSON.Count / MinimumJSONPairEncoding;
+        
+        buffer ParsedValues = AllocateBuffer(Params.MaxPairCount*sizeof(haversine_pair));
+        buffer CheckValues = AllocateBuffer(Params.MaxPairCount*sizeof(haversine_pair));
+        Params.Pairs = (haversine_pair *)ParsedValues.Data;
+        
+        arena Arena = {};
+        Params.Arena = &Arena;
+        
+        if(Params.MaxPairCount && ParsedValues.Count && CheckValues.Count)
+        {
+            // NOTE: Before timing anything, make sure both tokenizers produce the same pairs
+            u64 PairCount = ParsePairs(Params.InputJSON, Params.MaxPairCount, Params.Pairs, &Arena, true);
+            u64 CheckCount = ParsePairs(Params.InputJSON, Params.MaxPairCount, (haversine_pair *)CheckValues.Data, &Arena, false);
+            b32 Match = ((PairCount == CheckCount) &&
+                         (memcmp(ParsedValues.Data, CheckValues.Data, PairCount*sizeof(haversine_pair)) == 0));
+            printf("Pairs: %llu byte at a time, %llu from structural index (%s)\n",
+                   PairCount, CheckCount, Match ? "identical" : "MISMATCH");
+            
+            b32 HasAVX2 = CPUHasAVX2();
+            if(!HasAVX2)
+            {
+                printf("NOTE: This CPU does not support AVX2, so the structural index uses SSE2.\n");
+            }
+            
+            repetition_tester Testers[ArrayCount(TestFunctions)] = {};
+            
+            for(;;)
+            {
+                for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+                {
+                    repetition_tester *Tester = Testers + FuncIndex;
+                    test_function TestFunc = TestFunctions[FuncIndex];
+                    
+                    if(!TestFunc.NeedsAVX2 || HasAVX2)
+                    {
+                        printf("\n--- %s ---\n", TestFunc.Name);
+                        NewTestWave(Tester, Params.InputJSON.Count, CPUTimerFreq);
+                        TestFunc.Func(Tester, &Params);
+                    }
+                }
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Malformed input JSON\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [haversine_input.json]\n", Args[0]);
+    }
+    
+    return 0;
+}
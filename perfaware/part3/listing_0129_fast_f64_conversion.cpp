@@ -0,0 +1,432 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 129
+   ======================================================================== */
+
+/* NOTE: Correctly rounded conversion of JSON numbers to f64. Building the value up digit by digit
+   in f64 and then multiplying by pow(10, Exponent) rounds at nearly every step, so the result is
+   often an ulp or two away from the f64 the text actually names. Here, the digits are gathered into
+   a u64 first (eight at a time, where possible), and the decimal exponent is applied in one step:
+       
+       - If the digits fit in 53 bits and the power of ten is exact in f64, a single IEEE multiply
+         or divide is already correctly rounded (Clinger's fast path).
+       - Otherwise, for exponents from -27 to 27, the Eisel-Lemire algorithm: the digits are
+         normalized and multiplied by a 128-bit approximation of 5^Exponent, and the top bits of the
+         product are the mantissa, with the power of two coming from the exponent directly. Over
+         this range of exponents, the 128-bit product has been shown to always be precise enough
+         to round correctly, so nothing ever needs to be checked or retried.
+       - Anything else (more than 19 significant digits, or huge exponents) goes to strtod, which
+         is correctly rounded in every CRT we build with, but slow.
+   
+   The haversine generator writes every number with %.16f, and that exact layout gets its own
+   path that skips the general digit loop. */
+
+#if _MSC_VER
+#include <intrin.h>
+#endif
+
+static f64 const ExactPowersOf10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// NOTE: 5^q scaled by a power of two so the top bit is set, as {high, low} 64-bit halves. For q >= 0
+// these are exact. For q < 0 they are the reciprocal, rounded up.
+#define SMALLEST_POWER_OF_5 -27
+#define LARGEST_POWER_OF_5 27
+static u64 const PowersOf5[][2] =
+{
+    {0x9e74d1b791e07e48ull, 0x775ea264cf55347eull}, // 5^-27
+    {0xc612062576589ddaull, 0x95364afe032a819eull}, // 5^-26
+    {0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull}, // 5^-25
+    {0x9abe14cd44753b52ull, 0xc4926a9672793543ull}, // 5^-24
+    {0xc16d9a0095928a27ull, 0x75b7053c0f178294ull}, // 5^-23
+    {0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull}, // 5^-22
+    {0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull}, // 5^-21
+    {0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull}, // 5^-20
+    {0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull}, // 5^-19
+    {0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull}, // 5^-18
+    {0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull}, // 5^-17
+    {0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull}, // 5^-16
+    {0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull}, // 5^-15
+    {0xb424dc35095cd80full, 0x538484c19ef38c95ull}, // 5^-14
+    {0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull}, // 5^-13
+    {0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull}, // 5^-12
+    {0xafebff0bcb24aafeull, 0xf78f69a51539d749ull}, // 5^-11
+    {0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull}, // 5^-10
+    {0x89705f4136b4a597ull, 0x31680a88f8953031ull}, // 5^-9
+    {0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull}, // 5^-8
+    {0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull}, // 5^-7
+    {0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull}, // 5^-6
+    {0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull}, // 5^-5
+    {0xd1b71758e219652bull, 0xd3c36113404ea4a9ull}, // 5^-4
+    {0x83126e978d4fdf3bull, 0x645a1cac083126eaull}, // 5^-3
+    {0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull}, // 5^-2
+    {0xccccccccccccccccull, 0xcccccccccccccccdull}, // 5^-1
+    {0x8000000000000000ull, 0x0000000000000000ull}, // 5^0
+    {0xa000000000000000ull, 0x0000000000000000ull}, // 5^1
+    {0xc800000000000000ull, 0x0000000000000000ull}, // 5^2
+    {0xfa00000000000000ull, 0x0000000000000000ull}, // 5^3
+    {0x9c40000000000000ull, 0x0000000000000000ull}, // 5^4
+    {0xc350000000000000ull, 0x0000000000000000ull}, // 5^5
+    {0xf424000000000000ull, 0x0000000000000000ull}, // 5^6
+    {0x9896800000000000ull, 0x0000000000000000ull}, // 5^7
+    {0xbebc200000000000ull, 0x0000000000000000ull}, // 5^8
+    {0xee6b280000000000ull, 0x0000000000000000ull}, // 5^9
+    {0x9502f90000000000ull, 0x0000000000000000ull}, // 5^10
+    {0xba43b74000000000ull, 0x0000000000000000ull}, // 5^11
+    {0xe8d4a51000000000ull, 0x0000000000000000ull}, // 5^12
+    {0x9184e72a00000000ull, 0x0000000000000000ull}, // 5^13
+    {0xb5e620f480000000ull, 0x0000000000000000ull}, // 5^14
+    {0xe35fa931a0000000ull, 0x0000000000000000ull}, // 5^15
+    {0x8e1bc9bf04000000ull, 0x0000000000000000ull}, // 5^16
+    {0xb1a2bc2ec5000000ull, 0x0000000000000000ull}, // 5^17
+    {0xde0b6b3a76400000ull, 0x0000000000000000ull}, // 5^18
+    {0x8ac7230489e80000ull, 0x0000000000000000ull}, // 5^19
+    {0xad78ebc5ac620000ull, 0x0000000000000000ull}, // 5^20
+    {0xd8d726b7177a8000ull, 0x0000000000000000ull}, // 5^21
+    {0x878678326eac9000ull, 0x0000000000000000ull}, // 5^22
+    {0xa968163f0a57b400ull, 0x0000000000000000ull}, // 5^23
+    {0xd3c21bcecceda100ull, 0x0000000000000000ull}, // 5^24
+    {0x84595161401484a0ull, 0x0000000000000000ull}, // 5^25
+    {0xa56fa5b99019a5c8ull, 0x0000000000000000ull}, // 5^26
+    {0xcecb8f27f4200f3aull, 0x0000000000000000ull}, // 5^27
+};
+
+struct u128
+{
+    u64 Low;
+    u64 High;
+};
+
+static u32 CountLeadingZeros64(u64 Value)
+{
+    // NOTE: Value must not be 0
+#if _MSC_VER
+    unsigned long Index;
+    _BitScanReverse64(&Index, Value);
+    return 63 - Index;
+#else
+    return __builtin_clzll(Value);
+#endif
+}
+
+static u32 CountTrailingZeros64(u64 Value)
+{
+    // NOTE: Value must not be 0
+#if _MSC_VER
+    unsigned long Index;
+    _BitScanForward64(&Index, Value);
+    return Index;
+#else
+    return __builtin_ctzll(Value);
+#endif
+}
+
+static u128 Multiply64To128(u64 A, u64 B)
+{
+    u128 Result;
+#if _MSC_VER
+    Result.Low = _umul128(A, B, &Result.High);
+#else
+    unsigned __int128 Product = (unsigned __int128)A * B;
+    Result.Low = (u64)Product;
+    Result.High = (u64)(Product >> 64);
+#endif
+    return Result;
+}
+
+static f64 ConvertDecimalToF64Slow(buffer Source)
+{
+    // NOTE: strtod needs a terminated string, and the JSON source isn't one
+    char Local[128];
+    char *Text = (Source.Count < sizeof(Local)) ? Local : (char *)malloc(Source.Count + 1);
+    
+    f64 Result = 0.0;
+    if(Text)
+    {
+        memcpy(Text, Source.Data, Source.Count);
+        Text[Source.Count] = 0;
+        Result = strtod(Text, 0);
+        
+        if(Text != Local)
+        {
+            free(Text);
+        }
+    }
+    
+    return Result;
+}
+
+static f64 EiselLemire(u64 Digits, s32 Exponent)
+{
+    // NOTE: Digits must not be 0, and Exponent must be in the table's range
+    u32 LeadingZeros = CountLeadingZeros64(Digits);
+    u64 Normalized = Digits << LeadingZeros;
+    
+    u64 const *Power = PowersOf5[Exponent - SMALLEST_POWER_OF_5];
+    u128 Product = Multiply64To128(Normalized, Power[0]);
+    
+    // NOTE: Only if the bits below the 55 that are kept are all ones could the low half of the power
+    // carry into them, so only then is the second multiply needed
+    if((Product.High & 0x1FF) == 0x1FF)
+    {
+        u128 Second = Multiply64To128(Normalized, Power[1]);
+        Product.Low += Second.High;
+        if(Second.High > Product.Low)
+        {
+            ++Product.High;
+        }
+    }
+    
+    // NOTE: Keep 54 bits, one more than the mantissa, so the last one can round
+    u32 UpperBit = (u32)(Product.High >> 63);
+    u32 Shift = UpperBit + 9;
+    u64 Mantissa = Product.High >> Shift;
+    
+    // NOTE: floor(log2(10^Exponent)) + 63, plus the exponent bias
+    s32 BiasedExponent = (((152170 + 65536)*Exponent) >> 16) + 63 + UpperBit - LeadingZeros + 1023;
+    
+    // NOTE: If the product is exactly halfway between two f64s, round to even instead of up.
+    // That can only happen for the exponents where 5^Exponent is small enough to be exact.
+    if((Product.Low <= 1) && (Exponent >= -4) && (Exponent <= 23) &&
+       ((Mantissa & 3) == 1) && ((Mantissa << Shift) == Product.High))
+    {
+        Mantissa &= ~1ull;
+    }
+    
+    Mantissa += (Mantissa & 1);
+    Mantissa >>= 1;
+    if(Mantissa >= (2ull << 52))
+    {
+        Mantissa = (1ull << 52);
+        ++BiasedExponent;
+    }
+    
+    // NOTE: Over this range of exponents, the result can't be subnormal or overflow to infinity
+    u64 Bits = (Mantissa & ~(1ull << 52)) | ((u64)BiasedExponent << 52);
+    
+    f64 Result;
+    memcpy(&Result, &Bits, sizeof(Result));
+    return Result;
+}
+
+static b32 DecimalToF64(u64 Digits, s32 Exponent, f64 *Result)
+{
+    // NOTE: Computes Digits * 10^Exponent, correctly rounded. Returns false if it can't do that exactly.
+    b32 Converted = true;
+    
+    if(Digits == 0)
+    {
+        *Result = 0.0;
+    }
+    else if((Digits <= (1ull << 53)) && (Exponent >= -22) && (Exponent <= 22))
+    {
+        *Result = (Exponent < 0) ? ((f64)Digits / ExactPowersOf10[-Exponent]) : ((f64)Digits * ExactPowersOf10[Exponent]);
+    }
+    else if((Exponent >= SMALLEST_POWER_OF_5) && (Exponent <= LARGEST_POWER_OF_5))
+    {
+        *Result = EiselLemire(Digits, Exponent);
+    }
+    else
+    {
+        Converted = false;
+    }
+    
+    return Converted;
+}
+
+static b32 IsEightDigits(u64 Chunk)
+{
+    // NOTE: Each byte must be 0x30-0x39: the high nibble is 3, and adding 6 doesn't carry into it
+    b32 Result = ((((Chunk & 0xF0F0F0F0F0F0F0F0ull) |
+                    (((Chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+                   0x3333333333333333ull));
+    return Result;
+}
+
+static u32 ParseEightDigits(u64 Chunk)
+{
+    // NOTE: Little-endian, so the first digit is in the low byte. Adjacent digits are combined into
+    // pairs, then pairs into fours, then fours into the final eight, with one multiply per step.
+    Chunk -= 0x3030303030303030ull;
+    Chunk = (Chunk * 10) + (Chunk >> 8);
+    Chunk = (((Chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+             (((Chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    
+    u32 Result = (u32)Chunk;
+    return Result;
+}
+
+static u64 LoadEightBytes(u8 *Data)
+{
+    u64 Result;
+    memcpy(&Result, Data, sizeof(Result));
+    return Result;
+}
+
+static b32 ConvertFixed16ToF64(buffer Source, f64 *Result)
+{
+    // NOTE: Matches exactly [-]d{1,3}.d{16}, which is what the generator writes. Anything else is
+    // left for the general path.
+    b32 Matched = false;
+    
+    // NOTE: Signs are close to random in the generator's output, so the sign is skipped without a branch
+    u64 Negative = (Source.Count && (Source.Data[0] == '-'));
+    u8 *Data = Source.Data + Negative;
+    u64 Count = Source.Count - Negative;
+    
+    if((Count >= 18) && (Count <= 20))
+    {
+        // NOTE: The number of digits before the point is found by searching the first eight bytes for
+        // the '.', instead of looping over the digits. They are then padded with leading '0's out to
+        // eight, so the same SWAR conversion as the fraction can be used.
+        u64 Head = LoadEightBytes(Data);
+        u64 Dots = Head ^ 0x2E2E2E2E2E2E2E2Eull;
+        u64 DotMask = (Dots - 0x0101010101010101ull) & ~Dots & 0x8080808080808080ull;
+        u32 WholeCount = DotMask ? (CountTrailingZeros64(DotMask) / 8) : 8;
+        
+        if((WholeCount >= 1) && (Count == (WholeCount + 17)))
+        {
+            u64 Whole = (Head << (8*(8 - WholeCount))) | (0x3030303030303030ull >> (8*WholeCount));
+            u64 First = LoadEightBytes(Data + WholeCount + 1);
+            u64 Second = LoadEightBytes(Data + WholeCount + 9);
+            if(IsEightDigits(Whole) && IsEightDigits(First) && IsEightDigits(Second))
+            {
+                u64 Digits = (u64)ParseEightDigits(Whole)*10000000000000000ull + (u64)ParseEightDigits(First)*100000000ull + ParseEightDigits(Second);
+                
+                f64 Value;
+                Matched = DecimalToF64(Digits, -16, &Value);
+                *Result = Negative ? -Value : Value;
+            }
+        }
+    }
+    
+    return Matched;
+}
+
+static f64 ConvertJSONToF64Exact(buffer Source)
+{
+    // NOTE: Like the pow() version, this reads as much of a number as it can from the front of Source,
+    // and a Source with no digits at all (true, false, null, strings) converts to 0.
+    f64 Result = 0.0;
+    if(!ConvertFixed16ToF64(Source, &Result))
+    {
+        u8 *Data = Source.Data;
+        u64 Count = Source.Count;
+        u64 At = 0;
+        
+        b32 Negative = (Count && (Data[0] == '-'));
+        if(Negative)
+        {
+            ++At;
+        }
+        
+        u64 Digits = 0;
+        u32 SignificantCount = 0;
+        s32 Exponent = 0;
+        
+        // NOTE: Leading zeros don't count toward the 19 digits that fit in a u64
+        while((At < Count) && (Data[At] == '0'))
+        {
+            ++At;
+        }
+        
+        while((At < Count) && ((u8)(Data[At] - '0') < 10))
+        {
+            if(SignificantCount < 19)
+            {
+                Digits = 10*Digits + (Data[At] - '0');
+            }
+            else
+            {
+                ++Exponent;
+            }
+            ++SignificantCount;
+            ++At;
+        }
+        
+        if((At < Count) && (Data[At] == '.'))
+        {
+            ++At;
+            
+            if(SignificantCount == 0)
+            {
+                while((At < Count) && (Data[At] == '0'))
+                {
+                    --Exponent;
+                    ++At;
+                }
+            }
+            
+            while(((At + 8) <= Count) && ((SignificantCount + 8) <= 19) && IsEightDigits(LoadEightBytes(Data + At)))
+            {
+                Digits = 100000000ull*Digits + ParseEightDigits(LoadEightBytes(Data + At));
+                SignificantCount += 8;
+                Exponent -= 8;
+                At += 8;
+            }
+            
+            while((At < Count) && ((u8)(Data[At] - '0') < 10))
+            {
+                if(SignificantCount < 19)
+                {
+                    Digits = 10*Digits + (Data[At] - '0');
+                    --Exponent;
+                }
+                ++SignificantCount;
+                ++At;
+            }
+        }
+        
+        if((At < Count) && ((Data[At] == 'e') || (Data[At] == 'E')))
+        {
+            ++At;
+            
+            b32 NegativeExponent = false;
+            if((At < Count) && ((Data[At] == '+') || (Data[At] == '-')))
+            {
+                NegativeExponent = (Data[At] == '-');
+                ++At;
+            }
+            
+            s32 ExplicitExponent = 0;
+            while((At < Count) && ((u8)(Data[At] - '0') < 10))
+            {
+                if(ExplicitExponent < 100000)
+                {
+                    ExplicitExponent = 10*ExplicitExponent + (Data[At] - '0');
+                }
+                ++At;
+            }
+            
+            Exponent += NegativeExponent ? -ExplicitExponent : ExplicitExponent;
+        }
+        
+        // NOTE: Past 19 digits the u64 has dropped some, so only strtod can say which way to round
+        if((SignificantCount > 19) || !DecimalToF64(Digits, Exponent, &Result))
+        {
+            buffer Number = Source;
+            Number.Count = At;
+            Result = ConvertDecimalToF64Slow(Number);
+        }
+        else if(Negative)
+        {
+            Result = -Result;
+        }
+    }
+    
+    return Result;
+}
@@ -0,0 +1,463 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 131
+   ======================================================================== */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0103_repetition_tester.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0130_exact_json_parser.cpp"
+
+static f64 ConvertJSONToF64WithPow(buffer Source)
+{
+    // NOTE: The conversion every parser before listing 130 used, kept here to compare against
+    u64 At = 0;
+    
+    f64 Sign = 1.0;
+    if(IsInBounds(Source, At) && (Source.Data[At] == '-'))
+    {
+        Sign = -1.0;
+        ++At;
+    }
+    
+    f64 Number = 0.0;
+    while(IsJSONDigit(Source, At))
+    {
+        Number = 10.0*Number + (f64)(Source.Data[At++] - '0');
+    }
+    
+    if(IsInBounds(Source, At) && (Source.Data[At] == '.'))
+    {
+        ++At;
+        f64 C = 1.0 / 10.0;
+        while(IsJSONDigit(Source, At))
+        {
+            Number = Number + C*(f64)(Source.Data[At++] - '0');
+            C *= 1.0 / 10.0;
+        }
+    }
+    
+    if(IsInBounds(Source, At) && ((Source.Data[At] == 'e') || (Source.Data[At] == 'E')))
+    {
+        ++At;
+        if(IsInBounds(Source, At) && (Source.Data[At] == '+'))
+        {
+            ++At;
+        }
+        
+        f64 ExponentSign = 1.0;
+        if(IsInBounds(Source, At) && (Source.Data[At] == '-'))
+        {
+            ExponentSign = -1.0;
+            ++At;
+        }
+        
+        f64 Exponent = 0.0;
+        while(IsJSONDigit(Source, At))
+        {
+            Exponent = 10.0*Exponent + (f64)(Source.Data[At++] - '0');
+        }
+        
+        Number *= pow(10.0, ExponentSign*Exponent);
+    }
+    
+    f64 Result = Sign*Number;
+    return Result;
+}
+
+typedef f64 convert_func(buffer Source);
+
+static u64 GetBits(f64 Value)
+{
+    u64 Result;
+    memcpy(&Result, &Value, sizeof(Result));
+    return Result;
+}
+
+static u64 ULPDistance(f64 A, f64 B)
+{
+    // NOTE: Maps the f64 bit patterns onto a line where adjacent values differ by 1
+    s64 SignedA = (s64)GetBits(A);
+    s64 SignedB = (s64)GetBits(B);
+    if(SignedA < 0) SignedA = (s64)0x8000000000000000ull - SignedA;
+    if(SignedB < 0) SignedB = (s64)0x8000000000000000ull - SignedB;
+    
+    u64 Result = (SignedA > SignedB) ? (u64)(SignedA - SignedB) : (u64)(SignedB - SignedA);
+    return Result;
+}
+
+static b32 IsFixed16Layout(buffer Source)
+{
+    b32 Result = false;
+    for(u64 Index = 0; Index < Source.Count; ++Index)
+    {
+        if(Source.Data[Index] == '.')
+        {
+            Result = ((Source.Count - Index - 1) == 16);
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+struct number_list
+{
+    u64 Count;
+    buffer *Numbers;
+};
+
+static number_list CollectNumbers(buffer InputJSON)
+{
+    number_list Result = {};
+    Result.Numbers = (buffer *)malloc((InputJSON.Count/2 + 1)*sizeof(buffer));
+    
+    if(Result.Numbers)
+    {
+        json_structural_indexer Index;
+        BeginStructuralIndex(&Index, InputJSON);
+        
+        json_parser Parser = {};
+        Parser.Source = InputJSON;
+        Parser.Index = &Index;
+        
+        while(IsParsing(&Parser))
+        {
+            json_token Token = GetJSONToken(&Parser);
+            if(Token.Type == Token_number)
+            {
+                Result.Numbers[Result.Count++] = Token.Value;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static u64 ConvertPairs(json_element *PairsArray, convert_func *Convert, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    u64 PairCount = 0;
+    
+    if(PairsArray)
+    {
+        for(json_element *Element = PairsArray->FirstSubElement;
+            Element && (PairCount < MaxPairCount);
+            Element = Element->NextSibling)
+        {
+            haversine_pair *Pair = Pairs + PairCount++;
+            
+            json_element *X0 = LookupElement(Element, CONSTANT_STRING("x0"));
+            json_element *Y0 = LookupElement(Element, CONSTANT_STRING("y0"));
+            json_element *X1 = LookupElement(Element, CONSTANT_STRING("x1"));
+            json_element *Y1 = LookupElement(Element, CONSTANT_STRING("y1"));
+            
+            Pair->X0 = X0 ? Convert(X0->Value) : 0.0;
+            Pair->Y0 = Y0 ? Convert(Y0->Value) : 0.0;
+            Pair->X1 = X1 ? Convert(X1->Value) : 0.0;
+            Pair->Y1 = Y1 ? Convert(Y1->Value) : 0.0;
+        }
+    }
+    
+    return PairCount;
+}
+
+static void CompareWithAnswers(char const *Label, u64 PairCount, haversine_pair *Pairs, u64 AnswerCount, f64 *Answers)
+{
+    u64 ExactCount = 0;
+    f64 Sum = 0.0;
+    f64 SumCoef = 1.0 / (f64)PairCount;
+    for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+    {
+        haversine_pair Pair = Pairs[PairIndex];
+        f64 Dist = ReferenceHaversine(Pair.X0, Pair.Y0, Pair.X1, Pair.Y1, 6372.8);
+        if((PairIndex < AnswerCount) && (GetBits(Dist) == GetBits(Answers[PairIndex])))
+        {
+            ++ExactCount;
+        }
+        Sum += SumCoef*Dist;
+    }
+    
+    printf("%s: %llu/%llu distances bit-identical to the reference, sum difference %.16e\n",
+           Label, ExactCount, PairCount, Sum - Answers[AnswerCount]);
+}
+
+struct convert_parameters
+{
+    number_list Numbers;
+    u64 ByteCount;
+    f64 Sink;
+};
+
+static void TestConvert(repetition_tester *Tester, convert_parameters *Params, convert_func *Convert)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        f64 Sum = 0.0;
+        for(u64 Index = 0; Index < Params->Numbers.Count; ++Index)
+        {
+            Sum += Convert(Params->Numbers.Numbers[Index]);
+        }
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->ByteCount);
+        
+        // NOTE: Written out so the loop above can't be optimized away
+        Params->Sink = Sum;
+    }
+}
+
+static void TestConvertWithPow(repetition_tester *Tester, convert_parameters *Params)
+{
+    TestConvert(Tester, Params, ConvertJSONToF64WithPow);
+}
+
+static void TestConvertExact(repetition_tester *Tester, convert_parameters *Params)
+{
+    TestConvert(Tester, Params, ConvertJSONToF64Exact);
+}
+
+static void TestConvertStrtod(repetition_tester *Tester, convert_parameters *Params)
+{
+    TestConvert(Tester, Params, ConvertDecimalToF64Slow);
+}
+
+typedef void convert_test_func(repetition_tester *Tester, convert_parameters *Params);
+
+struct test_function
+{
+    char const *Name;
+    convert_test_func *Func;
+};
+test_function TestFunctions[] =
+{
+    {"digits in f64 + pow", TestConvertWithPow},
+    {"exact", TestConvertExact},
+    {"strtod", TestConvertStrtod},
+};
+
+static buffer ReadEntireFile(char *FileName)
+{
+    buffer Result = {};
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        Result = AllocateBuffer(Stat.st_size);
+        if(Result.Data)
+        {
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&BeginProfile;
+    (void)&EndAndPrintProfile;
+    (void)&FreeJSON;
+    (void)&ParseHaversinePairs;
+    (void)&TryToEnableLargePages;
+    
+    int Result = 1;
+    
+    if((ArgCount == 2) || (ArgCount == 3))
+    {
+        buffer InputJSON = ReadEntireFile(Args[1]);
+        number_list Numbers = CollectNumbers(InputJSON);
+        
+        // NOTE: Every number must convert to exactly what strtod gives, and every number the generator
+        // wrote with %.16f must print back out to the same text
+        u64 ExactMismatches = 0;
+        u64 RoundTripFailures = 0;
+        u64 PowMismatches = 0;
+        u64 PowMaxULPs = 0;
+        for(u64 Index = 0; Index < Numbers.Count; ++Index)
+        {
+            buffer Number = Numbers.Numbers[Index];
+            f64 Reference = ConvertDecimalToF64Slow(Number);
+            f64 Exact = ConvertJSONToF64Exact(Number);
+            f64 WithPow = ConvertJSONToF64WithPow(Number);
+            
+            if(GetBits(Exact) != GetBits(Reference))
+            {
+                if(ExactMismatches++ < 8)
+                {
+                    fprintf(stderr, "MISMATCH: %.*s -> %.17g, expected %.17g\n",
+                            (u32)Number.Count, (char *)Number.Data, Exact, Reference);
+                }
+            }
+            
+            if(IsFixed16Layout(Number))
+            {
+                char Text[64];
+                int TextCount = snprintf(Text, sizeof(Text), "%.16f", Exact);
+                if((TextCount != (int)Number.Count) || (memcmp(Text, Number.Data, Number.Count) != 0))
+                {
+                    if(RoundTripFailures++ < 8)
+                    {
+                        fprintf(stderr, "ROUND TRIP: %.*s -> %s\n", (u32)Number.Count, (char *)Number.Data, Text);
+                    }
+                }
+            }
+            
+            u64 ULPs = ULPDistance(WithPow, Reference);
+            if(ULPs)
+            {
+                ++PowMismatches;
+                if(PowMaxULPs < ULPs)
+                {
+                    PowMaxULPs = ULPs;
+                }
+            }
+        }
+        
+        printf("Numbers: %llu\n", Numbers.Count);
+        printf("Exact conversion: %llu mismatches against strtod, %llu round-trip failures\n", ExactMismatches, RoundTripFailures);
+        printf("Digits in f64 + pow: %llu mismatches against strtod (max %llu ulps)\n", PowMismatches, PowMaxULPs);
+        
+        if(ArgCount == 3)
+        {
+            buffer AnswersF64 = ReadEntireFile(Args[2]);
+            if(AnswersF64.Count >= sizeof(f64))
+            {
+                u32 MinimumJSONPairEncoding = 6*4;
+                u64 MaxPairCount = InputJSON.Count / MinimumJSONPairEncoding;
+                buffer ParsedValues = AllocateBuffer(MaxPairCount*sizeof(haversine_pair));
+                haversine_pair *Pairs = (haversine_pair *)ParsedValues.Data;
+                
+                arena Arena = {};
+                json_element *JSON = ParseJSON(InputJSON, &Arena);
+                json_element *PairsArray = LookupElement(JSON, CONSTANT_STRING("pairs"));
+                
+                u64 AnswerCount = (AnswersF64.Count - sizeof(f64)) / sizeof(f64);
+                f64 *Answers = (f64 *)AnswersF64.Data;
+                
+                printf("\nValidation:\n");
+                u64 PairCount = ConvertPairs(PairsArray, ConvertJSONToF64WithPow, MaxPairCount, Pairs);
+                CompareWithAnswers("Digits in f64 + pow", PairCount, Pairs, AnswerCount, Answers);
+                PairCount = ConvertPairs(PairsArray, ConvertJSONToF64Exact, MaxPairCount, Pairs);
+                CompareWithAnswers("Exact", PairCount, Pairs, AnswerCount, Answers);
+                
+                FreeArena(&Arena);
+                FreeBuffer(&ParsedValues);
+            }
+            
+            FreeBuffer(&AnswersF64);
+        }
+        
+        if(ExactMismatches || RoundTripFailures)
+        {
+            printf("FAILED\n");
+        }
+        else if(Numbers.Count)
+        {
+            Result = 0;
+            
+            u64 CPUTimerFreq = EstimateCPUTimerFreq();
+            
+            convert_parameters Params = {};
+            Params.Numbers = Numbers;
+            for(u64 Index = 0; Index < Numbers.Count; ++Index)
+            {
+                Params.ByteCount += Numbers.Numbers[Index].Count;
+            }
+            
+            repetition_tester Testers[ArrayCount(TestFunctions)] = {};
+            
+            for(;;)
+            {
+                for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+                {
+                    repetition_tester *Tester = Testers + FuncIndex;
+                    test_function TestFunc = TestFunctions[FuncIndex];
+                    
+                    printf("\n--- %s ---\n", TestFunc.Name);
+                    NewTestWave(Tester, Params.ByteCount, CPUTimerFreq);
+                    TestFunc.Func(Tester, &Params);
+                }
+            }
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [haversine_input.json]\n", Args[0]);
+        fprintf(stderr, "       %s [haversine_input.json] [answers.f64]\n", Args[0]);
+    }
+    
+    return Result;
+}
@@ -0,0 +1,685 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 132
+   ======================================================================== */
+
+/* NOTE: The parser from listing 130, with a hash index over the fields of large objects.
+   LookupElement on an object walks its children comparing labels, which is fine for the four
+   fields of a haversine pair, but for an object with hundreds of keys that gets looked up
+   over and over, it is a full walk per lookup. Once a lookup has had to walk past
+   JSON_FIELD_INDEX_THRESHOLD children, an open-addressed hash of label -> child is built
+   in the arena the tree was parsed into, and every later lookup on that object goes
+   through it. Trees parsed without an arena never get an index. */
+
+enum json_token_type
+{
+    Token_end_of_stream,
+    Token_error,
+    
+    Token_open_brace,
+    Token_open_bracket,
+    Token_close_brace,
+    Token_close_bracket,
+    Token_comma,
+    Token_colon,
+    Token_string_literal,
+    Token_number,
+    Token_true,
+    Token_false,
+    Token_null,
+    
+    Token_count,
+};
+
+struct json_token
+{
+    json_token_type Type;
+    buffer Value;
+};
+
+struct json_field_index;
+struct json_element
+{
+    buffer Label;
+    buffer Value;
+    json_element *FirstSubElement;
+    json_field_index *FieldIndex;
+    
+    json_element *NextSibling;
+};
+
+struct json_parser
+{
+    buffer Source;
+    u64 At;
+    b32 HadError;
+    
+    // NOTE: If set, errors only set HadError. For speculative parses whose failures are expected and handled by the caller.
+    b32 Quiet;
+    
+    // NOTE: If set, elements are allocated from here instead of with malloc
+    arena *Arena;
+    
+    // NOTE: If set, tokens come from the structural index instead of scanning every byte
+    json_structural_indexer *Index;
+};
+
+static b32 IsJSONDigit(buffer Source, u64 At)
+{
+    b32 Result = false;
+    if(IsInBounds(Source, At))
+    {
+        u8 Val = Source.Data[At];
+        Result = ((Val >= '0') && (Val <= '9'));
+    }
+    
+    return Result;
+}
+
+static b32 IsJSONWhitespace(buffer Source, u64 At)
+{
+    b32 Result = false;
+    if(IsInBounds(Source, At))
+    {
+        u8 Val = Source.Data[At];
+        Result = ((Val == ' ') || (Val == '\t') || (Val == '\n') || (Val == '\r'));
+    }
+    
+    return Result;
+}
+
+static b32 IsParsing(json_parser *Parser)
+{
+    b32 Result = !Parser->HadError;
+    if(Parser->Index)
+    {
+        Result = Result && (PeekStructural(Parser->Index) < Parser->Source.Count);
+    }
+    else
+    {
+        Result = Result && IsInBounds(Parser->Source, Parser->At);
+    }
+    
+    return Result;
+}
+
+static void Error(json_parser *Parser, json_token Token, char const *Message)
+{
+    Parser->HadError = true;
+    if(!Parser->Quiet)
+    {
+        fprintf(stderr, "ERROR: \"%.*s\" - %s\n", (u32)Token.Value.Count, (char *)Token.Value.Data, Message);
+    }
+}
+
+static void ParseKeyword(buffer Source, u64 *At, buffer KeywordRemaining, json_token_type Type, json_token *Result)
+{
+    if((Source.Count - *At) >= KeywordRemaining.Count)
+    {
+        buffer Check = Source;
+        Check.Data += *At;
+        Check.Count = KeywordRemaining.Count;
+        if(AreEqual(Check, KeywordRemaining))
+        {
+            Result->Type = Type;
+            Result->Value.Count += KeywordRemaining.Count;
+            *At += KeywordRemaining.Count;
+        }
+    }
+}
+
+static void ParseNumber(buffer Source, u64 *AtResult, u8 Val, json_token *Result)
+{
+    // NOTE: Called with At just past the first character of the number, which is Val
+    u64 At = *AtResult;
+    
+    u64 Start = At - 1;
+    Result->Type = Token_number;
+    
+    // NOTE(casey): Move past a leading negative sign if one exists
+    if((Val == '-') && IsInBounds(Source, At))
+    {
+        Val = Source.Data[At++];
+    }
+    
+    // NOTE(casey): If the leading digit wasn't 0, parse any digits before the decimal point
+    if(Val != '0')
+    {
+        while(IsJSONDigit(Source, At))
+        {
+            ++At;
+        }
+    }
+    
+    // NOTE(casey): If there is a decimal point, parse any digits after the decimal point
+    if(IsInBounds(Source, At) && (Source.Data[At] == '.'))
+    {
+        ++At;
+        while(IsJSONDigit(Source, At))
+        {
+            ++At;
+        }
+    }
+    
+    // NOTE(casey): If it's in scientific notation, parse any digits after the "e"
+    if(IsInBounds(Source, At) && ((Source.Data[At] == 'e') || (Source.Data[At] == 'E')))
+    {
+        ++At;
+        
+        if(IsInBounds(Source, At) && ((Source.Data[At] == '+') || (Source.Data[At] == '-')))
+        {
+            ++At;
+        }
+        
+        while(IsJSONDigit(Source, At))
+        {
+            ++At;
+        }
+    }
+    
+    Result->Value.Count = At - Start;
+    
+    *AtResult = At;
+}
+
+static json_token GetJSONTokenByteAtATime(json_parser *Parser)
+{
+    json_token Result = {};
+    
+    buffer Source = Parser->Source;
+    u64 At = Parser->At;
+    
+    while(IsJSONWhitespace(Source, At))
+    {
+        ++At;
+    }
+    
+    if(IsInBounds(Source, At))
+    {
+        Result.Type = Token_error;
+        Result.Value.Count = 1;
+        Result.Value.Data = Source.Data + At;
+        u8 Val = Source.Data[At++];
+        switch(Val)
+        {
+            case '{': {Result.Type = Token_open_brace;} break;
+            case '[': {Result.Type = Token_open_bracket;} break;
+            case '}': {Result.Type = Token_close_brace;} break;
+            case ']': {Result.Type = Token_close_bracket;} break;
+            case ',': {Result.Type = Token_comma;} break;
+            case ':': {Result.Type = Token_colon;} break;
+            
+            case 'f':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("alse"), Token_false, &Result);
+            } break;
+            
+            case 'n':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("ull"), Token_null, &Result);
+            } break;
+            
+            case 't':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("rue"), Token_true, &Result);
+            } break;
+            
+            case '"':
+            {
+                Result.Type = Token_string_literal;
+                
+                u64 StringStart = At;
+                
+                while(IsInBounds(Source, At) && (Source.Data[At] != '"'))
+                {
+                    if(IsInBounds(Source, (At + 1)) &&
+                       (Source.Data[At] == '\\') &&
+                       (Source.Data[At + 1] == '"'))
+                    {
+                        // NOTE(casey): Skip escaped quotation marks
+                        ++At;
+                    }
+                    
+                    ++At;
+                }
+                
+                Result.Value.Data = Source.Data + StringStart;
+                Result.Value.Count = At - StringStart;
+                if(IsInBounds(Source, At))
+                {
+                    ++At;
+                }
+            } break;
+            
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            {
+                ParseNumber(Source, &At, Val, &Result);
+            } break;
+            
+            default:
+            {
+            } break;
+        }
+    }
+    
+    Parser->At = At;
+    
+    return Result;
+}
+
+static json_token GetJSONTokenFromIndex(json_parser *Parser)
+{
+    json_token Result = {};
+    
+    buffer Source = Parser->Source;
+    json_structural_indexer *Index = Parser->Index;
+    u64 At = NextStructural(Index);
+    
+    if(IsInBounds(Source, At))
+    {
+        Result.Type = Token_error;
+        Result.Value.Count = 1;
+        Result.Value.Data = Source.Data + At;
+        u8 Val = Source.Data[At++];
+        switch(Val)
+        {
+            case '{': {Result.Type = Token_open_brace;} break;
+            case '[': {Result.Type = Token_open_bracket;} break;
+            case '}': {Result.Type = Token_close_brace;} break;
+            case ']': {Result.Type = Token_close_bracket;} break;
+            case ',': {Result.Type = Token_comma;} break;
+            case ':': {Result.Type = Token_colon;} break;
+            
+            case 'f':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("alse"), Token_false, &Result);
+            } break;
+            
+            case 'n':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("ull"), Token_null, &Result);
+            } break;
+            
+            case 't':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("rue"), Token_true, &Result);
+            } break;
+            
+            case '"':
+            {
+                // NOTE: The index has already matched up the quotes, so the next structural
+                // is the closing quote (or the end of the input, if the string never closes)
+                Result.Type = Token_string_literal;
+                
+                u64 StringStart = At;
+                u64 StringEnd = NextStructural(Index);
+                
+                Result.Value.Data = Source.Data + StringStart;
+                Result.Value.Count = StringEnd - StringStart;
+                At = IsInBounds(Source, StringEnd) ? (StringEnd + 1) : StringEnd;
+            } break;
+            
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            {
+                ParseNumber(Source, &At, Val, &Result);
+            } break;
+            
+            default:
+            {
+            } break;
+        }
+    }
+    
+    Parser->At = At;
+    
+    return Result;
+}
+
+static json_token GetJSONToken(json_parser *Parser)
+{
+    json_token Result = Parser->Index ? GetJSONTokenFromIndex(Parser) : GetJSONTokenByteAtATime(Parser);
+    return Result;
+}
+
+static json_element *ParseJSONList(json_parser *Parser, json_token_type EndType, b32 HasLabels);
+static json_element *ParseJSONElement(json_parser *Parser, buffer Label, json_token Value)
+{
+    b32 Valid = true;
+    
+    json_element *SubElement = 0;
+    if(Value.Type == Token_open_bracket)
+    {
+        SubElement = ParseJSONList(Parser, Token_close_bracket, false);
+    }
+    else if(Value.Type == Token_open_brace)
+    {
+        SubElement = ParseJSONList(Parser, Token_close_brace, true);
+    }
+    else if((Value.Type == Token_string_literal) ||
+            (Value.Type == Token_true) ||
+            (Value.Type == Token_false) ||
+            (Value.Type == Token_null) ||
+            (Value.Type == Token_number))
+    {
+        // NOTE(casey): Nothing to do here, since there is no additional data
+    }
+    else
+    {
+        Valid = false;
+    }
+    
+    json_element *Result = 0;
+    
+    if(Valid)
+    {
+        Result = Parser->Arena ? PushStruct(Parser->Arena, json_element) : (json_element *)malloc(sizeof(json_element));
+        Result->Label = Label;
+        Result->Value = Value.Value;
+        Result->FirstSubElement = SubElement;
+        Result->FieldIndex = 0;
+        Result->NextSibling = 0;
+    }
+    
+    return Result;
+}
+
+static json_element *ParseJSONList(json_parser *Parser, json_token_type EndType, b32 HasLabels)
+{
+    json_element *FirstElement = {};
+    json_element *LastElement = {};
+    
+    while(IsParsing(Parser))
+    {
+        buffer Label = {};
+        json_token Value = GetJSONToken(Parser);
+        if(HasLabels)
+        {
+            if(Value.Type == Token_string_literal)
+            {
+                Label = Value.Value;
+                
+                json_token Colon = GetJSONToken(Parser);
+                if(Colon.Type == Token_colon)
+                {
+                    Value = GetJSONToken(Parser);
+                }
+                else
+                {
+                    Error(Parser, Colon, "Expected colon after field name");
+                }
+            }
+            else if(Value.Type != EndType)
+            {
+                Error(Parser, Value, "Unexpected token in JSON");
+            }
+        }
+        
+        json_element *Element = ParseJSONElement(Parser, Label, Value);
+        if(Element)
+        {
+            LastElement = (LastElement ? LastElement->NextSibling : FirstElement) = Element;
+        }
+        else if(Value.Type == EndType)
+        {
+            break;
+        }
+        else
+        {
+            Error(Parser, Value, "Unexpected token in JSON");
+        }
+        
+        json_token Comma = GetJSONToken(Parser);
+        if(Comma.Type == EndType)
+        {
+            break;
+        }
+        else if(Comma.Type != Token_comma)
+        {
+            Error(Parser, Comma, "Unexpected token in JSON");
+        }
+    }
+    
+    return FirstElement;
+}
+
+static json_element *ParseJSON(buffer InputJSON, arena *Arena = 0, b32 ByteAtATime = false)
+{
+    TimeFunction;
+    
+    json_structural_indexer Index;
+    
+    json_parser Parser = {};
+    Parser.Source = InputJSON;
+    Parser.Arena = Arena;
+    if(!ByteAtATime)
+    {
+        BeginStructuralIndex(&Index, InputJSON);
+        Parser.Index = &Index;
+    }
+    
+    json_element *Result = ParseJSONElement(&Parser, {}, GetJSONToken(&Parser));
+    return Result;
+}
+
+static void FreeJSON(json_element *Element)
+{
+    // NOTE: Only for trees parsed without an arena. Trees in an arena are freed by resetting it.
+    while(Element)
+    {
+        json_element *FreeElement = Element;
+        Element = Element->NextSibling;
+        
+        FreeJSON(FreeElement->FirstSubElement);
+        free(FreeElement);
+    }
+}
+
+#define JSON_FIELD_INDEX_THRESHOLD 32
+
+struct json_field_slot
+{
+    u64 Hash;
+    json_element *Element;
+};
+
+struct json_field_index
+{
+    u64 Mask;
+    json_field_slot *Slots;
+};
+
+static u64 HashJSONLabel(buffer Label)
+{
+    // NOTE: FNV-1a. Labels are short, so there's no point doing anything wider per step.
+    u64 Result = 0xcbf29ce484222325ull;
+    for(u64 Index = 0; Index < Label.Count; ++Index)
+    {
+        Result ^= Label.Data[Index];
+        Result *= 0x100000001b3ull;
+    }
+    
+    return Result;
+}
+
+static json_field_index *BuildFieldIndex(json_element *Object, arena *Arena)
+{
+    u64 ChildCount = 0;
+    for(json_element *Child = Object->FirstSubElement; Child; Child = Child->NextSibling)
+    {
+        ++ChildCount;
+    }
+    
+    // NOTE: At least twice as many slots as children keeps the probe sequences short
+    u64 SlotCount = 16;
+    while(SlotCount < 2*ChildCount)
+    {
+        SlotCount *= 2;
+    }
+    
+    json_field_index *Result = PushStruct(Arena, json_field_index);
+    json_field_slot *Slots = PushArray(Arena, SlotCount, json_field_slot);
+    if(Result && Slots)
+    {
+        memset(Slots, 0, SlotCount*sizeof(json_field_slot));
+        Result->Mask = SlotCount - 1;
+        Result->Slots = Slots;
+        
+        for(json_element *Child = Object->FirstSubElement; Child; Child = Child->NextSibling)
+        {
+            u64 Hash = HashJSONLabel(Child->Label);
+            u64 SlotIndex = Hash & Result->Mask;
+            
+            // NOTE: If a label appears more than once, the first one keeps the slot, which
+            // matches what walking the list finds
+            while(Slots[SlotIndex].Element &&
+                  !((Slots[SlotIndex].Hash == Hash) && AreEqual(Slots[SlotIndex].Element->Label, Child->Label)))
+            {
+                SlotIndex = (SlotIndex + 1) & Result->Mask;
+            }
+            
+            if(!Slots[SlotIndex].Element)
+            {
+                Slots[SlotIndex].Hash = Hash;
+                Slots[SlotIndex].Element = Child;
+            }
+        }
+    }
+    else
+    {
+        Result = 0;
+    }
+    
+    return Result;
+}
+
+static json_element *LookupElement(json_element *Object, buffer ElementName, arena *Arena = 0)
+{
+    // NOTE: Pass the arena the tree was parsed into to allow building an index for Object
+    json_element *Result = 0;
+    
+    if(Object)
+    {
+        json_field_index *Index = Object->FieldIndex;
+        if(Index)
+        {
+            u64 Hash = HashJSONLabel(ElementName);
+            for(u64 SlotIndex = Hash & Index->Mask;
+                Index->Slots[SlotIndex].Element;
+                SlotIndex = (SlotIndex + 1) & Index->Mask)
+            {
+                json_field_slot *Slot = Index->Slots + SlotIndex;
+                if((Slot->Hash == Hash) && AreEqual(Slot->Element->Label, ElementName))
+                {
+                    Result = Slot->Element;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            u64 SearchCount = 0;
+            for(json_element *Search = Object->FirstSubElement; Search; Search = Search->NextSibling)
+            {
+                if(AreEqual(Search->Label, ElementName))
+                {
+                    Result = Search;
+                    break;
+                }
+                
+                ++SearchCount;
+            }
+            
+            if(Arena && (SearchCount >= JSON_FIELD_INDEX_THRESHOLD))
+            {
+                Object->FieldIndex = BuildFieldIndex(Object, Arena);
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static f64 ConvertElementToF64(json_element *Object, buffer ElementName, arena *Arena = 0)
+{
+    f64 Result = 0.0;
+    
+    json_element *Element = LookupElement(Object, ElementName, Arena);
+    if(Element)
+    {
+        Result = ConvertJSONToF64Exact(Element->Value);
+    }
+    
+    return Result;
+}
+
+static u64 ParseHaversinePairs(buffer InputJSON, u64 MaxPairCount, haversine_pair *Pairs, arena *Arena = 0)
+{
+    // NOTE: If an arena is passed, it is used as scratch space for the tree and is reset before returning
+    TimeFunction;
+    
+    u64 PairCount = 0;
+    
+    json_element *JSON = ParseJSON(InputJSON, Arena);
+    
+    json_element *PairsArray = LookupElement(JSON, CONSTANT_STRING("pairs"));
+    if(PairsArray)
+    {
+        TimeBlock("Lookup and Convert");
+        
+        for(json_element *Element = PairsArray->FirstSubElement;
+            Element && (PairCount < MaxPairCount);
+            Element = Element->NextSibling)
+        {
+            haversine_pair *Pair = Pairs + PairCount++;
+            
+            Pair->X0 = ConvertElementToF64(Element, CONSTANT_STRING("x0"));
+            Pair->Y0 = ConvertElementToF64(Element, CONSTANT_STRING("y0"));
+            Pair->X1 = ConvertElementToF64(Element, CONSTANT_STRING("x1"));
+            Pair->Y1 = ConvertElementToF64(Element, CONSTANT_STRING("y1"));
+        }
+    }
+    
+    if(Arena)
+    {
+        TimeBlock("ResetArena");
+        ResetArena(Arena);
+    }
+    else
+    {
+        TimeBlock("FreeJSON");
+        FreeJSON(JSON);
+    }
+    
+    return PairCount;
+}
@@ -0,0 +1,216 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 133
+   ======================================================================== */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0103_repetition_tester.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0132_field_index_json_parser.cpp"
+
+/* NOTE: Builds a config-style object, {"setting0000":0, "setting0001":1, ...}, and then looks
+   up every one of its keys, in a scrambled order, with and without a field index. */
+
+struct lookup_parameters
+{
+    u64 KeyCount;
+    buffer *Keys;
+    
+    json_element *LinearObject;
+    json_element *IndexedObject;
+    arena *IndexedArena;
+    
+    f64 Sink;
+};
+
+typedef void lookup_test_func(repetition_tester *Tester, lookup_parameters *Params);
+
+static void LookupAllKeys(repetition_tester *Tester, lookup_parameters *Params, json_element *Object, arena *Arena)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        f64 Sum = 0.0;
+        for(u64 KeyIndex = 0; KeyIndex < Params->KeyCount; ++KeyIndex)
+        {
+            Sum += ConvertElementToF64(Object, Params->Keys[KeyIndex], Arena);
+        }
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->KeyCount*sizeof(json_element));
+        
+        // NOTE: Written out so the loop above can't be optimized away
+        Params->Sink = Sum;
+    }
+}
+
+static void LookupLinear(repetition_tester *Tester, lookup_parameters *Params)
+{
+    LookupAllKeys(Tester, Params, Params->LinearObject, 0);
+}
+
+static void LookupIndexed(repetition_tester *Tester, lookup_parameters *Params)
+{
+    LookupAllKeys(Tester, Params, Params->IndexedObject, Params->IndexedArena);
+}
+
+struct test_function
+{
+    char const *Name;
+    lookup_test_func *Func;
+};
+test_function TestFunctions[] =
+{
+    {"walk the fields", LookupLinear},
+    {"field index", LookupIndexed},
+};
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&BeginProfile;
+    (void)&EndAndPrintProfile;
+    (void)&FreeJSON;
+    (void)&ParseHaversinePairs;
+    (void)&TryToEnableLargePages;
+    (void)&FreeBuffer;
+    
+    u64 KeyCount = (ArgCount == 2) ? strtoull(Args[1], 0, 10) : 1000;
+    if(KeyCount && (KeyCount <= 1000000))
+    {
+        u64 CPUTimerFreq = EstimateCPUTimerFreq();
+        
+        u64 const MaxKeyLength = 32;
+        buffer JSON = AllocateBuffer(KeyCount*(MaxKeyLength + 16) + 16);
+        buffer KeyText = AllocateBuffer(KeyCount*MaxKeyLength);
+        buffer *Keys = (buffer *)malloc(KeyCount*sizeof(buffer));
+        
+        if(JSON.Data && KeyText.Data && Keys)
+        {
+            u64 At = 0;
+            JSON.Data[At++] = '{';
+            for(u64 KeyIndex = 0; KeyIndex < KeyCount; ++KeyIndex)
+            {
+                At += sprintf((char *)JSON.Data + At, "%s\"setting%04llu\":%llu", KeyIndex ? ", " : "", KeyIndex, KeyIndex);
+            }
+            JSON.Data[At++] = '}';
+            JSON.Count = At;
+            
+            // NOTE: Keys are looked up in a scrambled order (a stride coprime with the count), so that
+            // walking the fields doesn't get the unrealistic benefit of always finding the next one early
+            u64 Stride = 7919;
+            while((KeyCount % Stride) == 0)
+            {
+                ++Stride;
+            }
+            for(u64 KeyIndex = 0; KeyIndex < KeyCount; ++KeyIndex)
+            {
+                u64 Setting = (KeyIndex*Stride) % KeyCount;
+                Keys[KeyIndex].Data = KeyText.Data + KeyIndex*MaxKeyLength;
+                Keys[KeyIndex].Count = sprintf((char *)Keys[KeyIndex].Data, "setting%04llu", Setting);
+            }
+            
+            arena LinearArena = {};
+            arena IndexedArena = {};
+            
+            lookup_parameters Params = {};
+            Params.KeyCount = KeyCount;
+            Params.Keys = Keys;
+            Params.LinearObject = ParseJSON(JSON, &LinearArena);
+            Params.IndexedObject = ParseJSON(JSON, &IndexedArena);
+            Params.IndexedArena = &IndexedArena;
+            
+            // NOTE: Check that both ways find the same thing for every key before timing them
+            u64 MismatchCount = 0;
+            for(u64 KeyIndex = 0; KeyIndex < KeyCount; ++KeyIndex)
+            {
+                json_element *Linear = LookupElement(Params.LinearObject, Keys[KeyIndex]);
+                json_element *Indexed = LookupElement(Params.IndexedObject, Keys[KeyIndex], &IndexedArena);
+                if(!Linear || !Indexed || !AreEqual(Linear->Value, Indexed->Value))
+                {
+                    ++MismatchCount;
+                }
+            }
+            
+            printf("Keys: %llu, lookup mismatches: %llu, field index %s (%llu arena bytes)\n",
+                   KeyCount, MismatchCount, Params.IndexedObject->FieldIndex ? "built" : "not built",
+                   IndexedArena.TotalUsed - LinearArena.TotalUsed);
+            
+            repetition_tester Testers[ArrayCount(TestFunctions)] = {};
+            
+            for(;;)
+            {
+                for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+                {
+                    repetition_tester *Tester = Testers + FuncIndex;
+                    test_function TestFunc = TestFunctions[FuncIndex];
+                    
+                    printf("\n--- %s ---\n", TestFunc.Name);
+                    NewTestWave(Tester, KeyCount*sizeof(json_element), CPUTimerFreq);
+                    TestFunc.Func(Tester, &Params);
+                }
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unable to allocate memory for %llu keys.\n", KeyCount);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [key count, up to 1000000]\n", Args[0]);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,369 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 134
+   ======================================================================== */
+
+/* NOTE: Parses the "pairs" array on several threads. The bytes of the array are cut into
+   one range per thread, and each cut is moved forward to the next `}, {` so that it lands
+   on the start of an element. Each thread parses the elements starting in its range (the
+   last one may run past the end of the range) into its own slice of the output, and the
+   slices are then moved down next to each other.
+   
+   A cut can land inside a string or a nested value that happens to contain `}, {`. That is
+   caught afterwards: the thread before the cut parses elements in order from a known-good
+   starting point, so it has to stop exactly at the cut if the cut was at a real element.
+   If any cut doesn't check out, or anything else is unusual, the whole input is parsed
+   serially instead, so the result is always identical to ParseHaversinePairs. */
+
+#if _WIN32
+
+typedef HANDLE os_thread;
+
+struct os_thread_start
+{
+    void (*Func)(void *Param);
+    void *Param;
+};
+
+static DWORD WINAPI OSThreadEntry(LPVOID Param)
+{
+    os_thread_start *Start = (os_thread_start *)Param;
+    Start->Func(Start->Param);
+    return 0;
+}
+
+static os_thread StartOSThread(os_thread_start *Start)
+{
+    os_thread Result = CreateThread(0, 0, OSThreadEntry, Start, 0, 0);
+    return Result;
+}
+
+static void JoinOSThread(os_thread Thread)
+{
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+}
+
+#else
+
+#include <pthread.h>
+
+typedef pthread_t os_thread;
+
+struct os_thread_start
+{
+    void (*Func)(void *Param);
+    void *Param;
+};
+
+static void *OSThreadEntry(void *Param)
+{
+    os_thread_start *Start = (os_thread_start *)Param;
+    Start->Func(Start->Param);
+    return 0;
+}
+
+static os_thread StartOSThread(os_thread_start *Start)
+{
+    os_thread Result = {};
+    pthread_create(&Result, 0, OSThreadEntry, Start);
+    return Result;
+}
+
+static void JoinOSThread(os_thread Thread)
+{
+    pthread_join(Thread, 0);
+}
+
+#endif
+
+#define MAX_PARSE_THREAD_COUNT 64
+
+struct pair_chunk
+{
+    // NOTE: Inputs. Offsets are from the start of the input.
+    buffer InputJSON;
+    u64 Start;
+    u64 OnePastEnd;
+    haversine_pair *Pairs;
+    u64 MaxPairCount;
+    
+    // NOTE: Outputs
+    u64 PairCount;
+    u64 StoppedAt;
+    b32 ReachedEndOfArray;
+    b32 Failed;
+    
+    os_thread_start ThreadStart;
+};
+
+static void ParsePairChunk(void *Param)
+{
+    // NOTE: Runs on its own thread, so nothing in here may touch the profiler
+    pair_chunk *Chunk = (pair_chunk *)Param;
+    
+    buffer Source = Chunk->InputJSON;
+    Source.Data += Chunk->Start;
+    Source.Count -= Chunk->Start;
+    u64 RangeCount = Chunk->OnePastEnd - Chunk->Start;
+    
+    json_structural_indexer Index;
+    BeginStructuralIndex(&Index, Source);
+    
+    arena Arena = {};
+    
+    // NOTE: A chunk that starts in the wrong place fails on perfectly good JSON, so nothing is
+    // reported here. Real errors are reported by the serial parse the caller falls back to.
+    json_parser Parser = {};
+    Parser.Source = Source;
+    Parser.Arena = &Arena;
+    Parser.Index = &Index;
+    Parser.Quiet = true;
+    
+    json_token Value = GetJSONToken(&Parser);
+    for(;;)
+    {
+        if((Value.Type == Token_end_of_stream) || (Value.Type == Token_error))
+        {
+            Chunk->Failed = true;
+            break;
+        }
+        
+        u64 ValueAt = Value.Value.Data - Source.Data;
+        if(Value.Type == Token_close_bracket)
+        {
+            Chunk->ReachedEndOfArray = true;
+            Chunk->StoppedAt = Chunk->Start + ValueAt;
+            break;
+        }
+        
+        if(ValueAt >= RangeCount)
+        {
+            // NOTE: This element belongs to the next chunk
+            Chunk->StoppedAt = Chunk->Start + ValueAt;
+            break;
+        }
+        
+        json_element *Element = ParseJSONElement(&Parser, {}, Value);
+        if(!Element || Parser.HadError || (Chunk->PairCount == Chunk->MaxPairCount))
+        {
+            Chunk->Failed = true;
+            break;
+        }
+        
+        haversine_pair *Pair = Chunk->Pairs + Chunk->PairCount++;
+        Pair->X0 = ConvertElementToF64(Element, CONSTANT_STRING("x0"));
+        Pair->Y0 = ConvertElementToF64(Element, CONSTANT_STRING("y0"));
+        Pair->X1 = ConvertElementToF64(Element, CONSTANT_STRING("x1"));
+        Pair->Y1 = ConvertElementToF64(Element, CONSTANT_STRING("y1"));
+        
+        ResetArena(&Arena);
+        
+        json_token Separator = GetJSONToken(&Parser);
+        if(Separator.Type == Token_comma)
+        {
+            Value = GetJSONToken(&Parser);
+        }
+        else if(Separator.Type == Token_close_bracket)
+        {
+            Value = Separator;
+        }
+        else
+        {
+            Chunk->Failed = true;
+            break;
+        }
+    }
+    
+    FreeArena(&Arena);
+}
+
+static u64 FindPairsArray(buffer InputJSON)
+{
+    // NOTE: Returns the offset just past the [ of the top-level "pairs" array, or 0 if the input
+    // isn't shaped like that. Fields before "pairs" are parsed and thrown away.
+    u64 Result = 0;
+    
+    arena Arena = {};
+    
+    json_parser Parser = {};
+    Parser.Source = InputJSON;
+    Parser.Arena = &Arena;
+    Parser.Quiet = true;
+    
+    if(GetJSONToken(&Parser).Type == Token_open_brace)
+    {
+        while(IsParsing(&Parser))
+        {
+            json_token Key = GetJSONToken(&Parser);
+            if((Key.Type != Token_string_literal) || (GetJSONToken(&Parser).Type != Token_colon))
+            {
+                break;
+            }
+            
+            json_token Value = GetJSONToken(&Parser);
+            if(AreEqual(Key.Value, CONSTANT_STRING("pairs")))
+            {
+                if(Value.Type == Token_open_bracket)
+                {
+                    Result = Parser.At;
+                }
+                break;
+            }
+            
+            if(!ParseJSONElement(&Parser, {}, Value) || (GetJSONToken(&Parser).Type != Token_comma))
+            {
+                break;
+            }
+        }
+    }
+    
+    FreeArena(&Arena);
+    
+    return Result;
+}
+
+static u64 FindElementBoundary(buffer Source, u64 At)
+{
+    // NOTE: Returns the offset of the { in the next `}, {` at or after At, or Source.Count if there isn't one
+    u64 Result = Source.Count;
+    
+    for(; At < Source.Count; ++At)
+    {
+        if(Source.Data[At] == '}')
+        {
+            u64 Check = At + 1;
+            while(IsJSONWhitespace(Source, Check)) {++Check;}
+            if((Check < Source.Count) && (Source.Data[Check] == ','))
+            {
+                ++Check;
+                while(IsJSONWhitespace(Source, Check)) {++Check;}
+                if((Check < Source.Count) && (Source.Data[Check] == '{'))
+                {
+                    Result = Check;
+                    break;
+                }
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static u64 ParseHaversinePairsParallel(buffer InputJSON, u64 MaxPairCount, haversine_pair *Pairs, u32 ThreadCount)
+{
+    TimeFunction;
+    
+    u64 PairCount = 0;
+    b32 Parallel = false;
+    
+    if(ThreadCount > MAX_PARSE_THREAD_COUNT)
+    {
+        ThreadCount = MAX_PARSE_THREAD_COUNT;
+    }
+    
+    u64 ArrayStart = (ThreadCount > 1) ? FindPairsArray(InputJSON) : 0;
+    if(ArrayStart)
+    {
+        // NOTE: Each chunk's slice of Pairs starts at the same fraction of the array as its bytes do
+        // in the input. Since every pair takes at least MinimumJSONPairEncoding bytes, a chunk can't
+        // fill more than its share unless the input isn't really pairs, and then it just fails.
+        u32 const MinimumJSONPairEncoding = 6*4;
+        
+        pair_chunk Chunks[MAX_PARSE_THREAD_COUNT] = {};
+        os_thread Threads[MAX_PARSE_THREAD_COUNT] = {};
+        
+        u64 ArrayByteCount = InputJSON.Count - ArrayStart;
+        u32 ChunkCount = 0;
+        u64 ChunkStart = ArrayStart;
+        for(u32 ThreadIndex = 0; (ThreadIndex < ThreadCount) && (ChunkStart < InputJSON.Count); ++ThreadIndex)
+        {
+            u64 OnePastEnd = InputJSON.Count;
+            if(ThreadIndex < (ThreadCount - 1))
+            {
+                OnePastEnd = FindElementBoundary(InputJSON, ArrayStart + (ArrayByteCount*(ThreadIndex + 1)) / ThreadCount);
+                if(OnePastEnd <= ChunkStart)
+                {
+                    continue;
+                }
+            }
+            
+            u64 FirstPair = (ChunkStart - ArrayStart) / MinimumJSONPairEncoding;
+            u64 OnePastLastPair = (OnePastEnd - ArrayStart) / MinimumJSONPairEncoding;
+            if(OnePastLastPair > MaxPairCount)
+            {
+                OnePastLastPair = MaxPairCount;
+            }
+            
+            pair_chunk *Chunk = Chunks + ChunkCount++;
+            Chunk->InputJSON = InputJSON;
+            Chunk->Start = ChunkStart;
+            Chunk->OnePastEnd = OnePastEnd;
+            Chunk->Pairs = Pairs + FirstPair;
+            Chunk->MaxPairCount = (OnePastLastPair > FirstPair) ? (OnePastLastPair - FirstPair) : 0;
+            
+            ChunkStart = OnePastEnd;
+        }
+        
+        // NOTE: Chunk 0 runs on this thread
+        for(u32 ChunkIndex = 1; ChunkIndex < ChunkCount; ++ChunkIndex)
+        {
+            pair_chunk *Chunk = Chunks + ChunkIndex;
+            Chunk->ThreadStart.Func = ParsePairChunk;
+            Chunk->ThreadStart.Param = Chunk;
+            Threads[ChunkIndex] = StartOSThread(&Chunk->ThreadStart);
+        }
+        
+        ParsePairChunk(Chunks + 0);
+        
+        for(u32 ChunkIndex = 1; ChunkIndex < ChunkCount; ++ChunkIndex)
+        {
+            JoinOSThread(Threads[ChunkIndex]);
+        }
+        
+        TimeBlock("Compact");
+        
+        // NOTE: Chunks after the one that found the ], if any, were parsing whatever followed the array
+        for(u32 ChunkIndex = 0; ChunkIndex < ChunkCount; ++ChunkIndex)
+        {
+            pair_chunk *Chunk = Chunks + ChunkIndex;
+            if(Chunk->Failed ||
+               (!Chunk->ReachedEndOfArray && (Chunk->StoppedAt != Chunk->OnePastEnd)))
+            {
+                break;
+            }
+            
+            u64 CopyCount = Chunk->PairCount;
+            if(CopyCount > (MaxPairCount - PairCount))
+            {
+                CopyCount = MaxPairCount - PairCount;
+            }
+            memmove(Pairs + PairCount, Chunk->Pairs, CopyCount*sizeof(haversine_pair));
+            PairCount += CopyCount;
+            
+            if(Chunk->ReachedEndOfArray)
+            {
+                Parallel = true;
+                break;
+            }
+        }
+    }
+    
+    if(!Parallel)
+    {
+        PairCount = ParseHaversinePairs(InputJSON, MaxPairCount, Pairs);
+    }
+    
+    return PairCount;
+}
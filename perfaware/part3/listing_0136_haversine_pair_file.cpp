@@ -0,0 +1,179 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 136
+   ======================================================================== */
+
+/* NOTE: Reads the binary pair files that the generator (part2 listing 66) writes when it is
+   given "binary". The file is mapped read-only, and the four coordinate columns are used
+   straight from the mapping. There is no parse and no copy, and pages are only read from
+   disk (or the file cache) when they are first touched. The header has to stay in sync
+   with the generator. */
+
+#if _WIN32
+
+#include <windows.h>
+
+#else
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+#define HAVERSINE_PAIR_FILE_MAGIC 0x52505648 // NOTE: "HVPR" in little-endian
+#define HAVERSINE_PAIR_FILE_VERSION 1
+#define HAVERSINE_PAIR_LAYOUT_F64_COLUMNS 1
+#define HAVERSINE_PAIR_COLUMN_ALIGNMENT 64
+
+struct haversine_pair_file_header
+{
+    u32 Magic;
+    u32 Version;
+    u64 PairCount;
+    u32 Layout;
+    u32 ColumnCount;
+    u64 ColumnOffset[4]; // NOTE: Byte offsets from the start of the file, X0/Y0/X1/Y1
+    u64 Reserved;
+};
+
+struct haversine_pair_columns
+{
+    u64 PairCount;
+    f64 *X0;
+    f64 *Y0;
+    f64 *X1;
+    f64 *Y1;
+};
+
+#if _WIN32
+
+static buffer MapFileReadOnly(char *FileName)
+{
+    buffer Result = {};
+    
+    HANDLE File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(File != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER Size;
+        if(GetFileSizeEx(File, &Size) && Size.QuadPart)
+        {
+            // NOTE: The view keeps the mapping (and the file) alive, so both handles can be closed right away
+            HANDLE Mapping = CreateFileMappingA(File, 0, PAGE_READONLY, 0, 0, 0);
+            if(Mapping)
+            {
+                Result.Data = (u8 *)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+                if(Result.Data)
+                {
+                    Result.Count = Size.QuadPart;
+                }
+                
+                CloseHandle(Mapping);
+            }
+        }
+        
+        CloseHandle(File);
+    }
+    
+    return Result;
+}
+
+static void UnmapFile(buffer *Mapped)
+{
+    if(Mapped->Data)
+    {
+        UnmapViewOfFile(Mapped->Data);
+    }
+    *Mapped = {};
+}
+
+#else
+
+static buffer MapFileReadOnly(char *FileName)
+{
+    buffer Result = {};
+    
+    int File = open(FileName, O_RDONLY);
+    if(File != -1)
+    {
+        struct stat Stat;
+        if((fstat(File, &Stat) == 0) && Stat.st_size)
+        {
+            void *Memory = mmap(0, Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+            if(Memory != MAP_FAILED)
+            {
+                Result.Data = (u8 *)Memory;
+                Result.Count = Stat.st_size;
+            }
+        }
+        
+        close(File);
+    }
+    
+    return Result;
+}
+
+static void UnmapFile(buffer *Mapped)
+{
+    if(Mapped->Data)
+    {
+        munmap(Mapped->Data, Mapped->Count);
+    }
+    *Mapped = {};
+}
+
+#endif
+
+static b32 IsHaversinePairFile(buffer File)
+{
+    b32 Result = ((File.Count >= sizeof(haversine_pair_file_header)) &&
+                  (((haversine_pair_file_header *)File.Data)->Magic == HAVERSINE_PAIR_FILE_MAGIC));
+    return Result;
+}
+
+static haversine_pair_columns GetHaversinePairColumns(buffer File)
+{
+    // NOTE: Returns a PairCount of 0 if the header is wrong in any way, including columns that
+    // would run past the end of the file or aren't aligned for f64 loads
+    haversine_pair_columns Result = {};
+    
+    if(IsHaversinePairFile(File))
+    {
+        haversine_pair_file_header *Header = (haversine_pair_file_header *)File.Data;
+        b32 Valid = ((Header->Version == HAVERSINE_PAIR_FILE_VERSION) &&
+                     (Header->Layout == HAVERSINE_PAIR_LAYOUT_F64_COLUMNS) &&
+                     (Header->ColumnCount == 4) &&
+                     (Header->PairCount <= (File.Count / sizeof(f64))));
+        
+        for(u32 Column = 0; Valid && (Column < 4); ++Column)
+        {
+            u64 Offset = Header->ColumnOffset[Column];
+            Valid = (((Offset % HAVERSINE_PAIR_COLUMN_ALIGNMENT) == 0) &&
+                     (Offset >= sizeof(haversine_pair_file_header)) &&
+                     (Offset <= File.Count) &&
+                     (Header->PairCount <= ((File.Count - Offset) / sizeof(f64))));
+        }
+        
+        if(Valid)
+        {
+            Result.PairCount = Header->PairCount;
+            Result.X0 = (f64 *)(File.Data + Header->ColumnOffset[0]);
+            Result.Y0 = (f64 *)(File.Data + Header->ColumnOffset[1]);
+            Result.X1 = (f64 *)(File.Data + Header->ColumnOffset[2]);
+            Result.Y1 = (f64 *)(File.Data + Header->ColumnOffset[3]);
+        }
+    }
+    
+    return Result;
+}
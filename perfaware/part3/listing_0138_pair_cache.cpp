@@ -0,0 +1,208 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 138
+   ======================================================================== */
+
+/* NOTE: A cache of parsed pairs that sits next to the JSON it came from. The cache file is
+   the same column layout as a binary pair file (listing 136), with a bigger header that also
+   records the size, modification time and a hash of the JSON. When all three still match,
+   the cache is mapped and used in place of parsing. Otherwise it is stale, and it gets
+   rewritten after the next parse.
+   
+   The hash has to read every byte of the JSON, but it does it several times faster than
+   any parse does. It's there because a modification time only has whole-second
+   resolution on some file systems, and copying a file can preserve it. */
+
+#define PAIR_CACHE_MARKER 0x43505648 // NOTE: "HVPC" in little-endian
+#define PAIR_CACHE_HEADER_SIZE 128
+
+struct pair_cache_key
+{
+    u64 SourceSize;
+    u64 SourceModifyTime;
+    u64 SourceHash;
+};
+
+struct pair_cache_header
+{
+    // NOTE: Pairs.Reserved holds PAIR_CACHE_MARKER, which is what tells a cache apart from a
+    // generator file, where the X0 column starts right after the 64-byte header
+    haversine_pair_file_header Pairs;
+    pair_cache_key Key;
+    u8 Padding[PAIR_CACHE_HEADER_SIZE - sizeof(haversine_pair_file_header) - sizeof(pair_cache_key)];
+};
+
+static u64 RotateLeft64(u64 Value, u32 Shift)
+{
+    u64 Result = (Value << Shift) | (Value >> (64 - Shift));
+    return Result;
+}
+
+static u64 HashSourceBytes(buffer Source)
+{
+    TimeBandwidth(__func__, Source.Count);
+    
+    // NOTE: Four independent lanes of the xxHash64 round, so the multiplies don't wait on each other
+    u64 const Prime1 = 0x9E3779B185EBCA87ull;
+    u64 const Prime2 = 0xC2B2AE3D27D4EB4Full;
+    u64 const Prime3 = 0x165667B19E3779F9ull;
+    
+    u64 Lanes[4] = {Prime1 + Prime2, Prime2, 0, (u64)0 - Prime1};
+    
+    u64 At = 0;
+    for(; (At + 32) <= Source.Count; At += 32)
+    {
+        for(u32 Lane = 0; Lane < 4; ++Lane)
+        {
+            u64 Value;
+            memcpy(&Value, Source.Data + At + 8*Lane, sizeof(Value));
+            Lanes[Lane] = RotateLeft64(Lanes[Lane] + Value*Prime2, 31)*Prime1;
+        }
+    }
+    
+    u64 Result = (RotateLeft64(Lanes[0], 1) + RotateLeft64(Lanes[1], 7) +
+                  RotateLeft64(Lanes[2], 12) + RotateLeft64(Lanes[3], 18));
+    Result += Source.Count;
+    
+    for(; At < Source.Count; ++At)
+    {
+        Result = RotateLeft64(Result ^ (Source.Data[At]*Prime3), 11)*Prime1;
+    }
+    
+    Result ^= Result >> 33;
+    Result *= Prime2;
+    Result ^= Result >> 29;
+    Result *= Prime3;
+    Result ^= Result >> 32;
+    
+    return Result;
+}
+
+static pair_cache_key GetPairCacheKey(char *SourceName, buffer Source)
+{
+    pair_cache_key Result = {};
+
+#if _WIN32
+    struct __stat64 Stat;
+    if(_stat64(SourceName, &Stat) == 0)
+#else
+    struct stat Stat;
+    if(stat(SourceName, &Stat) == 0)
+#endif
+    {
+        Result.SourceSize = Stat.st_size;
+        Result.SourceModifyTime = Stat.st_mtime;
+        Result.SourceHash = HashSourceBytes(Source);
+    }
+    
+    return Result;
+}
+
+static haversine_pair_columns GetCachedPairColumns(buffer Cache, pair_cache_key Key)
+{
+    // NOTE: Returns a PairCount of 0 for a missing or stale cache
+    haversine_pair_columns Result = {};
+    
+    if(IsHaversinePairFile(Cache) && (Cache.Count >= sizeof(pair_cache_header)))
+    {
+        pair_cache_header *Header = (pair_cache_header *)Cache.Data;
+        if((Header->Pairs.Reserved == PAIR_CACHE_MARKER) &&
+           (Header->Key.SourceSize == Key.SourceSize) &&
+           (Header->Key.SourceModifyTime == Key.SourceModifyTime) &&
+           (Header->Key.SourceHash == Key.SourceHash))
+        {
+            Result = GetHaversinePairColumns(Cache);
+        }
+    }
+    
+    return Result;
+}
+
+static b32 WritePairCache(char *CacheName, pair_cache_key Key, u64 PairCount, haversine_pair *Pairs)
+{
+    TimeBandwidth(__func__, PairCount*sizeof(haversine_pair));
+    
+    // NOTE: Written to a temporary file and renamed over the old cache, so a run that has the old
+    // one mapped keeps its pages, and a crash mid-write leaves the old cache in place
+    b32 Result = false;
+    
+    char TempName[4096];
+    int NameLength = snprintf(TempName, sizeof(TempName), "%s.tmp", CacheName);
+    if((NameLength > 0) && (NameLength < (int)sizeof(TempName)))
+    {
+        FILE *File = fopen(TempName, "wb");
+        if(File)
+        {
+            pair_cache_header Header = {};
+            Header.Pairs.Version = HAVERSINE_PAIR_FILE_VERSION;
+            Header.Pairs.PairCount = PairCount;
+            Header.Pairs.Layout = HAVERSINE_PAIR_LAYOUT_F64_COLUMNS;
+            Header.Pairs.ColumnCount = 4;
+            Header.Pairs.Reserved = PAIR_CACHE_MARKER;
+            Header.Key = Key;
+            
+            // NOTE: The header goes in with a zero magic first, and is only rewritten with the real magic
+            // once every column is out, so a half-written cache never looks valid
+            b32 Written = (fwrite(&Header, sizeof(Header), 1, File) == 1);
+            
+            u64 Offset = sizeof(Header);
+            for(u32 Column = 0; Written && (Column < 4); ++Column)
+            {
+                Header.Pairs.ColumnOffset[Column] = Offset;
+                
+                f64 Block[4096];
+                u64 BlockCount = 0;
+                for(u64 PairIndex = 0; Written && (PairIndex < PairCount); ++PairIndex)
+                {
+                    Block[BlockCount++] = ((f64 *)(Pairs + PairIndex))[Column];
+                    if((BlockCount == ArrayCount(Block)) || ((PairIndex + 1) == PairCount))
+                    {
+                        Written = (fwrite(Block, sizeof(f64), BlockCount, File) == BlockCount);
+                        BlockCount = 0;
+                    }
+                }
+                
+                Offset += PairCount*sizeof(f64);
+                
+                u8 Zero[HAVERSINE_PAIR_COLUMN_ALIGNMENT] = {};
+                u64 PadCount = (HAVERSINE_PAIR_COLUMN_ALIGNMENT - (Offset % HAVERSINE_PAIR_COLUMN_ALIGNMENT)) % HAVERSINE_PAIR_COLUMN_ALIGNMENT;
+                if(Written && PadCount)
+                {
+                    Written = (fwrite(Zero, PadCount, 1, File) == 1);
+                }
+                Offset += PadCount;
+            }
+            
+            if(Written)
+            {
+                Header.Pairs.Magic = HAVERSINE_PAIR_FILE_MAGIC;
+                Written = ((fseek(File, 0, SEEK_SET) == 0) && (fwrite(&Header, sizeof(Header), 1, File) == 1));
+            }
+            
+            Written = (fclose(File) == 0) && Written;
+
+#if _WIN32
+            Result = Written && MoveFileExA(TempName, CacheName, MOVEFILE_REPLACE_EXISTING);
+#else
+            Result = Written && (rename(TempName, CacheName) == 0);
+#endif
+            if(!Result)
+            {
+                remove(TempName);
+            }
+        }
+    }
+    
+    return Result;
+}
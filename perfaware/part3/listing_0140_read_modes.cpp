@@ -0,0 +1,297 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 140
+   ======================================================================== */
+
+/* NOTE: Different ways of getting a file into memory, so they can be compared in the profile:
+       
+       fread      - malloc + fread, the way every haversine main has done it so far. The
+                    fresh buffer page faults as fread copies into it.
+       mmap       - map the file with MAP_POPULATE, so the kernel wires up every page of
+                    the file cache during the mmap call and there is no copy at all.
+       mmapadvise - map the file lazily, but tell the kernel the access is sequential (so
+                    it reads ahead aggressively) and that huge pages are welcome. The
+                    page faults don't happen here; they show up in whatever touches the
+                    memory first, which is the parser.
+       prefault   - read into a buffer from OSAllocate (large pages if the OS gives them
+                    out), after touching every page of it, so the copy itself never faults.
+   
+   On Windows, mmap touches every page after mapping instead of MAP_POPULATE, and mmapadvise
+   opens the file with FILE_FLAG_SEQUENTIAL_SCAN, since there is no madvise. Needs listings
+   123 (OSAllocate) and 136 (UnmapFile). */
+
+enum read_mode
+{
+    ReadMode_fread,
+    ReadMode_mmap,
+    ReadMode_mmapadvise,
+    ReadMode_prefault,
+    
+    ReadMode_Count,
+};
+
+static char const *ReadModeNames[ReadMode_Count] =
+{
+    "fread",
+    "mmap",
+    "mmapadvise",
+    "prefault",
+};
+
+struct input_file
+{
+    buffer Data;
+    read_mode Mode;
+    u64 AllocatedSize; // NOTE: Only for prefault, where the allocation is rounded up to whole pages
+};
+
+static read_mode GetReadMode(char *Name)
+{
+    // NOTE: Returns ReadMode_Count for an unknown name
+    read_mode Result = ReadMode_Count;
+    for(u32 Mode = 0; Mode < ReadMode_Count; ++Mode)
+    {
+        if(strcmp(Name, ReadModeNames[Mode]) == 0)
+        {
+            Result = (read_mode)Mode;
+        }
+    }
+    
+    return Result;
+}
+
+static u64 GetFileSize(char *FileName)
+{
+#if _WIN32
+    struct __stat64 Stat;
+    int StatResult = _stat64(FileName, &Stat);
+#else
+    struct stat Stat;
+    int StatResult = stat(FileName, &Stat);
+#endif
+    
+    u64 Result = (StatResult == 0) ? Stat.st_size : 0;
+    return Result;
+}
+
+#if _WIN32
+
+static buffer MapFileWithMode(char *FileName, read_mode Mode)
+{
+    buffer Result = {};
+    
+    DWORD Flags = (Mode == ReadMode_mmapadvise) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+    HANDLE File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, Flags, 0);
+    if(File != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER Size;
+        if(GetFileSizeEx(File, &Size) && Size.QuadPart)
+        {
+            HANDLE Mapping = CreateFileMappingA(File, 0, PAGE_READONLY, 0, 0, 0);
+            if(Mapping)
+            {
+                Result.Data = (u8 *)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+                if(Result.Data)
+                {
+                    Result.Count = Size.QuadPart;
+                }
+                
+                CloseHandle(Mapping);
+            }
+        }
+        
+        CloseHandle(File);
+    }
+    
+    if(Result.Data && (Mode == ReadMode_mmap))
+    {
+        volatile u8 Sink = 0;
+        for(u64 At = 0; At < Result.Count; At += 4096)
+        {
+            Sink += Result.Data[At];
+        }
+    }
+    
+    return Result;
+}
+
+#else
+
+static buffer MapFileWithMode(char *FileName, read_mode Mode)
+{
+    buffer Result = {};
+    
+    int File = open(FileName, O_RDONLY);
+    if(File != -1)
+    {
+        struct stat Stat;
+        if((fstat(File, &Stat) == 0) && Stat.st_size)
+        {
+            int Flags = MAP_PRIVATE;
+            if(Mode == ReadMode_mmap)
+            {
+                Flags |= MAP_POPULATE;
+            }
+            
+            void *Memory = mmap(0, Stat.st_size, PROT_READ, Flags, File, 0);
+            if(Memory != MAP_FAILED)
+            {
+                Result.Data = (u8 *)Memory;
+                Result.Count = Stat.st_size;
+                
+                if(Mode == ReadMode_mmapadvise)
+                {
+                    // NOTE: Huge pages for file mappings depend on the file system, so failure is expected and ignored
+                    madvise(Memory, Stat.st_size, MADV_SEQUENTIAL);
+                    madvise(Memory, Stat.st_size, MADV_HUGEPAGE);
+                }
+            }
+        }
+        
+        close(File);
+    }
+    
+    return Result;
+}
+
+#endif
+
+static b32 ReadIntoBuffer(char *FileName, buffer Dest)
+{
+    b32 Result = false;
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+        Result = (fread(Dest.Data, Dest.Count, 1, File) == 1);
+        fclose(File);
+    }
+    
+    return Result;
+}
+
+static input_file ReadInputFile(char *FileName, read_mode Mode)
+{
+    // NOTE: Every mode has its own anchors, so running several of them shows each one separately in the profile
+    input_file Result = {};
+    Result.Mode = Mode;
+    
+    u64 Size = GetFileSize(FileName);
+    if(Size)
+    {
+        switch(Mode)
+        {
+            case ReadMode_fread:
+            {
+                Result.Data = AllocateBuffer(Size);
+                if(Result.Data.Data)
+                {
+                    TimeBandwidth("fread (malloc)", Size);
+                    if(!ReadIntoBuffer(FileName, Result.Data))
+                    {
+                        FreeBuffer(&Result.Data);
+                    }
+                }
+            } break;
+            
+            case ReadMode_mmap:
+            {
+                TimeBandwidth("mmap (populate)", Size);
+                Result.Data = MapFileWithMode(FileName, Mode);
+            } break;
+            
+            case ReadMode_mmapadvise:
+            {
+                TimeBandwidth("mmap (advise)", Size);
+                Result.Data = MapFileWithMode(FileName, Mode);
+            } break;
+            
+            case ReadMode_prefault:
+            {
+                u64 PageSize = GetLargePageSize();
+                if(PageSize < 4096)
+                {
+                    PageSize = 4096;
+                }
+                u64 AllocatedSize = (Size + PageSize - 1) & ~(PageSize - 1);
+                u8 *Memory = OSAllocate(AllocatedSize, true);
+                if(Memory)
+                {
+                    {
+                        TimeBandwidth("Prefault", AllocatedSize);
+                        for(u64 At = 0; At < AllocatedSize; At += 4096)
+                        {
+                            Memory[At] = 0;
+                        }
+                    }
+                    
+                    Result.Data.Data = Memory;
+                    Result.Data.Count = Size;
+                    Result.AllocatedSize = AllocatedSize;
+                    
+                    TimeBandwidth("fread (prefaulted)", Size);
+                    if(!ReadIntoBuffer(FileName, Result.Data))
+                    {
+                        OSFree(Memory, AllocatedSize);
+                        Result.Data = {};
+                    }
+                }
+            } break;
+            
+            default:
+            {
+                fprintf(stderr, "ERROR: Unrecognized read mode\n");
+            } break;
+        }
+    }
+    
+    if(!Result.Data.Count)
+    {
+        fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+static void ReleaseInputFile(input_file *File)
+{
+    switch(File->Mode)
+    {
+        case ReadMode_fread:
+        {
+            FreeBuffer(&File->Data);
+        } break;
+        
+        case ReadMode_prefault:
+        {
+            if(File->Data.Data)
+            {
+                OSFree(File->Data.Data, File->AllocatedSize);
+            }
+        } break;
+        
+        case ReadMode_mmap:
+        case ReadMode_mmapadvise:
+        {
+            UnmapFile(&File->Data);
+        } break;
+        
+        default:
+        {
+            fprintf(stderr, "ERROR: Unrecognized read mode\n");
+        } break;
+    }
+    
+    *File = {};
+}
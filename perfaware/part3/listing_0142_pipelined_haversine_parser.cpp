@@ -0,0 +1,456 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 142
+   ======================================================================== */
+
+/* NOTE: Overlaps reading the input with parsing it. An I/O thread reads the file in fixed-size
+   chunks with positioned reads into a ring of buffers, while this thread parses whichever
+   chunk was finished last. The number of buffers, and so the memory in flight, is bounded by
+   a ceiling passed in by the caller, and is never less than two so that one can be read into
+   while the other is parsed.
+   
+   Each buffer has room in front of its chunk for the tail of the previous chunk. A chunk
+   is parsed up to the last `}, {` in it (using ParsePairChunk from listing 134), and
+   whatever comes after that point is copied in front of the next chunk, so elements that
+   straddle a chunk edge are parsed whole. As in listing 134, a `}, {` inside a string can
+   fool this. It shows up as the parse not stopping exactly there, and then the caller gets a
+   failure back and has to parse the file the ordinary way.
+   
+   The profiler can only be used from one thread, so the I/O thread keeps its own counts of
+   time spent reading and waiting, and so does the parsing side. The two can add up to more
+   than the wall time, which is the point.
+   
+   Needs listings 123 (OSAllocate), 134 (threads and ParsePairChunk) and 140 (GetFileSize). */
+
+#if _WIN32
+
+typedef HANDLE os_semaphore;
+
+static b32 InitOSSemaphore(os_semaphore *Semaphore, u32 InitialCount, u32 MaxCount)
+{
+    *Semaphore = CreateSemaphoreA(0, InitialCount, MaxCount, 0);
+    b32 Result = (*Semaphore != 0);
+    return Result;
+}
+
+static void WaitOSSemaphore(os_semaphore *Semaphore)
+{
+    WaitForSingleObject(*Semaphore, INFINITE);
+}
+
+static void SignalOSSemaphore(os_semaphore *Semaphore)
+{
+    ReleaseSemaphore(*Semaphore, 1, 0);
+}
+
+static void DestroyOSSemaphore(os_semaphore *Semaphore)
+{
+    CloseHandle(*Semaphore);
+}
+
+typedef HANDLE os_file;
+#define INVALID_OS_FILE INVALID_HANDLE_VALUE
+
+static os_file OpenOSFileForReading(char *FileName)
+{
+    os_file Result = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    return Result;
+}
+
+static u64 ReadOSFileAt(os_file File, u8 *Dest, u64 Count, u64 Offset)
+{
+    // NOTE: The Windows equivalent of pread is a synchronous ReadFile with the offset in an OVERLAPPED
+    u64 Result = 0;
+    while(Result < Count)
+    {
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset = (DWORD)(Offset + Result);
+        Overlapped.OffsetHigh = (DWORD)((Offset + Result) >> 32);
+        
+        u64 ReadSize = Count - Result;
+        if(ReadSize > 0x40000000)
+        {
+            ReadSize = 0x40000000;
+        }
+        
+        DWORD BytesRead = 0;
+        if(!ReadFile(File, Dest + Result, (DWORD)ReadSize, &BytesRead, &Overlapped) || !BytesRead)
+        {
+            break;
+        }
+        Result += BytesRead;
+    }
+    
+    return Result;
+}
+
+static void CloseOSFile(os_file File)
+{
+    CloseHandle(File);
+}
+
+#else
+
+#include <semaphore.h>
+
+typedef sem_t os_semaphore;
+
+static b32 InitOSSemaphore(os_semaphore *Semaphore, u32 InitialCount, u32 MaxCount)
+{
+    // NOTE: POSIX semaphores can't be copied once they're initialized, so this has to happen where the semaphore lives
+    (void)MaxCount;
+    b32 Result = (sem_init(Semaphore, 0, InitialCount) == 0);
+    return Result;
+}
+
+static void WaitOSSemaphore(os_semaphore *Semaphore)
+{
+    while(sem_wait(Semaphore) != 0)
+    {
+        // NOTE: Only fails when a signal interrupts the wait
+    }
+}
+
+static void SignalOSSemaphore(os_semaphore *Semaphore)
+{
+    sem_post(Semaphore);
+}
+
+static void DestroyOSSemaphore(os_semaphore *Semaphore)
+{
+    sem_destroy(Semaphore);
+}
+
+typedef int os_file;
+#define INVALID_OS_FILE -1
+
+static os_file OpenOSFileForReading(char *FileName)
+{
+    os_file Result = open(FileName, O_RDONLY);
+    return Result;
+}
+
+static u64 ReadOSFileAt(os_file File, u8 *Dest, u64 Count, u64 Offset)
+{
+    // NOTE: pread can come back short, so keep going until the chunk is full or the file ends
+    u64 Result = 0;
+    while(Result < Count)
+    {
+        ssize_t BytesRead = pread(File, Dest + Result, Count - Result, Offset + Result);
+        if(BytesRead <= 0)
+        {
+            break;
+        }
+        Result += BytesRead;
+    }
+    
+    return Result;
+}
+
+static void CloseOSFile(os_file File)
+{
+    close(File);
+}
+
+#endif
+
+#define PIPELINE_CARRY_SIZE (64*1024)
+#define MAX_PIPELINE_BUFFER_COUNT 64
+
+struct pipeline_buffer
+{
+    u8 *Memory; // NOTE: PIPELINE_CARRY_SIZE bytes of room for the previous tail, then the chunk
+    u64 ReadCount;
+    b32 Last;
+};
+
+struct pipeline_stats
+{
+    u64 ChunkSize;
+    u32 BufferCount;
+    u64 ChunkCount;
+    u64 ByteCount;
+    
+    u64 WallTSC;
+    u64 ReadTSC;
+    u64 ReadWaitTSC;
+    u64 ParseTSC;
+    u64 ParseWaitTSC;
+};
+
+struct pipeline
+{
+    os_file File;
+    u64 FileSize;
+    u64 ChunkSize;
+    
+    u32 BufferCount;
+    pipeline_buffer Buffers[MAX_PIPELINE_BUFFER_COUNT];
+    
+    // NOTE: Free counts buffers the I/O thread may read into, Filled counts buffers ready to parse
+    os_semaphore Free;
+    os_semaphore Filled;
+    
+    // NOTE: Only written by the I/O thread
+    u64 ReadTSC;
+    u64 ReadWaitTSC;
+    
+    os_thread_start ThreadStart;
+};
+
+static void ReadPipelineChunks(void *Param)
+{
+    // NOTE: Runs on the I/O thread, so nothing in here may touch the profiler
+    pipeline *Pipeline = (pipeline *)Param;
+    
+    u64 Offset = 0;
+    for(u64 ChunkIndex = 0;; ++ChunkIndex)
+    {
+        u64 WaitStart = ReadCPUTimer();
+        WaitOSSemaphore(&Pipeline->Free);
+        u64 ReadStart = ReadCPUTimer();
+        
+        pipeline_buffer *Buffer = Pipeline->Buffers + (ChunkIndex % Pipeline->BufferCount);
+        Buffer->ReadCount = ReadOSFileAt(Pipeline->File, Buffer->Memory + PIPELINE_CARRY_SIZE, Pipeline->ChunkSize, Offset);
+        Offset += Buffer->ReadCount;
+        
+        // NOTE: A short read means the end of the file, or an error that the parser finds out about
+        // from the total being short
+        Buffer->Last = ((Buffer->ReadCount < Pipeline->ChunkSize) || (Offset >= Pipeline->FileSize));
+        
+        u64 ReadEnd = ReadCPUTimer();
+        Pipeline->ReadWaitTSC += ReadStart - WaitStart;
+        Pipeline->ReadTSC += ReadEnd - ReadStart;
+        
+        SignalOSSemaphore(&Pipeline->Filled);
+        
+        if(Buffer->Last)
+        {
+            break;
+        }
+    }
+}
+
+static u64 FindLastElementBoundary(buffer Source, u64 Start)
+{
+    // NOTE: Returns the offset of the { in the last `}, {` after Start, or 0 if there isn't one
+    u64 Result = 0;
+    
+    for(u64 At = Source.Count; At > Start; --At)
+    {
+        if(Source.Data[At - 1] == '{')
+        {
+            u64 Check = At - 1;
+            while((Check > Start) && IsJSONWhitespace(Source, Check - 1)) {--Check;}
+            if((Check > Start) && (Source.Data[Check - 1] == ','))
+            {
+                --Check;
+                while((Check > Start) && IsJSONWhitespace(Source, Check - 1)) {--Check;}
+                if((Check > Start) && (Source.Data[Check - 1] == '}'))
+                {
+                    Result = At - 1;
+                    break;
+                }
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static u64 ParseHaversinePairsPipelined(char *FileName, u64 MaxPairCount, haversine_pair *Pairs,
+                                        u64 ChunkSize, u64 MemoryCeiling, pipeline_stats *Stats, b32 *Failed)
+{
+    TimeFunction;
+    
+    u64 PairCount = 0;
+    *Failed = true;
+    *Stats = {};
+    
+    pipeline Pipeline = {};
+    Pipeline.FileSize = GetFileSize(FileName);
+    Pipeline.ChunkSize = ChunkSize;
+    
+    u64 BufferSize = PIPELINE_CARRY_SIZE + ChunkSize;
+    u64 BufferCount = MemoryCeiling / BufferSize;
+    if(BufferCount < 2)
+    {
+        BufferCount = 2;
+    }
+    if(BufferCount > MAX_PIPELINE_BUFFER_COUNT)
+    {
+        BufferCount = MAX_PIPELINE_BUFFER_COUNT;
+    }
+    Pipeline.BufferCount = (u32)BufferCount;
+    
+    Stats->ChunkSize = ChunkSize;
+    Stats->BufferCount = Pipeline.BufferCount;
+    
+    b32 Allocated = true;
+    for(u32 BufferIndex = 0; BufferIndex < Pipeline.BufferCount; ++BufferIndex)
+    {
+        Pipeline.Buffers[BufferIndex].Memory = OSAllocate(BufferSize, false);
+        Allocated = Allocated && Pipeline.Buffers[BufferIndex].Memory;
+    }
+    
+    Pipeline.File = OpenOSFileForReading(FileName);
+    
+    b32 HasFree = false;
+    b32 HasFilled = false;
+    if(Allocated && Pipeline.FileSize && (Pipeline.File != INVALID_OS_FILE))
+    {
+        HasFree = InitOSSemaphore(&Pipeline.Free, Pipeline.BufferCount, Pipeline.BufferCount);
+        HasFilled = InitOSSemaphore(&Pipeline.Filled, 0, Pipeline.BufferCount);
+    }
+    
+    if(HasFree && HasFilled)
+    {
+        u64 WallStart = ReadCPUTimer();
+        
+        Pipeline.ThreadStart.Func = ReadPipelineChunks;
+        Pipeline.ThreadStart.Param = &Pipeline;
+        os_thread Thread = StartOSThread(&Pipeline.ThreadStart);
+        
+        u8 *Carry = 0;
+        u64 CarryCount = 0;
+        u64 ArrayStart = 0;
+        b32 Done = false;
+        b32 Error = false;
+        pipeline_buffer *Held = 0;
+        for(u64 ChunkIndex = 0;; ++ChunkIndex)
+        {
+            u64 WaitStart = ReadCPUTimer();
+            WaitOSSemaphore(&Pipeline.Filled);
+            u64 ParseStart = ReadCPUTimer();
+            Stats->ParseWaitTSC += ParseStart - WaitStart;
+            
+            pipeline_buffer *Buffer = Pipeline.Buffers + (ChunkIndex % Pipeline.BufferCount);
+            ++Stats->ChunkCount;
+            Stats->ByteCount += Buffer->ReadCount;
+            
+            if(!Done && !Error)
+            {
+                // NOTE: The tail of the previous chunk goes right in front of this one, and only then can
+                // the previous buffer go back to the I/O thread
+                u8 *WindowStart = Buffer->Memory + PIPELINE_CARRY_SIZE - CarryCount;
+                memcpy(WindowStart, Carry, CarryCount);
+                
+                buffer Window = {CarryCount + Buffer->ReadCount, WindowStart};
+                u64 Start = 0;
+                if(ChunkIndex == 0)
+                {
+                    ArrayStart = FindPairsArray(Window);
+                    Start = ArrayStart;
+                    Error = (ArrayStart == 0);
+                }
+                
+                u64 OnePastEnd = Window.Count;
+                if(!Buffer->Last)
+                {
+                    OnePastEnd = FindLastElementBoundary(Window, Start);
+                    if(!OnePastEnd)
+                    {
+                        // NOTE: No element ends in this chunk, so all of it carries over to the next
+                        OnePastEnd = Start;
+                    }
+                }
+                
+                if(!Error && (OnePastEnd > Start))
+                {
+                    pair_chunk Chunk = {};
+                    Chunk.InputJSON = Window;
+                    Chunk.Start = Start;
+                    Chunk.OnePastEnd = OnePastEnd;
+                    Chunk.Pairs = Pairs + PairCount;
+                    Chunk.MaxPairCount = MaxPairCount - PairCount;
+                    ParsePairChunk(&Chunk);
+                    
+                    PairCount += Chunk.PairCount;
+                    Done = Chunk.ReachedEndOfArray;
+                    Error = (Chunk.Failed || (!Done && (Chunk.StoppedAt != OnePastEnd)));
+                }
+                
+                Carry = Window.Data + OnePastEnd;
+                CarryCount = Window.Count - OnePastEnd;
+                if(!Done && (CarryCount > PIPELINE_CARRY_SIZE))
+                {
+                    Error = true;
+                }
+            }
+            
+            if(Held)
+            {
+                SignalOSSemaphore(&Pipeline.Free);
+            }
+            Held = Buffer;
+            
+            Stats->ParseTSC += ReadCPUTimer() - ParseStart;
+            
+            if(Buffer->Last)
+            {
+                break;
+            }
+        }
+        
+        JoinOSThread(Thread);
+        
+        Stats->WallTSC = ReadCPUTimer() - WallStart;
+        Stats->ReadTSC = Pipeline.ReadTSC;
+        Stats->ReadWaitTSC = Pipeline.ReadWaitTSC;
+        
+        *Failed = (Error || !Done || (Stats->ByteCount != Pipeline.FileSize));
+    }
+    
+    if(HasFree)
+    {
+        DestroyOSSemaphore(&Pipeline.Free);
+    }
+    
+    if(HasFilled)
+    {
+        DestroyOSSemaphore(&Pipeline.Filled);
+    }
+    
+    if(Pipeline.File != INVALID_OS_FILE)
+    {
+        CloseOSFile(Pipeline.File);
+    }
+    
+    for(u32 BufferIndex = 0; BufferIndex < Pipeline.BufferCount; ++BufferIndex)
+    {
+        if(Pipeline.Buffers[BufferIndex].Memory)
+        {
+            OSFree(Pipeline.Buffers[BufferIndex].Memory, BufferSize);
+        }
+    }
+    
+    return PairCount;
+}
+
+static void PrintPipelineStats(pipeline_stats *Stats)
+{
+    f64 Wall = (f64)Stats->WallTSC;
+    f64 Kilobyte = 1024.0;
+    f64 Megabyte = 1024.0*1024.0;
+    
+    fprintf(stdout, "Pipeline: %llu chunks of %.0fkb, %u buffers (%.2fmb in flight at most)\n",
+            Stats->ChunkCount, (f64)Stats->ChunkSize / Kilobyte, Stats->BufferCount,
+            (f64)(Stats->BufferCount*(Stats->ChunkSize + PIPELINE_CARRY_SIZE)) / Megabyte);
+    fprintf(stdout, "  Wall: %llu\n", Stats->WallTSC);
+    fprintf(stdout, "  I/O thread: read %llu (%.2f%%), waiting for a free buffer %llu (%.2f%%)\n",
+            Stats->ReadTSC, 100.0*Stats->ReadTSC / Wall, Stats->ReadWaitTSC, 100.0*Stats->ReadWaitTSC / Wall);
+    fprintf(stdout, "  Parser: parse %llu (%.2f%%), waiting for a read %llu (%.2f%%)\n",
+            Stats->ParseTSC, 100.0*Stats->ParseTSC / Wall, Stats->ParseWaitTSC, 100.0*Stats->ParseWaitTSC / Wall);
+    fprintf(stdout, "  Read + parse: %.2f%% of wall\n", 100.0*(Stats->ReadTSC + Stats->ParseTSC) / Wall);
+}
@@ -0,0 +1,346 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 143
+   ======================================================================== */
+
+/* NOTE: Same as listing 141, except that -pipeline reads and parses JSON input at the same
+   time (see listing 142). -chunkkb sets the size of each read, and -maxinflightmb caps the
+   memory used by the buffers. If the pipeline can't handle the input, it's read with -read
+   and parsed as before. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#define PROFILER 1
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0132_field_index_json_parser.cpp"
+#include "listing_0134_parallel_haversine_parser.cpp"
+#include "listing_0136_haversine_pair_file.cpp"
+#include "listing_0140_read_modes.cpp"
+#include "listing_0142_pipelined_haversine_parser.cpp"
+
+static buffer ReadEntireFile(char *FileName)
+{
+    TimeFunction;
+    
+    buffer Result = {};
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        Result = AllocateBuffer(Stat.st_size);
+        if(Result.Data)
+        {
+            TimeBandwidth("fread", Result.Count);
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+static f64 SumHaversineDistances(u64 PairCount, haversine_pair *Pairs)
+{
+    TimeBandwidth(__func__, PairCount*sizeof(haversine_pair));
+    
+    f64 Sum = 0;
+    
+    f64 SumCoef = 1 / (f64)PairCount;
+    for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+    {
+        haversine_pair Pair = Pairs[PairIndex];
+        f64 EarthRadius = 6372.8;
+        f64 Dist = ReferenceHaversine(Pair.X0, Pair.Y0, Pair.X1, Pair.Y1, EarthRadius);
+        Sum += SumCoef*Dist;
+    }
+    
+    return Sum;
+}
+
+static f64 SumHaversineDistances(haversine_pair_columns Columns)
+{
+    TimeBandwidth(__func__, Columns.PairCount*sizeof(haversine_pair));
+    
+    f64 Sum = 0;
+    
+    f64 SumCoef = 1 / (f64)Columns.PairCount;
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; ++PairIndex)
+    {
+        f64 EarthRadius = 6372.8;
+        f64 Dist = ReferenceHaversine(Columns.X0[PairIndex], Columns.Y0[PairIndex],
+                                      Columns.X1[PairIndex], Columns.Y1[PairIndex], EarthRadius);
+        Sum += SumCoef*Dist;
+    }
+    
+    return Sum;
+}
+
+static void Validate(char *AnswersFileName, u64 PairCount, f64 Sum)
+{
+    buffer AnswersF64 = ReadEntireFile(AnswersFileName);
+    if(AnswersF64.Count >= sizeof(f64))
+    {
+        f64 *AnswerValues = (f64 *)AnswersF64.Data;
+        
+        fprintf(stdout, "\nValidation:\n");
+        
+        u64 RefAnswerCount = (AnswersF64.Count - sizeof(f64)) / sizeof(f64);
+        if(PairCount != RefAnswerCount)
+        {
+            fprintf(stdout, "FAILED - pair count doesn't match %llu.\n", RefAnswerCount);
+        }
+        
+        f64 RefSum = AnswerValues[RefAnswerCount];
+        fprintf(stdout, "Reference sum: %.16f\n", RefSum);
+        fprintf(stdout, "Difference: %.16f\n", Sum - RefSum);
+        
+        fprintf(stdout, "\n");
+    }
+    
+    FreeBuffer(&AnswersF64);
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&FreeJSON;
+    (void)&TryToEnableLargePages;
+    (void)&MapFileReadOnly;
+    
+    BeginProfile();
+    
+    int Result = 1;
+    
+    // NOTE: All the options can go anywhere on the command line
+    u32 ThreadCount = 1;
+    read_mode Mode = ReadMode_fread;
+    b32 Pipelined = false;
+    u64 ChunkSize = 1024*1024;
+    u64 MemoryCeiling = 4*ChunkSize;
+    char *FileNames[2] = {};
+    u32 FileNameCount = 0;
+    b32 ValidArgs = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        if((strcmp(Args[ArgIndex], "-threads") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            ThreadCount = (u32)strtoul(Args[++ArgIndex], 0, 10);
+            ValidArgs = ValidArgs && (ThreadCount >= 1) && (ThreadCount <= MAX_PARSE_THREAD_COUNT);
+        }
+        else if((strcmp(Args[ArgIndex], "-read") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            Mode = GetReadMode(Args[++ArgIndex]);
+            ValidArgs = ValidArgs && (Mode != ReadMode_Count);
+        }
+        else if(strcmp(Args[ArgIndex], "-pipeline") == 0)
+        {
+            Pipelined = true;
+        }
+        else if((strcmp(Args[ArgIndex], "-chunkkb") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            ChunkSize = 1024*strtoull(Args[++ArgIndex], 0, 10);
+            ValidArgs = ValidArgs && (ChunkSize >= 4096);
+        }
+        else if((strcmp(Args[ArgIndex], "-maxinflightmb") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            MemoryCeiling = 1024*1024*strtoull(Args[++ArgIndex], 0, 10);
+        }
+        else if(FileNameCount < ArrayCount(FileNames))
+        {
+            FileNames[FileNameCount++] = Args[ArgIndex];
+        }
+        else
+        {
+            ValidArgs = false;
+        }
+    }
+    
+    if(ValidArgs && FileNameCount)
+    {
+        input_file Input = {};
+        
+        u64 PairCount = 0;
+        f64 Sum = 0;
+        
+        pipeline_stats Stats = {};
+        b32 PipelineFailed = true;
+        if(Pipelined)
+        {
+            u32 MinimumJSONPairEncoding = 6*4;
+            u64 MaxPairCount = GetFileSize(FileNames[0]) / MinimumJSONPairEncoding;
+            buffer ParsedValues = AllocateBuffer(MaxPairCount * sizeof(haversine_pair));
+            if(ParsedValues.Count)
+            {
+                haversine_pair *Pairs = (haversine_pair *)ParsedValues.Data;
+                PairCount = ParseHaversinePairsPipelined(FileNames[0], MaxPairCount, Pairs, ChunkSize, MemoryCeiling, &Stats, &PipelineFailed);
+                if(!PipelineFailed && PairCount)
+                {
+                    Sum = SumHaversineDistances(PairCount, Pairs);
+                }
+                else
+                {
+                    fprintf(stderr, "WARNING: Pipelined parse failed, falling back to a full read.\n");
+                    PairCount = 0;
+                    PipelineFailed = true;
+                }
+            }
+            
+            FreeBuffer(&ParsedValues);
+        }
+        
+        u64 InputSize = Stats.ByteCount;
+        if(PipelineFailed)
+        {
+            Input = ReadInputFile(FileNames[0], Mode);
+            InputSize = Input.Data.Count;
+        }
+        
+        if(!PipelineFailed)
+        {
+            // NOTE: Already parsed and summed
+        }
+        else if(IsHaversinePairFile(Input.Data))
+        {
+            haversine_pair_columns Columns = GetHaversinePairColumns(Input.Data);
+            if(Columns.PairCount)
+            {
+                PairCount = Columns.PairCount;
+                Sum = SumHaversineDistances(Columns);
+            }
+        }
+        else if(Input.Data.Count)
+        {
+            u32 MinimumJSONPairEncoding = 6*4;
+            u64 MaxPairCount = Input.Data.Count / MinimumJSONPairEncoding;
+            buffer ParsedValues = AllocateBuffer(MaxPairCount * sizeof(haversine_pair));
+            if(ParsedValues.Count)
+            {
+                haversine_pair *Pairs = (haversine_pair *)ParsedValues.Data;
+                PairCount = ParseHaversinePairsParallel(Input.Data, MaxPairCount, Pairs, ThreadCount);
+                if(PairCount)
+                {
+                    Sum = SumHaversineDistances(PairCount, Pairs);
+                }
+            }
+            
+            FreeBuffer(&ParsedValues);
+        }
+        
+        if(PairCount)
+        {
+            Result = 0;
+            
+            fprintf(stdout, "Input size: %llu\n", InputSize);
+            if(PipelineFailed)
+            {
+                fprintf(stdout, "Read mode: %s\n", ReadModeNames[Mode]);
+            }
+            else
+            {
+                PrintPipelineStats(&Stats);
+            }
+            fprintf(stdout, "Pair count: %llu\n", PairCount);
+            fprintf(stdout, "Haversine sum: %.16f\n", Sum);
+            
+            if(FileNameCount == 2)
+            {
+                Validate(FileNames[1], PairCount, Sum);
+            }
+        }
+        else if(InputSize)
+        {
+            fprintf(stderr, "ERROR: Malformed input\n");
+        }
+        
+        ReleaseInputFile(&Input);
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [haversine_input.json/.hvpairs] [-threads count] [-read mode] [-pipeline] [-chunkkb size] [-maxinflightmb size]\n", Args[0]);
+        fprintf(stderr, "       %s [haversine_input.json/.hvpairs] [answers.f64] [-threads count] [-read mode] [-pipeline] [-chunkkb size] [-maxinflightmb size]\n", Args[0]);
+        fprintf(stderr, "Read modes:");
+        for(u32 ModeIndex = 0; ModeIndex < ReadMode_Count; ++ModeIndex)
+        {
+            fprintf(stderr, " %s", ReadModeNames[ModeIndex]);
+        }
+        fprintf(stderr, "\n");
+    }
+    
+    if(Result == 0)
+	{
+        EndAndPrintProfile();
+	}
+    
+    return Result;
+}
+
+ProfilerEndOfCompilationUnit;
@@ -0,0 +1,535 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 144
+   ======================================================================== */
+
+/* NOTE: Haversine kernels that do 4 (AVX2) or 8 (AVX-512) pairs at a time. Instead of calling
+   the CRT's sin/cos/asin one value at a time, they use polynomials evaluated with FMAs on
+   whole vectors:
+       
+       sin, cos - reduced to [-pi/2, pi/2] by subtracting the nearest multiple of pi (in two
+                  parts, so the reduction itself doesn't lose precision), with the sign
+                  flipped for odd multiples. Then a Taylor polynomial out to x^23 or x^24.
+       asin     - only ever needed on [0, 1] here. Above 0.5 it uses
+                  asin(x) = pi/2 - 2*asin(sqrt((1 - x)/2)), so the polynomial (Taylor,
+                  25 terms) only has to cover [0, 0.5].
+       sqrt     - the hardware instruction, which is already correctly rounded.
+   
+   The pairs are still stored as {X0, Y0, X1, Y1}, so each group of pairs gets transposed
+   into one register per coordinate after it is loaded. Because every lane keeps its own
+   running sum, the total is added up in a different order from the reference loop and
+   won't match it bit for bit. The per-pair distances are what say how accurate this is. */
+
+#if _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,fma")))
+#endif
+
+#include <immintrin.h>
+
+enum haversine_kernel
+{
+    HaversineKernel_Reference,
+    HaversineKernel_AVX2,
+    HaversineKernel_AVX512,
+    
+    HaversineKernel_Count,
+};
+
+static char const *HaversineKernelNames[HaversineKernel_Count] =
+{
+    "reference",
+    "avx2",
+    "avx512",
+};
+
+typedef f64 haversine_sum_func(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius);
+typedef void haversine_distances_func(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius, f64 *Distances);
+
+struct haversine_kernel_funcs
+{
+    haversine_sum_func *Sum;
+    haversine_distances_func *Distances;
+};
+
+static f64 const SinCoefficients[] =
+{
+    1, -0.16666666666666666, 0.0083333333333333332, -0.00019841269841269841, 2.7557319223985893e-06,
+    -2.505210838544172e-08, 1.6059043836821613e-10, -7.6471637318198164e-13, 2.8114572543455206e-15,
+    -8.2206352466243295e-18, 1.9572941063391263e-20, -3.8681701706306841e-23,
+};
+
+static f64 const CosCoefficients[] =
+{
+    1, -0.5, 0.041666666666666664, -0.0013888888888888889, 2.4801587301587302e-05, -2.7557319223985888e-07,
+    2.08767569878681e-09, -1.1470745597729725e-11, 4.7794773323873853e-14, -1.5619206968586225e-16,
+    4.1103176233121648e-19, -8.8967913924505741e-22, 1.6117375710961184e-24,
+};
+
+static f64 const AsinCoefficients[] =
+{
+    1, 0.16666666666666666, 0.074999999999999997, 0.044642857142857144, 0.030381944444444444,
+    0.022372159090909092, 0.017352764423076924, 0.013964843750000001, 0.011551800896139705,
+    0.0097616095291940784, 0.0083903358096168151, 0.0073125258735988454, 0.0064472103118896487,
+    0.0057400376708419236, 0.0051533096823199046, 0.0046601434869150962, 0.0042409070936793632,
+    0.0038809645588376691, 0.0035692053938259347, 0.0032970595034734849, 0.0030578216492580306,
+    0.0028461784011089421, 0.0026578706382072901, 0.0024894486782468836, 0.002338091892111975,
+};
+
+// NOTE: Pi as the nearest f64 plus what that leaves out. X - k*PiHigh is a single FMA, so it is rounded
+// only once, and PiLow then corrects for PiHigh not quite being pi.
+#define HAVERSINE_PI_HIGH 3.141592653589793116
+#define HAVERSINE_PI_LOW 1.2246467991473532e-16
+#define HAVERSINE_INV_PI 0.31830988618379067154
+#define HAVERSINE_HALF_PI 1.57079632679489661923
+#define HAVERSINE_RADIANS_PER_DEGREE 0.01745329251994329577
+
+// NOTE: Adding 1.5*2^52 rounds to an integer and leaves it in the low bits of the mantissa
+#define HAVERSINE_ROUNDING_MAGIC 6755399441055744.0
+
+//
+// NOTE: Reference
+//
+
+static f64 SumHaversineReference(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius)
+{
+    TimeBandwidth(__func__, PairCount*sizeof(haversine_pair));
+    
+    f64 Sum = 0;
+    
+    f64 SumCoef = 1 / (f64)PairCount;
+    for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+    {
+        haversine_pair Pair = Pairs[PairIndex];
+        f64 Dist = ReferenceHaversine(Pair.X0, Pair.Y0, Pair.X1, Pair.Y1, EarthRadius);
+        Sum += SumCoef*Dist;
+    }
+    
+    return Sum;
+}
+
+static void HaversineDistancesReference(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius, f64 *Distances)
+{
+    for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+    {
+        haversine_pair Pair = Pairs[PairIndex];
+        Distances[PairIndex] = ReferenceHaversine(Pair.X0, Pair.Y0, Pair.X1, Pair.Y1, EarthRadius);
+    }
+}
+
+//
+// NOTE: AVX2
+//
+
+TARGET_AVX2 static __m256d EvaluatePolynomialX4(f64 const *Coefficients, u32 Count, __m256d X)
+{
+    __m256d Result = _mm256_set1_pd(Coefficients[Count - 1]);
+    for(u32 Index = Count - 1; Index > 0; --Index)
+    {
+        Result = _mm256_fmadd_pd(Result, X, _mm256_set1_pd(Coefficients[Index - 1]));
+    }
+    
+    return Result;
+}
+
+TARGET_AVX2 static __m256d ReduceByPiX4(__m256d X, __m256d *Sign)
+{
+    // NOTE: Returns X - k*pi for the nearest integer k, and the sign bit to apply for odd k
+    __m256d Magic = _mm256_set1_pd(HAVERSINE_ROUNDING_MAGIC);
+    __m256d Shifted = _mm256_fmadd_pd(X, _mm256_set1_pd(HAVERSINE_INV_PI), Magic);
+    __m256d K = _mm256_sub_pd(Shifted, Magic);
+    
+    *Sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(Shifted), 63));
+    
+    __m256d Result = _mm256_fnmadd_pd(K, _mm256_set1_pd(HAVERSINE_PI_HIGH), X);
+    Result = _mm256_fnmadd_pd(K, _mm256_set1_pd(HAVERSINE_PI_LOW), Result);
+    return Result;
+}
+
+TARGET_AVX2 static __m256d SinX4(__m256d X)
+{
+    __m256d Sign;
+    __m256d R = ReduceByPiX4(X, &Sign);
+    __m256d Result = _mm256_mul_pd(R, EvaluatePolynomialX4(SinCoefficients, ArrayCount(SinCoefficients), _mm256_mul_pd(R, R)));
+    Result = _mm256_xor_pd(Result, Sign);
+    return Result;
+}
+
+TARGET_AVX2 static __m256d CosX4(__m256d X)
+{
+    __m256d Sign;
+    __m256d R = ReduceByPiX4(X, &Sign);
+    __m256d Result = EvaluatePolynomialX4(CosCoefficients, ArrayCount(CosCoefficients), _mm256_mul_pd(R, R));
+    Result = _mm256_xor_pd(Result, Sign);
+    return Result;
+}
+
+TARGET_AVX2 static __m256d AsinX4(__m256d X)
+{
+    // NOTE: X must be in [0, 1]
+    __m256d Half = _mm256_set1_pd(0.5);
+    __m256d IsLarge = _mm256_cmp_pd(X, Half, _CMP_GT_OQ);
+    
+    __m256d Folded = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), X), Half));
+    __m256d Z = _mm256_blendv_pd(X, Folded, IsLarge);
+    
+    __m256d P = _mm256_mul_pd(Z, EvaluatePolynomialX4(AsinCoefficients, ArrayCount(AsinCoefficients), _mm256_mul_pd(Z, Z)));
+    __m256d Unfolded = _mm256_fnmadd_pd(_mm256_set1_pd(2.0), P, _mm256_set1_pd(HAVERSINE_HALF_PI));
+    
+    __m256d Result = _mm256_blendv_pd(P, Unfolded, IsLarge);
+    return Result;
+}
+
+TARGET_AVX2 static __m256d HaversineX4(__m256d X0, __m256d Y0, __m256d X1, __m256d Y1, __m256d EarthRadius)
+{
+    __m256d RadiansPerDegree = _mm256_set1_pd(HAVERSINE_RADIANS_PER_DEGREE);
+    __m256d Half = _mm256_set1_pd(0.5);
+    
+    __m256d dLat = _mm256_mul_pd(_mm256_sub_pd(Y1, Y0), RadiansPerDegree);
+    __m256d dLon = _mm256_mul_pd(_mm256_sub_pd(X1, X0), RadiansPerDegree);
+    __m256d Lat1 = _mm256_mul_pd(Y0, RadiansPerDegree);
+    __m256d Lat2 = _mm256_mul_pd(Y1, RadiansPerDegree);
+    
+    __m256d SinLat = SinX4(_mm256_mul_pd(dLat, Half));
+    __m256d SinLon = SinX4(_mm256_mul_pd(dLon, Half));
+    __m256d CosProduct = _mm256_mul_pd(CosX4(Lat1), CosX4(Lat2));
+    
+    __m256d A = _mm256_fmadd_pd(_mm256_mul_pd(CosProduct, SinLon), SinLon, _mm256_mul_pd(SinLat, SinLat));
+    A = _mm256_min_pd(A, _mm256_set1_pd(1.0));
+    
+    __m256d C = _mm256_mul_pd(_mm256_set1_pd(2.0), AsinX4(_mm256_sqrt_pd(A)));
+    
+    __m256d Result = _mm256_mul_pd(EarthRadius, C);
+    return Result;
+}
+
+TARGET_AVX2 static __m256d HaversinePairsX4(haversine_pair *Pairs, __m256d EarthRadius)
+{
+    // NOTE: Four {X0, Y0, X1, Y1} rows transposed into four columns
+    __m256d P0 = _mm256_loadu_pd(&Pairs[0].X0);
+    __m256d P1 = _mm256_loadu_pd(&Pairs[1].X0);
+    __m256d P2 = _mm256_loadu_pd(&Pairs[2].X0);
+    __m256d P3 = _mm256_loadu_pd(&Pairs[3].X0);
+    
+    __m256d X01 = _mm256_unpacklo_pd(P0, P1);
+    __m256d Y01 = _mm256_unpackhi_pd(P0, P1);
+    __m256d X23 = _mm256_unpacklo_pd(P2, P3);
+    __m256d Y23 = _mm256_unpackhi_pd(P2, P3);
+    
+    __m256d X0 = _mm256_permute2f128_pd(X01, X23, 0x20);
+    __m256d X1 = _mm256_permute2f128_pd(X01, X23, 0x31);
+    __m256d Y0 = _mm256_permute2f128_pd(Y01, Y23, 0x20);
+    __m256d Y1 = _mm256_permute2f128_pd(Y01, Y23, 0x31);
+    
+    __m256d Result = HaversineX4(X0, Y0, X1, Y1, EarthRadius);
+    return Result;
+}
+
+TARGET_AVX2 static f64 SumHaversineAVX2(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius)
+{
+    TimeBandwidth(__func__, PairCount*sizeof(haversine_pair));
+    
+    __m256d Radius = _mm256_set1_pd(EarthRadius);
+    __m256d SumCoef = _mm256_set1_pd(1 / (f64)PairCount);
+    __m256d Sums = _mm256_setzero_pd();
+    
+    u64 PairIndex = 0;
+    for(; (PairIndex + 4) <= PairCount; PairIndex += 4)
+    {
+        Sums = _mm256_add_pd(Sums, _mm256_mul_pd(SumCoef, HaversinePairsX4(Pairs + PairIndex, Radius)));
+    }
+    
+    if(PairIndex < PairCount)
+    {
+        // NOTE: Pairs of all zeros have a distance of exactly zero, so they can pad out the last group
+        haversine_pair Tail[4] = {};
+        memcpy(Tail, Pairs + PairIndex, (PairCount - PairIndex)*sizeof(haversine_pair));
+        Sums = _mm256_add_pd(Sums, _mm256_mul_pd(SumCoef, HaversinePairsX4(Tail, Radius)));
+    }
+    
+    f64 Lanes[4];
+    _mm256_storeu_pd(Lanes, Sums);
+    
+    f64 Result = (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+    return Result;
+}
+
+TARGET_AVX2 static void HaversineDistancesAVX2(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius, f64 *Distances)
+{
+    __m256d Radius = _mm256_set1_pd(EarthRadius);
+    
+    u64 PairIndex = 0;
+    for(; (PairIndex + 4) <= PairCount; PairIndex += 4)
+    {
+        _mm256_storeu_pd(Distances + PairIndex, HaversinePairsX4(Pairs + PairIndex, Radius));
+    }
+    
+    if(PairIndex < PairCount)
+    {
+        haversine_pair Tail[4] = {};
+        memcpy(Tail, Pairs + PairIndex, (PairCount - PairIndex)*sizeof(haversine_pair));
+        
+        f64 TailDistances[4];
+        _mm256_storeu_pd(TailDistances, HaversinePairsX4(Tail, Radius));
+        memcpy(Distances + PairIndex, TailDistances, (PairCount - PairIndex)*sizeof(f64));
+    }
+}
+
+//
+// NOTE: AVX-512
+//
+
+#if __GNUC__ && !__clang__
+// NOTE: GCC 12's avx512fintrin.h initializes its "undefined" registers from themselves, which -Wall
+// reports as a use of an uninitialized value wherever one of those intrinsics gets inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+TARGET_AVX512 static __m512d EvaluatePolynomialX8(f64 const *Coefficients, u32 Count, __m512d X)
+{
+    __m512d Result = _mm512_set1_pd(Coefficients[Count - 1]);
+    for(u32 Index = Count - 1; Index > 0; --Index)
+    {
+        Result = _mm512_fmadd_pd(Result, X, _mm512_set1_pd(Coefficients[Index - 1]));
+    }
+    
+    return Result;
+}
+
+TARGET_AVX512 static __m512d ReduceByPiX8(__m512d X, __m512i *Sign)
+{
+    __m512d Magic = _mm512_set1_pd(HAVERSINE_ROUNDING_MAGIC);
+    __m512d Shifted = _mm512_fmadd_pd(X, _mm512_set1_pd(HAVERSINE_INV_PI), Magic);
+    __m512d K = _mm512_sub_pd(Shifted, Magic);
+    
+    *Sign = _mm512_slli_epi64(_mm512_castpd_si512(Shifted), 63);
+    
+    __m512d Result = _mm512_fnmadd_pd(K, _mm512_set1_pd(HAVERSINE_PI_HIGH), X);
+    Result = _mm512_fnmadd_pd(K, _mm512_set1_pd(HAVERSINE_PI_LOW), Result);
+    return Result;
+}
+
+TARGET_AVX512 static __m512d SinX8(__m512d X)
+{
+    __m512i Sign;
+    __m512d R = ReduceByPiX8(X, &Sign);
+    __m512d Result = _mm512_mul_pd(R, EvaluatePolynomialX8(SinCoefficients, ArrayCount(SinCoefficients), _mm512_mul_pd(R, R)));
+    Result = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(Result), Sign));
+    return Result;
+}
+
+TARGET_AVX512 static __m512d CosX8(__m512d X)
+{
+    __m512i Sign;
+    __m512d R = ReduceByPiX8(X, &Sign);
+    __m512d Result = EvaluatePolynomialX8(CosCoefficients, ArrayCount(CosCoefficients), _mm512_mul_pd(R, R));
+    Result = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(Result), Sign));
+    return Result;
+}
+
+TARGET_AVX512 static __m512d AsinX8(__m512d X)
+{
+    __m512d Half = _mm512_set1_pd(0.5);
+    __mmask8 IsLarge = _mm512_cmp_pd_mask(X, Half, _CMP_GT_OQ);
+    
+    __m512d Folded = _mm512_sqrt_pd(_mm512_mul_pd(_mm512_sub_pd(_mm512_set1_pd(1.0), X), Half));
+    __m512d Z = _mm512_mask_blend_pd(IsLarge, X, Folded);
+    
+    __m512d P = _mm512_mul_pd(Z, EvaluatePolynomialX8(AsinCoefficients, ArrayCount(AsinCoefficients), _mm512_mul_pd(Z, Z)));
+    __m512d Unfolded = _mm512_fnmadd_pd(_mm512_set1_pd(2.0), P, _mm512_set1_pd(HAVERSINE_HALF_PI));
+    
+    __m512d Result = _mm512_mask_blend_pd(IsLarge, P, Unfolded);
+    return Result;
+}
+
+TARGET_AVX512 static __m512d HaversineX8(__m512d X0, __m512d Y0, __m512d X1, __m512d Y1, __m512d EarthRadius)
+{
+    __m512d RadiansPerDegree = _mm512_set1_pd(HAVERSINE_RADIANS_PER_DEGREE);
+    __m512d Half = _mm512_set1_pd(0.5);
+    
+    __m512d dLat = _mm512_mul_pd(_mm512_sub_pd(Y1, Y0), RadiansPerDegree);
+    __m512d dLon = _mm512_mul_pd(_mm512_sub_pd(X1, X0), RadiansPerDegree);
+    __m512d Lat1 = _mm512_mul_pd(Y0, RadiansPerDegree);
+    __m512d Lat2 = _mm512_mul_pd(Y1, RadiansPerDegree);
+    
+    __m512d SinLat = SinX8(_mm512_mul_pd(dLat, Half));
+    __m512d SinLon = SinX8(_mm512_mul_pd(dLon, Half));
+    __m512d CosProduct = _mm512_mul_pd(CosX8(Lat1), CosX8(Lat2));
+    
+    __m512d A = _mm512_fmadd_pd(_mm512_mul_pd(CosProduct, SinLon), SinLon, _mm512_mul_pd(SinLat, SinLat));
+    A = _mm512_min_pd(A, _mm512_set1_pd(1.0));
+    
+    __m512d C = _mm512_mul_pd(_mm512_set1_pd(2.0), AsinX8(_mm512_sqrt_pd(A)));
+    
+    __m512d Result = _mm512_mul_pd(EarthRadius, C);
+    return Result;
+}
+
+TARGET_AVX512 static __m512d HaversinePairsX8(haversine_pair *Pairs, __m512d EarthRadius)
+{
+    // NOTE: Two pairs per load. The first round of permutes gathers X0s and Y0s (or X1s and Y1s)
+    // of four pairs into each half of a register, and the second round joins the halves.
+    __m512d P01 = _mm512_loadu_pd(&Pairs[0].X0);
+    __m512d P23 = _mm512_loadu_pd(&Pairs[2].X0);
+    __m512d P45 = _mm512_loadu_pd(&Pairs[4].X0);
+    __m512d P67 = _mm512_loadu_pd(&Pairs[6].X0);
+    
+    __m512i Start = _mm512_setr_epi64(0, 4, 8, 12, 1, 5, 9, 13);
+    __m512i End = _mm512_setr_epi64(2, 6, 10, 14, 3, 7, 11, 15);
+    __m512i LowHalves = _mm512_setr_epi64(0, 1, 2, 3, 8, 9, 10, 11);
+    __m512i HighHalves = _mm512_setr_epi64(4, 5, 6, 7, 12, 13, 14, 15);
+    
+    __m512d Start0123 = _mm512_permutex2var_pd(P01, Start, P23);
+    __m512d End0123 = _mm512_permutex2var_pd(P01, End, P23);
+    __m512d Start4567 = _mm512_permutex2var_pd(P45, Start, P67);
+    __m512d End4567 = _mm512_permutex2var_pd(P45, End, P67);
+    
+    __m512d X0 = _mm512_permutex2var_pd(Start0123, LowHalves, Start4567);
+    __m512d Y0 = _mm512_permutex2var_pd(Start0123, HighHalves, Start4567);
+    __m512d X1 = _mm512_permutex2var_pd(End0123, LowHalves, End4567);
+    __m512d Y1 = _mm512_permutex2var_pd(End0123, HighHalves, End4567);
+    
+    __m512d Result = HaversineX8(X0, Y0, X1, Y1, EarthRadius);
+    return Result;
+}
+
+TARGET_AVX512 static f64 SumHaversineAVX512(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius)
+{
+    TimeBandwidth(__func__, PairCount*sizeof(haversine_pair));
+    
+    __m512d Radius = _mm512_set1_pd(EarthRadius);
+    __m512d SumCoef = _mm512_set1_pd(1 / (f64)PairCount);
+    __m512d Sums = _mm512_setzero_pd();
+    
+    u64 PairIndex = 0;
+    for(; (PairIndex + 8) <= PairCount; PairIndex += 8)
+    {
+        Sums = _mm512_add_pd(Sums, _mm512_mul_pd(SumCoef, HaversinePairsX8(Pairs + PairIndex, Radius)));
+    }
+    
+    if(PairIndex < PairCount)
+    {
+        haversine_pair Tail[8] = {};
+        memcpy(Tail, Pairs + PairIndex, (PairCount - PairIndex)*sizeof(haversine_pair));
+        Sums = _mm512_add_pd(Sums, _mm512_mul_pd(SumCoef, HaversinePairsX8(Tail, Radius)));
+    }
+    
+    f64 Lanes[8];
+    _mm512_storeu_pd(Lanes, Sums);
+    
+    f64 Result = (((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) +
+                  ((Lanes[4] + Lanes[5]) + (Lanes[6] + Lanes[7])));
+    return Result;
+}
+
+TARGET_AVX512 static void HaversineDistancesAVX512(u64 PairCount, haversine_pair *Pairs, f64 EarthRadius, f64 *Distances)
+{
+    __m512d Radius = _mm512_set1_pd(EarthRadius);
+    
+    u64 PairIndex = 0;
+    for(; (PairIndex + 8) <= PairCount; PairIndex += 8)
+    {
+        _mm512_storeu_pd(Distances + PairIndex, HaversinePairsX8(Pairs + PairIndex, Radius));
+    }
+    
+    if(PairIndex < PairCount)
+    {
+        haversine_pair Tail[8] = {};
+        memcpy(Tail, Pairs + PairIndex, (PairCount - PairIndex)*sizeof(haversine_pair));
+        
+        f64 TailDistances[8];
+        _mm512_storeu_pd(TailDistances, HaversinePairsX8(Tail, Radius));
+        memcpy(Distances + PairIndex, TailDistances, (PairCount - PairIndex)*sizeof(f64));
+    }
+}
+
+#if __GNUC__ && !__clang__
+#pragma GCC diagnostic pop
+#endif
+
+//
+// NOTE: Selection
+//
+
+static b32 IsHaversineKernelSupported(haversine_kernel Kernel)
+{
+    // NOTE: The CPU having the instructions isn't enough. The OS also has to save the wider
+    // registers on a context switch, which is what the XCR0 bits say. ReadCPUID and ReadXCR0
+    // are listing 126's.
+    u32 Leaf0[4] = {};
+    u32 Leaf1[4] = {};
+    u32 Leaf7[4] = {};
+    ReadCPUID(0, 0, Leaf0);
+    if(Leaf0[0] >= 7)
+    {
+        ReadCPUID(1, 0, Leaf1);
+        ReadCPUID(7, 0, Leaf7);
+    }
+    
+    b32 HasOSXSAVE = (Leaf1[2] & (1 << 27)) != 0;
+    u64 XCR0 = HasOSXSAVE ? ReadXCR0() : 0;
+    
+    b32 HasAVX2 = (HasOSXSAVE &&
+                   ((XCR0 & 0x6) == 0x6) &&
+                   (Leaf1[2] & (1 << 12)) && // NOTE: FMA
+                   (Leaf1[2] & (1 << 28)) && // NOTE: AVX
+                   (Leaf7[1] & (1 << 5)));   // NOTE: AVX2
+    b32 HasAVX512 = (HasAVX2 &&
+                     ((XCR0 & 0xE6) == 0xE6) &&
+                     (Leaf7[1] & (1 << 16)));  // NOTE: AVX-512F
+    
+    b32 Result = false;
+    switch(Kernel)
+    {
+        case HaversineKernel_Reference: {Result = true;} break;
+        case HaversineKernel_AVX2: {Result = HasAVX2;} break;
+        case HaversineKernel_AVX512: {Result = HasAVX512;} break;
+        default: {} break;
+    }
+    
+    return Result;
+}
+
+static haversine_kernel GetBestHaversineKernel(void)
+{
+    haversine_kernel Result = HaversineKernel_Reference;
+    for(u32 Kernel = 0; Kernel < HaversineKernel_Count; ++Kernel)
+    {
+        if(IsHaversineKernelSupported((haversine_kernel)Kernel))
+        {
+            Result = (haversine_kernel)Kernel;
+        }
+    }
+    
+    return Result;
+}
+
+static haversine_kernel_funcs GetHaversineKernelFuncs(haversine_kernel Kernel)
+{
+    haversine_kernel_funcs Result = {SumHaversineReference, HaversineDistancesReference};
+    switch(Kernel)
+    {
+        case HaversineKernel_AVX2: {Result = {SumHaversineAVX2, HaversineDistancesAVX2};} break;
+        case HaversineKernel_AVX512: {Result = {SumHaversineAVX512, HaversineDistancesAVX512};} break;
+        default: {} break;
+    }
+    
+    return Result;
+}
@@ -0,0 +1,207 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 146
+   ======================================================================== */
+
+/* NOTE: Pairs stored as four separate columns (X0s, Y0s, X1s, Y1s) instead of an array of
+   {X0, Y0, X1, Y1}. A SIMD kernel can then load 4 or 8 of the same coordinate with one aligned
+   load, with no transposing. Every column starts on a 64-byte boundary and has room for a
+   multiple of 8 pairs, and the extra slots are zero, so the kernels can always run whole
+   vectors. Pairs of all zeros have a distance of exactly zero, so they don't change the sums.
+   
+   The binary pair files from listing 136 already follow the same rules (64-byte aligned
+   columns, zero padding), so the column kernels here work on them directly too. Needs
+   listings 123 (OSAllocate), 136 (haversine_pair_columns) and 144 (the vector math). */
+
+#define PAIR_COLUMN_VECTOR_COUNT 8
+
+struct pair_column_storage
+{
+    haversine_pair_columns Columns;
+    u64 Capacity;
+    
+    u8 *Memory;
+    u64 MemorySize;
+};
+
+static pair_column_storage AllocatePairColumns(u64 MaxPairCount)
+{
+    // NOTE: OSAllocate hands back zeroed pages, which takes care of the padding
+    pair_column_storage Result = {};
+    
+    u64 Capacity = (MaxPairCount + PAIR_COLUMN_VECTOR_COUNT - 1) & ~(u64)(PAIR_COLUMN_VECTOR_COUNT - 1);
+    u64 ColumnSize = Capacity*sizeof(f64);
+    
+    Result.Memory = OSAllocate(4*ColumnSize, false);
+    if(Result.Memory)
+    {
+        Result.Capacity = Capacity;
+        Result.MemorySize = 4*ColumnSize;
+        Result.Columns.X0 = (f64 *)(Result.Memory + 0*ColumnSize);
+        Result.Columns.Y0 = (f64 *)(Result.Memory + 1*ColumnSize);
+        Result.Columns.X1 = (f64 *)(Result.Memory + 2*ColumnSize);
+        Result.Columns.Y1 = (f64 *)(Result.Memory + 3*ColumnSize);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %llu bytes.\n", 4*ColumnSize);
+    }
+    
+    return Result;
+}
+
+static void FreePairColumns(pair_column_storage *Storage)
+{
+    if(Storage->Memory)
+    {
+        OSFree(Storage->Memory, Storage->MemorySize);
+    }
+    *Storage = {};
+}
+
+static u64 ParseHaversinePairColumns(buffer InputJSON, pair_column_storage *Storage, arena *Arena = 0)
+{
+    // NOTE: Same as ParseHaversinePairs, but each coordinate goes straight into its column
+    TimeFunction;
+    
+    haversine_pair_columns *Columns = &Storage->Columns;
+    u64 MaxPairCount = Storage->Capacity;
+    u64 PairCount = 0;
+    
+    json_element *JSON = ParseJSON(InputJSON, Arena);
+    
+    json_element *PairsArray = LookupElement(JSON, CONSTANT_STRING("pairs"));
+    if(PairsArray)
+    {
+        TimeBlock("Lookup and Convert");
+        
+        for(json_element *Element = PairsArray->FirstSubElement;
+            Element && (PairCount < MaxPairCount);
+            Element = Element->NextSibling)
+        {
+            Columns->X0[PairCount] = ConvertElementToF64(Element, CONSTANT_STRING("x0"));
+            Columns->Y0[PairCount] = ConvertElementToF64(Element, CONSTANT_STRING("y0"));
+            Columns->X1[PairCount] = ConvertElementToF64(Element, CONSTANT_STRING("x1"));
+            Columns->Y1[PairCount] = ConvertElementToF64(Element, CONSTANT_STRING("y1"));
+            ++PairCount;
+        }
+    }
+    
+    Columns->PairCount = PairCount;
+    
+    if(Arena)
+    {
+        TimeBlock("ResetArena");
+        ResetArena(Arena);
+    }
+    else
+    {
+        TimeBlock("FreeJSON");
+        FreeJSON(JSON);
+    }
+    
+    return PairCount;
+}
+
+typedef f64 haversine_columns_sum_func(haversine_pair_columns Columns, f64 EarthRadius);
+
+static f64 SumHaversineReferenceColumns(haversine_pair_columns Columns, f64 EarthRadius)
+{
+    TimeBandwidth(__func__, Columns.PairCount*sizeof(haversine_pair));
+    
+    f64 Sum = 0;
+    
+    f64 SumCoef = 1 / (f64)Columns.PairCount;
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; ++PairIndex)
+    {
+        f64 Dist = ReferenceHaversine(Columns.X0[PairIndex], Columns.Y0[PairIndex],
+                                      Columns.X1[PairIndex], Columns.Y1[PairIndex], EarthRadius);
+        Sum += SumCoef*Dist;
+    }
+    
+    return Sum;
+}
+
+TARGET_AVX2 static f64 SumHaversineAVX2Columns(haversine_pair_columns Columns, f64 EarthRadius)
+{
+    TimeBandwidth(__func__, Columns.PairCount*sizeof(haversine_pair));
+    
+    __m256d Radius = _mm256_set1_pd(EarthRadius);
+    __m256d SumCoef = _mm256_set1_pd(1 / (f64)Columns.PairCount);
+    __m256d Sums = _mm256_setzero_pd();
+    
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; PairIndex += 4)
+    {
+        __m256d X0 = _mm256_load_pd(Columns.X0 + PairIndex);
+        __m256d Y0 = _mm256_load_pd(Columns.Y0 + PairIndex);
+        __m256d X1 = _mm256_load_pd(Columns.X1 + PairIndex);
+        __m256d Y1 = _mm256_load_pd(Columns.Y1 + PairIndex);
+        Sums = _mm256_add_pd(Sums, _mm256_mul_pd(SumCoef, HaversineX4(X0, Y0, X1, Y1, Radius)));
+    }
+    
+    f64 Lanes[4];
+    _mm256_storeu_pd(Lanes, Sums);
+    
+    f64 Result = (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+    return Result;
+}
+
+#if __GNUC__ && !__clang__
+// NOTE: Same GCC 12 avx512fintrin.h warning as in listing 144, which can show up here as "maybe" uninitialized once HaversineX8 is inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+TARGET_AVX512 static f64 SumHaversineAVX512Columns(haversine_pair_columns Columns, f64 EarthRadius)
+{
+    TimeBandwidth(__func__, Columns.PairCount*sizeof(haversine_pair));
+    
+    __m512d Radius = _mm512_set1_pd(EarthRadius);
+    __m512d SumCoef = _mm512_set1_pd(1 / (f64)Columns.PairCount);
+    __m512d Sums = _mm512_setzero_pd();
+    
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; PairIndex += 8)
+    {
+        __m512d X0 = _mm512_load_pd(Columns.X0 + PairIndex);
+        __m512d Y0 = _mm512_load_pd(Columns.Y0 + PairIndex);
+        __m512d X1 = _mm512_load_pd(Columns.X1 + PairIndex);
+        __m512d Y1 = _mm512_load_pd(Columns.Y1 + PairIndex);
+        Sums = _mm512_add_pd(Sums, _mm512_mul_pd(SumCoef, HaversineX8(X0, Y0, X1, Y1, Radius)));
+    }
+    
+    f64 Lanes[8];
+    _mm512_storeu_pd(Lanes, Sums);
+    
+    f64 Result = (((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) +
+                  ((Lanes[4] + Lanes[5]) + (Lanes[6] + Lanes[7])));
+    return Result;
+}
+
+#if __GNUC__ && !__clang__
+#pragma GCC diagnostic pop
+#endif
+
+static haversine_columns_sum_func *GetHaversineColumnsSumFunc(haversine_kernel Kernel)
+{
+    haversine_columns_sum_func *Result = SumHaversineReferenceColumns;
+    switch(Kernel)
+    {
+        case HaversineKernel_AVX2: {Result = SumHaversineAVX2Columns;} break;
+        case HaversineKernel_AVX512: {Result = SumHaversineAVX512Columns;} break;
+        default: {} break;
+    }
+    
+    return Result;
+}
@@ -0,0 +1,283 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 147
+   ======================================================================== */
+
+/* NOTE: Same as listing 145, except that the pairs are also parsed into columns (listing
+   146) and every kernel sums both layouts, so the profile shows the two side by side. The
+   column kernels visit the pairs in the same order as the others, with the same lanes, so
+   the two sums for a kernel have to match exactly. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#define PROFILER 1
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0132_field_index_json_parser.cpp"
+#include "listing_0134_parallel_haversine_parser.cpp"
+#include "listing_0136_haversine_pair_file.cpp"
+#include "listing_0144_simd_haversine.cpp"
+#include "listing_0146_pair_columns.cpp"
+
+static buffer ReadEntireFile(char *FileName)
+{
+    TimeFunction;
+    
+    buffer Result = {};
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        Result = AllocateBuffer(Stat.st_size);
+        if(Result.Data)
+        {
+            TimeBandwidth("fread", Result.Count);
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+static void ValidateKernel(haversine_kernel_funcs Funcs, buffer Answers, u64 PairCount, haversine_pair *Pairs, f64 Sum)
+{
+    f64 *AnswerValues = (f64 *)Answers.Data;
+    u64 RefAnswerCount = (Answers.Count - sizeof(f64)) / sizeof(f64);
+    if(PairCount != RefAnswerCount)
+    {
+        fprintf(stdout, "  FAILED - pair count doesn't match %llu.\n", RefAnswerCount);
+    }
+    else
+    {
+        buffer DistanceBuffer = AllocateBuffer(PairCount*sizeof(f64));
+        if(DistanceBuffer.Count)
+        {
+            f64 *Distances = (f64 *)DistanceBuffer.Data;
+            Funcs.Distances(PairCount, Pairs, 6372.8, Distances);
+            
+            f64 MaxError = 0;
+            u64 MaxErrorIndex = 0;
+            for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+            {
+                f64 Error = fabs(Distances[PairIndex] - AnswerValues[PairIndex]);
+                if(Error > MaxError)
+                {
+                    MaxError = Error;
+                    MaxErrorIndex = PairIndex;
+                }
+            }
+            
+            fprintf(stdout, "  Max per-pair error: %.3e km (pair %llu)\n", MaxError, MaxErrorIndex);
+            fprintf(stdout, "  Sum difference: %.3e\n", Sum - AnswerValues[RefAnswerCount]);
+        }
+        
+        FreeBuffer(&DistanceBuffer);
+    }
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&FreeJSON;
+    (void)&TryToEnableLargePages;
+    (void)&ParseHaversinePairsParallel;
+    (void)&MapFileReadOnly;
+    (void)&UnmapFile;
+    (void)&GetHaversinePairColumns;
+    
+    BeginProfile();
+    
+    int Result = 1;
+    
+    // NOTE: -kernel can go anywhere on the command line
+    haversine_kernel FirstKernel = GetBestHaversineKernel();
+    b32 RunAllKernels = false;
+    char *FileNames[2] = {};
+    u32 FileNameCount = 0;
+    b32 ValidArgs = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        if((strcmp(Args[ArgIndex], "-kernel") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            char *Name = Args[++ArgIndex];
+            RunAllKernels = (strcmp(Name, "all") == 0);
+            FirstKernel = RunAllKernels ? HaversineKernel_Reference : HaversineKernel_Count;
+            for(u32 Kernel = 0; Kernel < HaversineKernel_Count; ++Kernel)
+            {
+                if(strcmp(Name, HaversineKernelNames[Kernel]) == 0)
+                {
+                    FirstKernel = (haversine_kernel)Kernel;
+                }
+            }
+            
+            ValidArgs = ValidArgs && (FirstKernel != HaversineKernel_Count) && IsHaversineKernelSupported(FirstKernel);
+        }
+        else if(FileNameCount < ArrayCount(FileNames))
+        {
+            FileNames[FileNameCount++] = Args[ArgIndex];
+        }
+        else
+        {
+            ValidArgs = false;
+        }
+    }
+    
+    if(ValidArgs && FileNameCount)
+    {
+        buffer InputJSON = ReadEntireFile(FileNames[0]);
+        
+        u32 MinimumJSONPairEncoding = 6*4;
+        u64 MaxPairCount = InputJSON.Count / MinimumJSONPairEncoding;
+        if(MaxPairCount)
+        {
+            buffer ParsedValues = AllocateBuffer(MaxPairCount * sizeof(haversine_pair));
+            if(ParsedValues.Count)
+            {
+                haversine_pair *Pairs = (haversine_pair *)ParsedValues.Data;
+                
+                u64 PairCount = ParseHaversinePairs(InputJSON, MaxPairCount, Pairs);
+                
+                pair_column_storage Storage = AllocatePairColumns(MaxPairCount);
+                ParseHaversinePairColumns(InputJSON, &Storage);
+                haversine_pair_columns Columns = Storage.Columns;
+                
+                b32 SamePairs = (Columns.PairCount == PairCount);
+                for(u64 PairIndex = 0; SamePairs && (PairIndex < PairCount); ++PairIndex)
+                {
+                    haversine_pair Pair = Pairs[PairIndex];
+                    SamePairs = ((Pair.X0 == Columns.X0[PairIndex]) && (Pair.Y0 == Columns.Y0[PairIndex]) &&
+                                 (Pair.X1 == Columns.X1[PairIndex]) && (Pair.Y1 == Columns.Y1[PairIndex]));
+                }
+                
+                buffer AnswersF64 = {};
+                if(FileNameCount == 2)
+                {
+                    AnswersF64 = ReadEntireFile(FileNames[1]);
+                }
+                
+                fprintf(stdout, "Input size: %llu\n", InputJSON.Count);
+                fprintf(stdout, "Pair count: %llu\n", PairCount);
+                fprintf(stdout, "Column parse: %s\n", SamePairs ? "identical" : "DIFFERENT");
+                
+                b32 LayoutsAgree = (PairCount && SamePairs);
+                for(u32 Kernel = 0; LayoutsAgree && (Kernel < HaversineKernel_Count); ++Kernel)
+                {
+                    if((RunAllKernels || (Kernel == FirstKernel)) && IsHaversineKernelSupported((haversine_kernel)Kernel))
+                    {
+                        haversine_kernel_funcs Funcs = GetHaversineKernelFuncs((haversine_kernel)Kernel);
+                        f64 Sum = Funcs.Sum(PairCount, Pairs, 6372.8);
+                        f64 ColumnsSum = GetHaversineColumnsSumFunc((haversine_kernel)Kernel)(Columns, 6372.8);
+                        
+                        LayoutsAgree = LayoutsAgree && (Sum == ColumnsSum);
+                        
+                        fprintf(stdout, "\n%s haversine sum: %.16f\n", HaversineKernelNames[Kernel], Sum);
+                        fprintf(stdout, "  From columns: %.16f (%s)\n", ColumnsSum, (Sum == ColumnsSum) ? "identical" : "DIFFERENT");
+                        if(AnswersF64.Count >= sizeof(f64))
+                        {
+                            ValidateKernel(Funcs, AnswersF64, PairCount, Pairs, Sum);
+                        }
+                    }
+                }
+                
+                Result = LayoutsAgree ? 0 : 1;
+                
+                FreePairColumns(&Storage);
+                
+                fprintf(stdout, "\n");
+                
+                FreeBuffer(&AnswersF64);
+            }
+            
+            FreeBuffer(&ParsedValues);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Malformed input JSON\n");
+        }
+        
+        FreeBuffer(&InputJSON);
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [haversine_input.json] [-kernel reference/avx2/avx512/all]\n", Args[0]);
+        fprintf(stderr, "       %s [haversine_input.json] [answers.f64] [-kernel reference/avx2/avx512/all]\n", Args[0]);
+    }
+    
+    if(Result == 0)
+	{
+        EndAndPrintProfile();
+	}
+    
+    return Result;
+}
+
+ProfilerEndOfCompilationUnit;
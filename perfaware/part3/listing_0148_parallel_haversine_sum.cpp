@@ -0,0 +1,255 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 148
+   ======================================================================== */
+
+/* NOTE: Sums the haversine distances on a pool of threads, and gets the same bits back no
+   matter how many threads there are. The pairs are cut into fixed blocks of
+   SUM_BLOCK_PAIR_COUNT, so where a block starts and ends never depends on the thread
+   count. Each block is summed in order with Kahan compensation into its own slot, and the
+   slots are then added up in a fixed pairwise tree. Which thread did which block can't
+   change the result, since every addition still happens in the same order.
+   
+   The threads are started once and then wait on a semaphore for each sum, so timing a sum
+   doesn't include starting threads. Threads take every ThreadCount'th block, which keeps
+   them all busy to within a block at the end without needing atomics.
+   
+   The per-pair math is whichever Distances function from listing 144 is passed in, so the
+   result does depend on the kernel, just not on the thread count. Needs listings 134
+   (threads) and 142 (semaphores). */
+
+#define SUM_BLOCK_PAIR_COUNT 4096
+#define MAX_SUM_THREAD_COUNT 64
+
+struct sum_thread_pool;
+
+struct sum_worker
+{
+    sum_thread_pool *Pool;
+    u32 WorkerIndex;
+    
+    os_semaphore Start;
+    os_thread Thread;
+    os_thread_start ThreadStart;
+};
+
+struct sum_job
+{
+    haversine_distances_func *Distances;
+    u64 PairCount;
+    haversine_pair *Pairs;
+    f64 EarthRadius;
+    
+    u64 BlockCount;
+    f64 *BlockSums;
+};
+
+struct sum_thread_pool
+{
+    // NOTE: ThreadCount includes the thread that calls SumHaversineParallel, which does worker 0's share
+    u32 ThreadCount;
+    b32 Quit;
+    
+    sum_job Job;
+    os_semaphore Done;
+    
+    sum_worker Workers[MAX_SUM_THREAD_COUNT];
+};
+
+static u32 GetLogicalCoreCount(void)
+{
+#if _WIN32
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    u32 Result = Info.dwNumberOfProcessors;
+#else
+    long Count = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 Result = (Count > 0) ? (u32)Count : 1;
+#endif
+    
+    return Result;
+}
+
+static f64 SumHaversineBlock(haversine_distances_func *Distances, u64 PairCount, haversine_pair *Pairs, f64 EarthRadius)
+{
+    f64 BlockDistances[SUM_BLOCK_PAIR_COUNT];
+    Distances(PairCount, Pairs, EarthRadius, BlockDistances);
+    
+    f64 Sum = 0;
+    f64 Compensation = 0;
+    for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+    {
+        f64 Value = BlockDistances[PairIndex] - Compensation;
+        f64 NewSum = Sum + Value;
+        Compensation = (NewSum - Sum) - Value;
+        Sum = NewSum;
+    }
+    
+    return Sum;
+}
+
+static void RunSumJob(sum_thread_pool *Pool, u32 WorkerIndex)
+{
+    sum_job *Job = &Pool->Job;
+    for(u64 BlockIndex = WorkerIndex; BlockIndex < Job->BlockCount; BlockIndex += Pool->ThreadCount)
+    {
+        u64 FirstPair = BlockIndex*SUM_BLOCK_PAIR_COUNT;
+        u64 PairCount = Job->PairCount - FirstPair;
+        if(PairCount > SUM_BLOCK_PAIR_COUNT)
+        {
+            PairCount = SUM_BLOCK_PAIR_COUNT;
+        }
+        
+        Job->BlockSums[BlockIndex] = SumHaversineBlock(Job->Distances, PairCount, Job->Pairs + FirstPair, Job->EarthRadius);
+    }
+}
+
+static void SumWorkerThread(void *Param)
+{
+    // NOTE: Runs on its own thread, so nothing in here may touch the profiler
+    sum_worker *Worker = (sum_worker *)Param;
+    sum_thread_pool *Pool = Worker->Pool;
+    
+    for(;;)
+    {
+        WaitOSSemaphore(&Worker->Start);
+        if(Pool->Quit)
+        {
+            break;
+        }
+        
+        RunSumJob(Pool, Worker->WorkerIndex);
+        SignalOSSemaphore(&Pool->Done);
+    }
+}
+
+static sum_thread_pool *CreateSumThreadPool(u32 ThreadCount)
+{
+    if(ThreadCount < 1)
+    {
+        ThreadCount = 1;
+    }
+    if(ThreadCount > MAX_SUM_THREAD_COUNT)
+    {
+        ThreadCount = MAX_SUM_THREAD_COUNT;
+    }
+    
+    // NOTE: The workers keep a pointer to the pool, so it has to live somewhere that doesn't move
+    sum_thread_pool *Result = (sum_thread_pool *)calloc(1, sizeof(sum_thread_pool));
+    if(Result && !InitOSSemaphore(&Result->Done, 0, MAX_SUM_THREAD_COUNT))
+    {
+        free(Result);
+        Result = 0;
+    }
+    
+    if(Result)
+    {
+        // NOTE: If a worker's semaphore can't be made, the pool just runs with the workers it already has
+        Result->ThreadCount = 1;
+        for(u32 WorkerIndex = 1; WorkerIndex < ThreadCount; ++WorkerIndex)
+        {
+            sum_worker *Worker = Result->Workers + WorkerIndex;
+            if(!InitOSSemaphore(&Worker->Start, 0, 1))
+            {
+                break;
+            }
+            
+            Worker->Pool = Result;
+            Worker->WorkerIndex = WorkerIndex;
+            Worker->ThreadStart.Func = SumWorkerThread;
+            Worker->ThreadStart.Param = Worker;
+            Worker->Thread = StartOSThread(&Worker->ThreadStart);
+            Result->ThreadCount = WorkerIndex + 1;
+        }
+    }
+    
+    return Result;
+}
+
+static void DestroySumThreadPool(sum_thread_pool *Pool)
+{
+    if(Pool)
+    {
+        Pool->Quit = true;
+        for(u32 WorkerIndex = 1; WorkerIndex < Pool->ThreadCount; ++WorkerIndex)
+        {
+            SignalOSSemaphore(&Pool->Workers[WorkerIndex].Start);
+        }
+        
+        for(u32 WorkerIndex = 1; WorkerIndex < Pool->ThreadCount; ++WorkerIndex)
+        {
+            sum_worker *Worker = Pool->Workers + WorkerIndex;
+            JoinOSThread(Worker->Thread);
+            DestroyOSSemaphore(&Worker->Start);
+        }
+        
+        DestroyOSSemaphore(&Pool->Done);
+        free(Pool);
+    }
+}
+
+static f64 CombineBlockSums(u64 BlockCount, f64 *BlockSums)
+{
+    // NOTE: Pairwise, always in the same shape for the same BlockCount. Overwrites BlockSums.
+    for(u64 Stride = 1; Stride < BlockCount; Stride *= 2)
+    {
+        for(u64 BlockIndex = 0; (BlockIndex + Stride) < BlockCount; BlockIndex += 2*Stride)
+        {
+            BlockSums[BlockIndex] += BlockSums[BlockIndex + Stride];
+        }
+    }
+    
+    f64 Result = BlockCount ? BlockSums[0] : 0;
+    return Result;
+}
+
+static f64 SumHaversineParallel(sum_thread_pool *Pool, haversine_distances_func *Distances,
+                                u64 PairCount, haversine_pair *Pairs, f64 EarthRadius)
+{
+    TimeBandwidth(__func__, PairCount*sizeof(haversine_pair));
+    
+    f64 Result = 0;
+    
+    u64 BlockCount = (PairCount + SUM_BLOCK_PAIR_COUNT - 1) / SUM_BLOCK_PAIR_COUNT;
+    buffer BlockSums = AllocateBuffer(BlockCount*sizeof(f64));
+    if(BlockSums.Count)
+    {
+        sum_job *Job = &Pool->Job;
+        Job->Distances = Distances;
+        Job->PairCount = PairCount;
+        Job->Pairs = Pairs;
+        Job->EarthRadius = EarthRadius;
+        Job->BlockCount = BlockCount;
+        Job->BlockSums = (f64 *)BlockSums.Data;
+        
+        for(u32 WorkerIndex = 1; WorkerIndex < Pool->ThreadCount; ++WorkerIndex)
+        {
+            SignalOSSemaphore(&Pool->Workers[WorkerIndex].Start);
+        }
+        
+        RunSumJob(Pool, 0);
+        
+        for(u32 WorkerIndex = 1; WorkerIndex < Pool->ThreadCount; ++WorkerIndex)
+        {
+            WaitOSSemaphore(&Pool->Done);
+        }
+        
+        // NOTE: One divide at the end, instead of scaling every distance by 1/PairCount
+        Result = CombineBlockSums(BlockCount, Job->BlockSums) / (f64)PairCount;
+    }
+    
+    FreeBuffer(&BlockSums);
+    
+    return Result;
+}
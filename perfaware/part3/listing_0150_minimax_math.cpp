@@ -0,0 +1,269 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 150
+   ======================================================================== */
+
+/* NOTE: sin, cos, asin and sqrt that don't call into the CRT, so the haversine math is the
+   same code (and the same answers) on every platform. Each one reduces its input to a small
+   range and evaluates a minimax polynomial there. The coefficients were fit with the Remez
+   exchange algorithm at 60 digits, then rounded to f64:
+       
+       sin, cos - x - k*pi/2 brings x into [-pi/4, pi/4], with pi/2 subtracted in three
+                  parts so the reduction stays accurate. sin(r) = r + r^3*P(r^2), and
+                  cos(r) = 1 - r^2/2 + r^4*Q(r^2), and k picks which one, and the sign.
+                  Only good while k fits comfortably in an f64 mantissa, so anything over
+                  MINIMAX_MAX_TRIG_INPUT gives NaN. Haversine never goes past pi.
+       asin     - asin(x) = x + x^3*P(x^2) on [0, 0.5]. Above that, it uses
+                  asin(x) = pi/2 - 2*asin(sqrt((1 - x)/2)), which lands back in [0, 0.5].
+       sqrt     - the exponent is halved directly, which leaves a mantissa in [1, 4). A
+                  polynomial for 1/sqrt of that gets about 9 bits, three Newton steps get
+                  the rest, and a final correction uses the exact residual (from a Dekker
+                  product) to fix the last bit.
+   
+   The polynomial errors are all well below half an ulp. What is left is the rounding of
+   the evaluation itself, which listing 151 measures against the CRT.
+   
+   The Dekker product assumes a*b - p is not fused into an FMA by the compiler. That only
+   happens with FMA code generation turned on, so build with -ffp-contract=off if so. */
+
+#define MINIMAX_MAX_TRIG_INPUT 1.0e6
+
+// NOTE: pi/2 in three parts. The first two have only 33 significant bits, so k times them is exact.
+#define MINIMAX_PIO2_1 1.57079632673412561417e+00
+#define MINIMAX_PIO2_2 6.07710050630396597660e-11
+#define MINIMAX_PIO2_3 2.02226624879595063154e-21
+#define MINIMAX_TWO_OVER_PI 0.63661977236758134308
+
+// NOTE: pi/2 as the nearest f64 plus what that leaves out
+#define MINIMAX_HALF_PI_HIGH 1.57079632679489655800e+00
+#define MINIMAX_HALF_PI_LOW 6.12323399573676603587e-17
+
+// NOTE: Adding 1.5*2^52 rounds to an integer
+#define MINIMAX_ROUNDING_MAGIC 6755399441055744.0
+
+// NOTE: (sin(r) - r)/r^3 as a polynomial in r^2, on [0, (pi/4)^2]. Max error 2.0e-17.
+static f64 const MinimaxSinCoefficients[] =
+{
+    -0.16666666666666666, 0.00833333333333095, -0.00019841269836761008, 2.7557316103657487e-06,
+    -2.505113204972727e-08, 1.5918142569704652e-10,
+};
+
+// NOTE: (cos(r) - 1 + r^2/2)/r^4 as a polynomial in r^2, on [0, (pi/4)^2]. Max error 1.3e-18.
+static f64 const MinimaxCosCoefficients[] =
+{
+    0.041666666666666664, -0.0013888888888887398, 2.480158729876704e-05, -2.7557317272344146e-07,
+    2.0876146382220145e-09, -1.1382639805756885e-11,
+};
+
+// NOTE: (asin(x) - x)/x^3 as a polynomial in x^2, on [0, 0.25]. Max error 1.3e-17.
+static f64 const MinimaxAsinCoefficients[] =
+{
+    0.16666666666666669, 0.0749999999999824, 0.04464285714672413, 0.030381944110904967,
+    0.022372174011034807, 0.0173523683311686, 0.013971565634830981, 0.011475821750791362,
+    0.010344108753488691, 0.0053682732060719406, 0.017637967173126788, -0.015213699172211001,
+    0.0289993873519162,
+};
+
+// NOTE: 1/sqrt(m) on [1, 4], minimizing relative error. Max relative error 2.1e-3.
+static f64 const MinimaxRsqrtCoefficients[] =
+{
+    1.749015150678977, -1.1230732995170192, 0.4580523340934036, -0.0935424317015356,
+    0.0074305280858323886,
+};
+
+static u64 F64Bits(f64 Value)
+{
+    u64 Result;
+    memcpy(&Result, &Value, sizeof(Result));
+    return Result;
+}
+
+static f64 F64FromBits(u64 Bits)
+{
+    f64 Result;
+    memcpy(&Result, &Bits, sizeof(Result));
+    return Result;
+}
+
+static f64 EvaluatePolynomial(f64 const *Coefficients, u32 CoefficientCount, f64 X)
+{
+    f64 Result = Coefficients[CoefficientCount - 1];
+    for(u32 Index = CoefficientCount - 1; Index > 0; --Index)
+    {
+        Result = Result*X + Coefficients[Index - 1];
+    }
+    
+    return Result;
+}
+
+static f64 SinKernel(f64 R)
+{
+    // NOTE: R in [-pi/4, pi/4]
+    f64 R2 = R*R;
+    f64 Result = R + R*R2*EvaluatePolynomial(MinimaxSinCoefficients, ArrayCount(MinimaxSinCoefficients), R2);
+    return Result;
+}
+
+static f64 CosKernel(f64 R)
+{
+    // NOTE: R in [-pi/4, pi/4]
+    f64 R2 = R*R;
+    f64 Result = (1.0 - 0.5*R2) + R2*R2*EvaluatePolynomial(MinimaxCosCoefficients, ArrayCount(MinimaxCosCoefficients), R2);
+    return Result;
+}
+
+static f64 MinimaxSinQuadrant(f64 X, u32 QuadrantOffset)
+{
+    // NOTE: cos(x) is sin(x) one quadrant further on, so both go through here
+    f64 Result = F64FromBits(0x7FF8000000000000ull);
+    
+    f64 AbsX = (X < 0) ? -X : X;
+    if(AbsX <= MINIMAX_MAX_TRIG_INPUT)
+    {
+        f64 K = (X*MINIMAX_TWO_OVER_PI + MINIMAX_ROUNDING_MAGIC) - MINIMAX_ROUNDING_MAGIC;
+        f64 R = ((X - K*MINIMAX_PIO2_1) - K*MINIMAX_PIO2_2) - K*MINIMAX_PIO2_3;
+        
+        u32 Quadrant = ((u32)(s32)K + QuadrantOffset) & 3;
+        switch(Quadrant)
+        {
+            case 0: {Result = SinKernel(R);} break;
+            case 1: {Result = CosKernel(R);} break;
+            case 2: {Result = -SinKernel(R);} break;
+            case 3: {Result = -CosKernel(R);} break;
+        }
+    }
+    
+    return Result;
+}
+
+static f64 MinimaxSin(f64 X)
+{
+    f64 Result = MinimaxSinQuadrant(X, 0);
+    return Result;
+}
+
+static f64 MinimaxCos(f64 X)
+{
+    f64 Result = MinimaxSinQuadrant(X, 1);
+    return Result;
+}
+
+static void SplitF64(f64 A, f64 *High, f64 *Low)
+{
+    // NOTE: Veltkamp split into two halves of 26 bits or less each, so their products are exact
+    f64 Scaled = 134217729.0*A;
+    *High = Scaled - (Scaled - A);
+    *Low = A - *High;
+}
+
+static f64 MinimaxSqrt(f64 X)
+{
+    f64 Result = X;
+    
+    u64 Bits = F64Bits(X);
+    s32 Exponent = (s32)((Bits >> 52) & 0x7FF);
+    if(X < 0)
+    {
+        Result = F64FromBits(0x7FF8000000000000ull);
+    }
+    else if((X > 0) && (Exponent != 0x7FF))
+    {
+        if(Exponent == 0)
+        {
+            // NOTE: Denormal, so scale it up by 2^54 into the normal range first, and take it back off the exponent
+            Bits = F64Bits(X*18014398509481984.0);
+            Exponent = (s32)((Bits >> 52) & 0x7FF) - 54;
+        }
+        
+        // NOTE: X = M*2^(2*Half), with M in [1, 4)
+        s32 Unbiased = Exponent - 1023;
+        s32 Odd = Unbiased & 1;
+        s32 Half = (Unbiased - Odd) / 2;
+        f64 M = F64FromBits((Bits & 0x000FFFFFFFFFFFFFull) | ((u64)(1023 + Odd) << 52));
+        
+        f64 Y = EvaluatePolynomial(MinimaxRsqrtCoefficients, ArrayCount(MinimaxRsqrtCoefficients), M);
+        for(u32 Step = 0; Step < 3; ++Step)
+        {
+            Y = Y*(1.5 - 0.5*M*Y*Y);
+        }
+        
+        // NOTE: S*S exactly, as Product + Error, so M - S*S can be found without rounding
+        f64 S = M*Y;
+        f64 SHigh, SLow;
+        SplitF64(S, &SHigh, &SLow);
+        f64 Product = S*S;
+        f64 Error = ((SHigh*SHigh - Product) + 2.0*SHigh*SLow) + SLow*SLow;
+        f64 Residual = (M - Product) - Error;
+        S = S + Residual*(0.5*Y);
+        
+        Result = S*F64FromBits((u64)(1023 + Half) << 52);
+    }
+    
+    return Result;
+}
+
+static f64 AsinKernel(f64 X)
+{
+    // NOTE: X in [0, 0.5]
+    f64 X2 = X*X;
+    f64 Result = X + X*X2*EvaluatePolynomial(MinimaxAsinCoefficients, ArrayCount(MinimaxAsinCoefficients), X2);
+    return Result;
+}
+
+static f64 MinimaxAsin(f64 X)
+{
+    f64 AbsX = (X < 0) ? -X : X;
+    
+    f64 Result = 0;
+    if(AbsX <= 0.5)
+    {
+        Result = AsinKernel(AbsX);
+    }
+    else
+    {
+        // NOTE: 1 - AbsX is exact here. Past 1, the sqrt of a negative gives the NaN.
+        f64 S = MinimaxSqrt(0.5*(1.0 - AbsX));
+        f64 S2 = S*S;
+        f64 Tail = 2.0*S*S2*EvaluatePolynomial(MinimaxAsinCoefficients, ArrayCount(MinimaxAsinCoefficients), S2);
+        Result = (MINIMAX_HALF_PI_HIGH - 2.0*S) - (Tail - MINIMAX_HALF_PI_LOW);
+    }
+    
+    if(X < 0)
+    {
+        Result = -Result;
+    }
+    
+    return Result;
+}
+
+static f64 MinimaxHaversine(f64 X0, f64 Y0, f64 X1, f64 Y1, f64 EarthRadius)
+{
+    // NOTE: Exactly the steps of ReferenceHaversine, with these functions in place of the CRT's
+    f64 lat1 = Y0;
+    f64 lat2 = Y1;
+    f64 lon1 = X0;
+    f64 lon2 = X1;
+    
+    f64 dLat = RadiansFromDegrees(lat2 - lat1);
+    f64 dLon = RadiansFromDegrees(lon2 - lon1);
+    lat1 = RadiansFromDegrees(lat1);
+    lat2 = RadiansFromDegrees(lat2);
+    
+    f64 a = Square(MinimaxSin(dLat/2.0)) + MinimaxCos(lat1)*MinimaxCos(lat2)*Square(MinimaxSin(dLon/2));
+    f64 c = 2.0*MinimaxAsin(MinimaxSqrt(a));
+    
+    f64 Result = EarthRadius * c;
+    
+    return Result;
+}
@@ -0,0 +1,317 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 151
+   ======================================================================== */
+
+/* NOTE: Sweeps each function from listing 150 across the inputs haversine actually gives it
+   and compares every result with the CRT's:
+       
+       sin  - [-pi, pi]      (half the longitude difference can reach pi)
+       cos  - [-pi/2, pi/2]  (latitudes)
+       asin - [0, 1]         (sqrt of the haversine term)
+       sqrt - [0, 1]
+   
+   It reports the largest difference in ulps and in absolute terms, with the input where it
+   happened, how many results were bit-identical, and calls per second for both. Both are
+   called through a function pointer for the timing, so neither gets inlined.
+   
+   Then MinimaxHaversine is run against ReferenceHaversine on random uniform pairs, which is
+   the error that switching the haversine over would actually cost. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0074_platform_metrics.cpp"
+#include "listing_0150_minimax_math.cpp"
+
+typedef f64 math_func(f64 X);
+
+// NOTE: The CRT versions are wrapped, because in C++ sin and friends are overloaded and have no single address
+static f64 CRTSin(f64 X) {return sin(X);}
+static f64 CRTCos(f64 X) {return cos(X);}
+static f64 CRTAsin(f64 X) {return asin(X);}
+static f64 CRTSqrt(f64 X) {return sqrt(X);}
+
+struct math_function_test
+{
+    char const *Name;
+    math_func *Reference;
+    math_func *Minimax;
+    f64 Min;
+    f64 Max;
+};
+
+struct sweep_result
+{
+    u64 SampleCount;
+    u64 IdenticalCount;
+    
+    u64 MaxULPs;
+    f64 MaxULPsInput;
+    
+    f64 MaxError;
+    f64 MaxErrorInput;
+};
+
+static u64 ULPDistance(f64 A, f64 B)
+{
+    // NOTE: Maps the f64 bit patterns onto a line where adjacent values differ by 1
+    s64 SignedA = (s64)F64Bits(A);
+    s64 SignedB = (s64)F64Bits(B);
+    if(SignedA < 0) SignedA = (s64)0x8000000000000000ull - SignedA;
+    if(SignedB < 0) SignedB = (s64)0x8000000000000000ull - SignedB;
+    
+    u64 Result = (SignedA > SignedB) ? (u64)(SignedA - SignedB) : (u64)(SignedB - SignedA);
+    return Result;
+}
+
+static sweep_result SweepFunction(math_function_test Test, u64 SampleCount, f64 *Inputs)
+{
+    sweep_result Result = {};
+    Result.SampleCount = SampleCount;
+    
+    for(u64 SampleIndex = 0; SampleIndex < SampleCount; ++SampleIndex)
+    {
+        // NOTE: Both ends of the range are always included
+        f64 X = Test.Min + (Test.Max - Test.Min)*((f64)SampleIndex / (f64)(SampleCount - 1));
+        Inputs[SampleIndex] = X;
+        
+        f64 Expected = Test.Reference(X);
+        f64 Actual = Test.Minimax(X);
+        
+        u64 ULPs = ULPDistance(Actual, Expected);
+        if(ULPs == 0)
+        {
+            ++Result.IdenticalCount;
+        }
+        
+        if(Result.MaxULPs < ULPs)
+        {
+            Result.MaxULPs = ULPs;
+            Result.MaxULPsInput = X;
+        }
+        
+        f64 Error = fabs(Actual - Expected);
+        if(Result.MaxError < Error)
+        {
+            Result.MaxError = Error;
+            Result.MaxErrorInput = X;
+        }
+    }
+    
+    return Result;
+}
+
+static f64 TimeCallsPerSecond(math_func *Func, u64 SampleCount, f64 *Inputs, u64 CPUFreq)
+{
+    u32 const RepetitionCount = 5;
+    
+    // NOTE: The results are summed into a volatile so the calls can't be thrown away
+    volatile f64 Sink = 0;
+    u64 BestTime = (u64)-1;
+    for(u32 Repetition = 0; Repetition < RepetitionCount; ++Repetition)
+    {
+        f64 Sum = 0;
+        u64 StartTime = ReadCPUTimer();
+        for(u64 SampleIndex = 0; SampleIndex < SampleCount; ++SampleIndex)
+        {
+            Sum += Func(Inputs[SampleIndex]);
+        }
+        u64 Elapsed = ReadCPUTimer() - StartTime;
+        Sink = Sink + Sum;
+        
+        if(BestTime > Elapsed)
+        {
+            BestTime = Elapsed;
+        }
+    }
+    
+    f64 Result = (f64)SampleCount / ((f64)BestTime / (f64)CPUFreq);
+    return Result;
+}
+
+static u64 RandomU64(u64 *State)
+{
+    // NOTE: SplitMix64
+    u64 Result = (*State += 0x9E3779B97F4A7C15ull);
+    Result = (Result ^ (Result >> 30))*0xBF58476D1CE4E5B9ull;
+    Result = (Result ^ (Result >> 27))*0x94D049BB133111EBull;
+    Result ^= (Result >> 31);
+    return Result;
+}
+
+static f64 RandomInRange(u64 *State, f64 Min, f64 Max)
+{
+    f64 T = (f64)(RandomU64(State) >> 11) * (1.0 / 9007199254740992.0);
+    f64 Result = Min + (Max - Min)*T;
+    return Result;
+}
+
+static void CompareHaversine(u64 PairCount, u64 CPUFreq)
+{
+    // NOTE: 4 coordinates per pair, laid out like haversine_pair
+    f64 *Coordinates = (f64 *)malloc(PairCount*4*sizeof(f64));
+    if(Coordinates)
+    {
+        u64 Seed = 1234567;
+        for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+        {
+            f64 *Pair = Coordinates + 4*PairIndex;
+            Pair[0] = RandomInRange(&Seed, -180, 180);
+            Pair[1] = RandomInRange(&Seed, -90, 90);
+            Pair[2] = RandomInRange(&Seed, -180, 180);
+            Pair[3] = RandomInRange(&Seed, -90, 90);
+        }
+        
+        // NOTE: Each one gets its own timed loop, so neither pays for the other's timer reads
+        u64 StartTime = ReadCPUTimer();
+        f64 ReferenceSum = 0;
+        for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+        {
+            f64 *Pair = Coordinates + 4*PairIndex;
+            ReferenceSum += ReferenceHaversine(Pair[0], Pair[1], Pair[2], Pair[3], 6372.8);
+        }
+        u64 ReferenceTime = ReadCPUTimer() - StartTime;
+        
+        StartTime = ReadCPUTimer();
+        f64 MinimaxSum = 0;
+        for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+        {
+            f64 *Pair = Coordinates + 4*PairIndex;
+            MinimaxSum += MinimaxHaversine(Pair[0], Pair[1], Pair[2], Pair[3], 6372.8);
+        }
+        u64 MinimaxTime = ReadCPUTimer() - StartTime;
+        
+        f64 MaxError = 0;
+        u64 MaxULPs = 0;
+        u64 IdenticalCount = 0;
+        for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+        {
+            f64 *Pair = Coordinates + 4*PairIndex;
+            f64 Expected = ReferenceHaversine(Pair[0], Pair[1], Pair[2], Pair[3], 6372.8);
+            f64 Actual = MinimaxHaversine(Pair[0], Pair[1], Pair[2], Pair[3], 6372.8);
+            
+            u64 ULPs = ULPDistance(Actual, Expected);
+            IdenticalCount += (ULPs == 0);
+            if(MaxULPs < ULPs)
+            {
+                MaxULPs = ULPs;
+            }
+            
+            f64 Error = fabs(Actual - Expected);
+            if(MaxError < Error)
+            {
+                MaxError = Error;
+            }
+        }
+        
+        printf("\nhaversine (%llu random pairs):\n", PairCount);
+        printf("  Max error: %llu ulps, %.3e km\n", MaxULPs, MaxError);
+        printf("  Identical: %llu (%.2f%%)\n", IdenticalCount, 100.0*(f64)IdenticalCount / (f64)PairCount);
+        printf("  Mean distance: %.16f (reference %.16f, difference %.3e)\n",
+               MinimaxSum / (f64)PairCount, ReferenceSum / (f64)PairCount, (MinimaxSum - ReferenceSum) / (f64)PairCount);
+        printf("  Pairs/s: %.2fm (reference %.2fm)\n",
+               (f64)PairCount / ((f64)MinimaxTime / (f64)CPUFreq) / 1000000.0,
+               (f64)PairCount / ((f64)ReferenceTime / (f64)CPUFreq) / 1000000.0);
+        
+        free(Coordinates);
+    }
+}
+
+int main(int ArgCount, char **Args)
+{
+    int Result = 1;
+    
+    u64 SampleCount = 1ull << 22;
+    b32 ValidArgs = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        if((strcmp(Args[ArgIndex], "-samples") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            SampleCount = strtoull(Args[++ArgIndex], 0, 10);
+            ValidArgs = ValidArgs && (SampleCount >= 2);
+        }
+        else
+        {
+            ValidArgs = false;
+        }
+    }
+    
+    f64 *Inputs = ValidArgs ? (f64 *)malloc(SampleCount*sizeof(f64)) : 0;
+    if(Inputs)
+    {
+        math_function_test Tests[] =
+        {
+            {"sin", CRTSin, MinimaxSin, -3.14159265358979323846, 3.14159265358979323846},
+            {"cos", CRTCos, MinimaxCos, -1.57079632679489661923, 1.57079632679489661923},
+            {"asin", CRTAsin, MinimaxAsin, 0, 1},
+            {"sqrt", CRTSqrt, MinimaxSqrt, 0, 1},
+        };
+        
+        u64 CPUFreq = EstimateCPUTimerFreq();
+        
+        for(u32 TestIndex = 0; TestIndex < ArrayCount(Tests); ++TestIndex)
+        {
+            math_function_test Test = Tests[TestIndex];
+            sweep_result Sweep = SweepFunction(Test, SampleCount, Inputs);
+            f64 MinimaxRate = TimeCallsPerSecond(Test.Minimax, SampleCount, Inputs, CPUFreq);
+            f64 ReferenceRate = TimeCallsPerSecond(Test.Reference, SampleCount, Inputs, CPUFreq);
+            
+            printf("%s [%.17g, %.17g], %llu samples:\n", Test.Name, Test.Min, Test.Max, Sweep.SampleCount);
+            printf("  Max error: %llu ulps at %.17g\n", Sweep.MaxULPs, Sweep.MaxULPsInput);
+            printf("             %.3e at %.17g\n", Sweep.MaxError, Sweep.MaxErrorInput);
+            printf("  Identical: %llu (%.2f%%)\n", Sweep.IdenticalCount, 100.0*(f64)Sweep.IdenticalCount / (f64)Sweep.SampleCount);
+            printf("  Calls/s: %.2fm (CRT %.2fm)\n", MinimaxRate / 1000000.0, ReferenceRate / 1000000.0);
+        }
+        
+        CompareHaversine(SampleCount / 4, CPUFreq);
+        
+        free(Inputs);
+        Result = 0;
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [-samples count]\n", Args[0]);
+    }
+    
+    return Result;
+}
@@ -0,0 +1,800 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 152
+   ======================================================================== */
+
+/* NOTE: Same output format as the generator in listing 66, but generated on several threads
+   and without printf. The pairs are cut into fixed chunks of GENERATOR_CHUNK_PAIR_COUNT, and
+   each chunk gets its own random series, seeded from the seed on the command line and the
+   chunk index. Clusters are likewise a fixed number of pairs, with their centers and radii
+   seeded from the cluster index. So nothing depends on which thread generates what, and the
+   files come out byte-identical for any thread count. (They are not the same files listing
+   66 makes for the same seed, since that one uses a single series for everything.)
+   
+   Each thread formats its chunk into memory. Numbers are printed with a fixed-point formatter
+   that gives exactly what %.16f does: |x|*10^16 is computed exactly in 128 bits from the
+   mantissa and rounded half-to-even, which is also what the CRT does. The JSON for a chunk
+   can't be placed until every earlier chunk's length is known, so the threads generate one
+   chunk each, the offsets are added up in chunk order, and then each thread writes its chunk
+   straight to its final offset with pwrite (WriteFile with an OVERLAPPED on Windows).
+   
+   The expected sum is each chunk's sum, added in chunk order, so it is also the same for any
+   thread count. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+typedef int32_t b32;
+typedef double f64;
+#define U64Max UINT64_MAX
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0074_platform_metrics.cpp"
+
+#if _WIN32
+
+typedef HANDLE os_thread;
+
+struct os_thread_start
+{
+    void (*Func)(void *Param);
+    void *Param;
+};
+
+static DWORD WINAPI OSThreadEntry(LPVOID Param)
+{
+    os_thread_start *Start = (os_thread_start *)Param;
+    Start->Func(Start->Param);
+    return 0;
+}
+
+static os_thread StartOSThread(os_thread_start *Start)
+{
+    os_thread Result = CreateThread(0, 0, OSThreadEntry, Start, 0, 0);
+    return Result;
+}
+
+static void JoinOSThread(os_thread Thread)
+{
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+}
+
+static u32 GetLogicalCoreCount(void)
+{
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    u32 Result = Info.dwNumberOfProcessors;
+    return Result;
+}
+
+typedef HANDLE os_file;
+#define INVALID_OS_FILE INVALID_HANDLE_VALUE
+
+static os_file OpenOSFileForWriting(char *FileName)
+{
+    os_file Result = CreateFileA(FileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    return Result;
+}
+
+static b32 WriteOSFileAt(os_file File, void *Source, u64 Count, u64 Offset)
+{
+    // NOTE: The Windows equivalent of pwrite is a synchronous WriteFile with the offset in an OVERLAPPED
+    u64 Written = 0;
+    while(Written < Count)
+    {
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset = (DWORD)(Offset + Written);
+        Overlapped.OffsetHigh = (DWORD)((Offset + Written) >> 32);
+        
+        u64 WriteSize = Count - Written;
+        if(WriteSize > 0x40000000)
+        {
+            WriteSize = 0x40000000;
+        }
+        
+        DWORD BytesWritten = 0;
+        if(!WriteFile(File, (u8 *)Source + Written, (DWORD)WriteSize, &BytesWritten, &Overlapped) || !BytesWritten)
+        {
+            break;
+        }
+        Written += BytesWritten;
+    }
+    
+    b32 Result = (Written == Count);
+    return Result;
+}
+
+static void CloseOSFile(os_file File)
+{
+    CloseHandle(File);
+}
+
+#else
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef pthread_t os_thread;
+
+struct os_thread_start
+{
+    void (*Func)(void *Param);
+    void *Param;
+};
+
+static void *OSThreadEntry(void *Param)
+{
+    os_thread_start *Start = (os_thread_start *)Param;
+    Start->Func(Start->Param);
+    return 0;
+}
+
+static os_thread StartOSThread(os_thread_start *Start)
+{
+    os_thread Result = {};
+    pthread_create(&Result, 0, OSThreadEntry, Start);
+    return Result;
+}
+
+static void JoinOSThread(os_thread Thread)
+{
+    pthread_join(Thread, 0);
+}
+
+static u32 GetLogicalCoreCount(void)
+{
+    long Count = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 Result = (Count > 0) ? (u32)Count : 1;
+    return Result;
+}
+
+typedef int os_file;
+#define INVALID_OS_FILE -1
+
+static os_file OpenOSFileForWriting(char *FileName)
+{
+    os_file Result = open(FileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    return Result;
+}
+
+static b32 WriteOSFileAt(os_file File, void *Source, u64 Count, u64 Offset)
+{
+    u64 Written = 0;
+    while(Written < Count)
+    {
+        ssize_t BytesWritten = pwrite(File, (u8 *)Source + Written, Count - Written, Offset + Written);
+        if(BytesWritten <= 0)
+        {
+            break;
+        }
+        Written += BytesWritten;
+    }
+    
+    b32 Result = (Written == Count);
+    return Result;
+}
+
+static void CloseOSFile(os_file File)
+{
+    close(File);
+}
+
+#endif
+
+struct random_series
+{
+    u64 A, B, C, D;
+};
+
+static u64 RotateLeft(u64 V, int Shift)
+{
+    u64 Result = ((V << Shift) | (V >> (64-Shift)));
+    return Result;
+}
+
+static u64 RandomU64(random_series *Series)
+{
+    u64 A = Series->A;
+    u64 B = Series->B;
+    u64 C = Series->C;
+    u64 D = Series->D;
+    
+    u64 E = A - RotateLeft(B, 27);
+    
+    A = (B ^ RotateLeft(C, 17));
+    B = (C + D);
+    C = (D + E);
+    D = (E + A);
+    
+    Series->A = A;
+    Series->B = B;
+    Series->C = C;
+    Series->D = D;
+    
+    return D;
+}
+
+static random_series Seed(u64 Value)
+{
+    random_series Series = {};
+    
+    // NOTE(casey): This is the seed pattern for JSF generators, as per the original post
+    Series.A = 0xf1ea5eed;
+    Series.B = Value;
+    Series.C = Value;
+    Series.D = Value;
+    
+    u32 Count = 20;
+    while(Count--)
+    {
+        RandomU64(&Series);
+    }
+    
+    return Series;
+}
+
+static u64 DeriveSeed(u64 SeedValue, u64 Stream, u64 Index)
+{
+    // NOTE: SplitMix64's finalizer, so neighboring indices get unrelated seeds
+    u64 Result = SeedValue ^ (Stream*0xD1B54A32D192ED03ull) ^ ((Index + 1)*0x9E3779B97F4A7C15ull);
+    Result = (Result ^ (Result >> 30))*0xBF58476D1CE4E5B9ull;
+    Result = (Result ^ (Result >> 27))*0x94D049BB133111EBull;
+    Result ^= (Result >> 31);
+    return Result;
+}
+
+static f64 RandomInRange(random_series *Series, f64 Min, f64 Max)
+{
+    f64 t = (f64)RandomU64(Series) / (f64)U64Max;
+    f64 Result = (1.0 - t)*Min + t*Max;
+    
+    return Result;
+}
+
+static f64 RandomDegree(random_series *Series, f64 Center, f64 Radius, f64 MaxAllowed)
+{
+    f64 MinVal = Center - Radius;
+    if(MinVal < -MaxAllowed)
+    {
+        MinVal = -MaxAllowed;
+    }
+    
+    f64 MaxVal = Center + Radius;
+    if(MaxVal > MaxAllowed)
+    {
+        MaxVal = MaxAllowed;
+    }
+    
+    f64 Result = RandomInRange(Series, MinVal, MaxVal);
+    return Result;
+}
+
+//
+// NOTE: Fixed-point formatting
+//
+
+#define FIXED16_SCALE 10000000000000000ull // NOTE: 10^16
+
+struct u128
+{
+    u64 Low;
+    u64 High;
+};
+
+static u128 Multiply64To128(u64 A, u64 B)
+{
+    u128 Result;
+#if _MSC_VER
+    Result.Low = _umul128(A, B, &Result.High);
+#else
+    unsigned __int128 Product = (unsigned __int128)A * B;
+    Result.Low = (u64)Product;
+    Result.High = (u64)(Product >> 64);
+#endif
+    return Result;
+}
+
+static u64 ShiftRightRoundHalfEven(u128 Value, u32 Shift)
+{
+    // NOTE: Value >> Shift, rounded half-to-even, for Shift of 1 or more. Only called when the result fits in 64 bits.
+    u64 Result = 0;
+    if(Shift < 128)
+    {
+        u64 Quotient = (Shift < 64) ? ((Value.Low >> Shift) | (Value.High << (64 - Shift))) : (Value.High >> (Shift - 64));
+        
+        // NOTE: Half is bit Shift - 1, and the rest is everything below it
+        u32 HalfBit = Shift - 1;
+        b32 HalfSet = false;
+        b32 RestSet = false;
+        if(HalfBit < 64)
+        {
+            HalfSet = (Value.Low >> HalfBit) & 1;
+            RestSet = (Value.Low & ((1ull << HalfBit) - 1)) != 0;
+        }
+        else
+        {
+            HalfSet = (Value.High >> (HalfBit - 64)) & 1;
+            RestSet = (Value.Low != 0) || ((Value.High & ((1ull << (HalfBit - 64)) - 1)) != 0);
+        }
+        
+        if(HalfSet && (RestSet || (Quotient & 1)))
+        {
+            ++Quotient;
+        }
+        
+        Result = Quotient;
+    }
+    
+    return Result;
+}
+
+static u32 FormatFixed16(char *Dest, f64 Value)
+{
+    // NOTE: Writes exactly what printf's %.16f would, for any |Value| < 1844. Returns the length.
+    u64 Bits;
+    memcpy(&Bits, &Value, sizeof(Bits));
+    
+    u64 Mantissa = Bits & 0x000FFFFFFFFFFFFFull;
+    s32 BiasedExponent = (s32)((Bits >> 52) & 0x7FF);
+    if(BiasedExponent)
+    {
+        Mantissa |= (1ull << 52);
+    }
+    else
+    {
+        BiasedExponent = 1;
+    }
+    
+    // NOTE: |Value| = Mantissa*2^Exponent, so |Value|*10^16 = Mantissa*10^16*2^Exponent. Exponent is
+    // always negative for the values this takes, since they are far below 2^52.
+    s32 Exponent = BiasedExponent - 1075;
+    u128 Product = Multiply64To128(Mantissa, FIXED16_SCALE);
+    u64 Scaled = ShiftRightRoundHalfEven(Product, (u32)-Exponent);
+    
+    char *At = Dest;
+    if(Bits >> 63)
+    {
+        *At++ = '-';
+    }
+    
+    u64 Integer = Scaled / FIXED16_SCALE;
+    u64 Fraction = Scaled % FIXED16_SCALE;
+    
+    char IntegerDigits[20];
+    u32 IntegerDigitCount = 0;
+    do
+    {
+        IntegerDigits[IntegerDigitCount++] = (char)('0' + (Integer % 10));
+        Integer /= 10;
+    } while(Integer);
+    
+    while(IntegerDigitCount)
+    {
+        *At++ = IntegerDigits[--IntegerDigitCount];
+    }
+    
+    *At++ = '.';
+    for(u32 Digit = 16; Digit > 0; --Digit)
+    {
+        At[Digit - 1] = (char)('0' + (Fraction % 10));
+        Fraction /= 10;
+    }
+    At += 16;
+    
+    u32 Result = (u32)(At - Dest);
+    return Result;
+}
+
+static char *AppendString(char *At, char const *String, u32 Count)
+{
+    memcpy(At, String, Count);
+    char *Result = At + Count;
+    return Result;
+}
+
+static char *AppendField(char *At, char const *Label, u32 LabelCount, f64 Value)
+{
+    At = AppendString(At, Label, LabelCount);
+    At += FormatFixed16(At, Value);
+    return At;
+}
+
+/* NOTE: The binary pair file header, same as listing 66 */
+
+#define HAVERSINE_PAIR_FILE_MAGIC 0x52505648 // NOTE: "HVPR" in little-endian
+#define HAVERSINE_PAIR_FILE_VERSION 1
+#define HAVERSINE_PAIR_LAYOUT_F64_COLUMNS 1
+#define HAVERSINE_PAIR_COLUMN_ALIGNMENT 64
+
+struct haversine_pair_file_header
+{
+    u32 Magic;
+    u32 Version;
+    u64 PairCount;
+    u32 Layout;
+    u32 ColumnCount;
+    u64 ColumnOffset[4]; // NOTE: Byte offsets from the start of the file, X0/Y0/X1/Y1
+    u64 Reserved;
+};
+
+static u64 AlignColumn(u64 Offset)
+{
+    u64 Result = (Offset + HAVERSINE_PAIR_COLUMN_ALIGNMENT - 1) & ~(u64)(HAVERSINE_PAIR_COLUMN_ALIGNMENT - 1);
+    return Result;
+}
+
+//
+// NOTE: Chunks
+//
+
+#define GENERATOR_CHUNK_PAIR_COUNT 65536
+#define MAX_JSON_PAIR_SIZE 128 // NOTE: 4 labels and separators (33 bytes) plus 4 numbers of at most 22 characters
+#define MAX_GENERATOR_THREAD_COUNT 64
+
+#define SEED_STREAM_PAIRS 1
+#define SEED_STREAM_CLUSTERS 2
+
+struct generator_settings
+{
+    u64 SeedValue;
+    u64 PairCount;
+    u64 ClusterPairCount; // NOTE: 0 for uniform
+    b32 WriteBinary;
+    
+    os_file FlexJSON;
+    os_file HaverAnswers;
+    os_file PairColumns;
+    haversine_pair_file_header ColumnHeader;
+};
+
+struct generator_chunk
+{
+    generator_settings *Settings;
+    u64 FirstPair;
+    u64 PairCount;
+    
+    // NOTE: Filled in by GenerateChunk, except JSONOffset, which is only known once every earlier chunk is done
+    char *JSON;
+    u64 JSONSize;
+    u64 JSONOffset;
+    f64 *Answers;
+    f64 *Columns[4];
+    f64 Sum;
+    b32 WriteFailed;
+    
+    os_thread_start ThreadStart;
+};
+
+static void GenerateChunk(void *Param)
+{
+    generator_chunk *Chunk = (generator_chunk *)Param;
+    generator_settings *Settings = Chunk->Settings;
+    
+    f64 MaxAllowedX = 180;
+    f64 MaxAllowedY = 90;
+    
+    f64 XCenter = 0;
+    f64 YCenter = 0;
+    f64 XRadius = MaxAllowedX;
+    f64 YRadius = MaxAllowedY;
+    
+    random_series Series = Seed(DeriveSeed(Settings->SeedValue, SEED_STREAM_PAIRS, Chunk->FirstPair / GENERATOR_CHUNK_PAIR_COUNT));
+    u64 ClusterIndex = U64Max;
+    
+    f64 Sum = 0;
+    f64 SumCoef = 1.0 / (f64)Settings->PairCount;
+    
+    char *At = Chunk->JSON;
+    for(u64 ChunkPairIndex = 0; ChunkPairIndex < Chunk->PairCount; ++ChunkPairIndex)
+    {
+        u64 PairIndex = Chunk->FirstPair + ChunkPairIndex;
+        if(Settings->ClusterPairCount && (ClusterIndex != (PairIndex / Settings->ClusterPairCount)))
+        {
+            ClusterIndex = PairIndex / Settings->ClusterPairCount;
+            random_series ClusterSeries = Seed(DeriveSeed(Settings->SeedValue, SEED_STREAM_CLUSTERS, ClusterIndex));
+            XCenter = RandomInRange(&ClusterSeries, -MaxAllowedX, MaxAllowedX);
+            YCenter = RandomInRange(&ClusterSeries, -MaxAllowedY, MaxAllowedY);
+            XRadius = RandomInRange(&ClusterSeries, 0, MaxAllowedX);
+            YRadius = RandomInRange(&ClusterSeries, 0, MaxAllowedY);
+        }
+        
+        f64 X0 = RandomDegree(&Series, XCenter, XRadius, MaxAllowedX);
+        f64 Y0 = RandomDegree(&Series, YCenter, YRadius, MaxAllowedY);
+        f64 X1 = RandomDegree(&Series, XCenter, XRadius, MaxAllowedX);
+        f64 Y1 = RandomDegree(&Series, YCenter, YRadius, MaxAllowedY);
+        
+        f64 EarthRadius = 6372.8;
+        f64 HaversineDistance = ReferenceHaversine(X0, Y0, X1, Y1, EarthRadius);
+        
+        Sum += SumCoef*HaversineDistance;
+        Chunk->Answers[ChunkPairIndex] = HaversineDistance;
+        
+        At = AppendField(At, "    {\"x0\":", 10, X0);
+        At = AppendField(At, ", \"y0\":", 7, Y0);
+        At = AppendField(At, ", \"x1\":", 7, X1);
+        At = AppendField(At, ", \"y1\":", 7, Y1);
+        At = (PairIndex == (Settings->PairCount - 1)) ? AppendString(At, "}\n", 2) : AppendString(At, "},\n", 3);
+        
+        if(Settings->WriteBinary)
+        {
+            Chunk->Columns[0][ChunkPairIndex] = X0;
+            Chunk->Columns[1][ChunkPairIndex] = Y0;
+            Chunk->Columns[2][ChunkPairIndex] = X1;
+            Chunk->Columns[3][ChunkPairIndex] = Y1;
+        }
+    }
+    
+    Chunk->JSONSize = (u64)(At - Chunk->JSON);
+    Chunk->Sum = Sum;
+}
+
+static void WriteChunk(void *Param)
+{
+    generator_chunk *Chunk = (generator_chunk *)Param;
+    generator_settings *Settings = Chunk->Settings;
+    
+    b32 Written = WriteOSFileAt(Settings->FlexJSON, Chunk->JSON, Chunk->JSONSize, Chunk->JSONOffset);
+    Written = Written && WriteOSFileAt(Settings->HaverAnswers, Chunk->Answers, Chunk->PairCount*sizeof(f64),
+                                       Chunk->FirstPair*sizeof(f64));
+    
+    if(Settings->WriteBinary)
+    {
+        for(u32 Column = 0; Column < 4; ++Column)
+        {
+            Written = Written && WriteOSFileAt(Settings->PairColumns, Chunk->Columns[Column], Chunk->PairCount*sizeof(f64),
+                                               Settings->ColumnHeader.ColumnOffset[Column] + Chunk->FirstPair*sizeof(f64));
+        }
+    }
+    
+    Chunk->WriteFailed = !Written;
+}
+
+static void RunOnThreads(generator_chunk *Chunks, u32 ChunkCount, void (*Func)(void *Param))
+{
+    // NOTE: Chunk 0 runs on this thread
+    os_thread Threads[MAX_GENERATOR_THREAD_COUNT] = {};
+    for(u32 ChunkIndex = 1; ChunkIndex < ChunkCount; ++ChunkIndex)
+    {
+        generator_chunk *Chunk = Chunks + ChunkIndex;
+        Chunk->ThreadStart.Func = Func;
+        Chunk->ThreadStart.Param = Chunk;
+        Threads[ChunkIndex] = StartOSThread(&Chunk->ThreadStart);
+    }
+    
+    Func(Chunks + 0);
+    
+    for(u32 ChunkIndex = 1; ChunkIndex < ChunkCount; ++ChunkIndex)
+    {
+        JoinOSThread(Threads[ChunkIndex]);
+    }
+}
+
+static os_file Open(long long unsigned PairCount, char const *Label, char const *Extension)
+{
+    char Temp[256];
+    sprintf(Temp, "data_%llu_%s.%s", PairCount, Label, Extension);
+    os_file Result = OpenOSFileForWriting(Temp);
+    if(Result == INVALID_OS_FILE)
+    {
+        fprintf(stderr, "Unable to open \"%s\" for writing.\n", Temp);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&EstimateCPUTimerFreq;
+    
+    // NOTE: -threads can go anywhere on the command line
+    u32 ThreadCount = GetLogicalCoreCount();
+    char *Positional[4] = {};
+    u32 PositionalCount = 0;
+    b32 ValidArgs = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        if((strcmp(Args[ArgIndex], "-threads") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            ThreadCount = (u32)strtoul(Args[++ArgIndex], 0, 10);
+            ValidArgs = ValidArgs && (ThreadCount >= 1) && (ThreadCount <= MAX_GENERATOR_THREAD_COUNT);
+        }
+        else if(PositionalCount < ArrayCount(Positional))
+        {
+            Positional[PositionalCount++] = Args[ArgIndex];
+        }
+        else
+        {
+            ValidArgs = false;
+        }
+    }
+    
+    if(ThreadCount > MAX_GENERATOR_THREAD_COUNT)
+    {
+        ThreadCount = MAX_GENERATOR_THREAD_COUNT;
+    }
+    
+    b32 WriteBinary = ((PositionalCount == 4) && (strcmp(Positional[3], "binary") == 0));
+    if(ValidArgs && ((PositionalCount == 3) || WriteBinary))
+    {
+        generator_settings Settings = {};
+        Settings.WriteBinary = WriteBinary;
+        
+        char const *MethodName = Positional[0];
+        b32 Cluster = (strcmp(MethodName, "cluster") == 0);
+        if(!Cluster && (strcmp(MethodName, "uniform") != 0))
+        {
+            MethodName = "uniform";
+            fprintf(stderr, "WARNING: Unrecognized method name. Using 'uniform'.\n");
+        }
+        
+        Settings.SeedValue = atoll(Positional[1]);
+        
+        u64 MaxPairCount = (1ULL << 34);
+        u64 PairCount = atoll(Positional[2]);
+        if(PairCount && (PairCount < MaxPairCount))
+        {
+            u64 StartTime = ReadOSTimer();
+            
+            Settings.PairCount = PairCount;
+            Settings.ClusterPairCount = Cluster ? (2 + (PairCount / 64)) : 0;
+            
+            Settings.FlexJSON = Open(PairCount, "flex", "json");
+            Settings.HaverAnswers = Open(PairCount, "haveranswer", "f64");
+            Settings.PairColumns = WriteBinary ? Open(PairCount, "flex", "hvpairs") : INVALID_OS_FILE;
+            
+            // NOTE: One chunk's worth of buffers per thread, reused for every chunk that thread gets
+            u64 PerThreadSize = GENERATOR_CHUNK_PAIR_COUNT*(MAX_JSON_PAIR_SIZE + 5*sizeof(f64));
+            u8 *Memory = (u8 *)malloc(ThreadCount*PerThreadSize);
+            
+            generator_chunk Chunks[MAX_GENERATOR_THREAD_COUNT] = {};
+            for(u32 ThreadIndex = 0; Memory && (ThreadIndex < ThreadCount); ++ThreadIndex)
+            {
+                generator_chunk *Chunk = Chunks + ThreadIndex;
+                u8 *ThreadMemory = Memory + ThreadIndex*PerThreadSize;
+                
+                Chunk->Settings = &Settings;
+                Chunk->Answers = (f64 *)ThreadMemory;
+                for(u32 Column = 0; Column < 4; ++Column)
+                {
+                    Chunk->Columns[Column] = Chunk->Answers + (Column + 1)*GENERATOR_CHUNK_PAIR_COUNT;
+                }
+                Chunk->JSON = (char *)(Chunk->Answers + 5*GENERATOR_CHUNK_PAIR_COUNT);
+            }
+            
+            b32 Written = true;
+            if(Memory && (Settings.FlexJSON != INVALID_OS_FILE) && (Settings.HaverAnswers != INVALID_OS_FILE) &&
+               (!WriteBinary || (Settings.PairColumns != INVALID_OS_FILE)))
+            {
+                if(WriteBinary)
+                {
+                    haversine_pair_file_header *Header = &Settings.ColumnHeader;
+                    Header->Magic = HAVERSINE_PAIR_FILE_MAGIC;
+                    Header->Version = HAVERSINE_PAIR_FILE_VERSION;
+                    Header->PairCount = PairCount;
+                    Header->Layout = HAVERSINE_PAIR_LAYOUT_F64_COLUMNS;
+                    Header->ColumnCount = 4;
+                    
+                    u64 Offset = AlignColumn(sizeof(haversine_pair_file_header));
+                    for(u32 Column = 0; Column < 4; ++Column)
+                    {
+                        Header->ColumnOffset[Column] = Offset;
+                        Offset = AlignColumn(Offset + PairCount*sizeof(f64));
+                    }
+                    
+                    // NOTE: A zero at the very end sizes the file up front, including the padding after the last column.
+                    // It goes in first, because it can land on the last value of the last column, which overwrites it later.
+                    u8 Zero = 0;
+                    Written = Written && WriteOSFileAt(Settings.PairColumns, &Zero, 1, Offset - 1);
+                    Written = Written && WriteOSFileAt(Settings.PairColumns, Header, sizeof(*Header), 0);
+                }
+                
+                char const JSONHeader[] = "{\"pairs\":[\n";
+                u64 JSONOffset = sizeof(JSONHeader) - 1;
+                Written = Written && WriteOSFileAt(Settings.FlexJSON, (void *)JSONHeader, JSONOffset, 0);
+                
+                f64 Sum = 0;
+                for(u64 FirstPair = 0; Written && (FirstPair < PairCount); )
+                {
+                    u32 ChunkCount = 0;
+                    while((ChunkCount < ThreadCount) && (FirstPair < PairCount))
+                    {
+                        generator_chunk *Chunk = Chunks + ChunkCount++;
+                        Chunk->FirstPair = FirstPair;
+                        Chunk->PairCount = PairCount - FirstPair;
+                        if(Chunk->PairCount > GENERATOR_CHUNK_PAIR_COUNT)
+                        {
+                            Chunk->PairCount = GENERATOR_CHUNK_PAIR_COUNT;
+                        }
+                        FirstPair += Chunk->PairCount;
+                    }
+                    
+                    RunOnThreads(Chunks, ChunkCount, GenerateChunk);
+                    
+                    for(u32 ChunkIndex = 0; ChunkIndex < ChunkCount; ++ChunkIndex)
+                    {
+                        generator_chunk *Chunk = Chunks + ChunkIndex;
+                        Chunk->JSONOffset = JSONOffset;
+                        JSONOffset += Chunk->JSONSize;
+                        Sum += Chunk->Sum;
+                    }
+                    
+                    RunOnThreads(Chunks, ChunkCount, WriteChunk);
+                    
+                    for(u32 ChunkIndex = 0; ChunkIndex < ChunkCount; ++ChunkIndex)
+                    {
+                        Written = Written && !Chunks[ChunkIndex].WriteFailed;
+                    }
+                }
+                
+                char const JSONFooter[] = "]}\n";
+                Written = Written && WriteOSFileAt(Settings.FlexJSON, (void *)JSONFooter, sizeof(JSONFooter) - 1, JSONOffset);
+                Written = Written && WriteOSFileAt(Settings.HaverAnswers, &Sum, sizeof(Sum), PairCount*sizeof(f64));
+                
+                u64 EndTime = ReadOSTimer();
+                
+                if(Written)
+                {
+                    fprintf(stdout, "Method: %s\n", MethodName);
+                    fprintf(stdout, "Random seed: %llu\n", Settings.SeedValue);
+                    fprintf(stdout, "Pair count: %llu\n", PairCount);
+                    fprintf(stdout, "Expected sum: %.16f\n", Sum);
+                    fprintf(stdout, "Threads: %u\n", ThreadCount);
+                    fprintf(stdout, "Time: %.3fs (%.2fmb of JSON)\n", (f64)(EndTime - StartTime) / (f64)GetOSTimerFreq(),
+                            (f64)(JSONOffset + sizeof(JSONFooter) - 1) / (1024.0*1024.0));
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: Unable to write the output files.\n");
+                }
+            }
+            
+            if(Settings.FlexJSON != INVALID_OS_FILE) CloseOSFile(Settings.FlexJSON);
+            if(Settings.HaverAnswers != INVALID_OS_FILE) CloseOSFile(Settings.HaverAnswers);
+            if(Settings.PairColumns != INVALID_OS_FILE) CloseOSFile(Settings.PairColumns);
+            free(Memory);
+        }
+        else
+        {
+            fprintf(stderr, "To avoid accidentally generating massive files, number of pairs must be between 1 and %llu.\n", MaxPairCount);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [uniform/cluster] [random seed] [number of coordinate pairs to generate] [binary] [-threads count]\n", Args[0]);
+    }
+    
+    return 0;
+}
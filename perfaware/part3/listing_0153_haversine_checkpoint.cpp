@@ -0,0 +1,236 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 153
+   ======================================================================== */
+
+/* NOTE: A checkpoint for inputs that only ever grow by having pairs appended. It records how
+   far into the JSON the last run got (just past the } of the last pair it summed), how many
+   pairs that was, and the exact state of the running sum. The next run picks up from there
+   and only parses what was added after it.
+   
+   For that to give the same bits as starting over, the running sum can't be the usual
+   Sum += Dist/PairCount, since PairCount changes every time pairs are added. Instead, it's a
+   Kahan sum of the raw distances, and the division only happens when the result is printed.
+   Carrying on from a saved Sum and Compensation is then exactly the same sequence of
+   additions as a full run.
+   
+   Appending to JSON means rewriting the closing ]} as well, so the checkpoint stops right
+   after the last pair, before anything an append would touch. The checkpoint is only used if
+   the input is at least that long and a hash of everything before that point (the one from
+   listing 138) still matches. Otherwise the whole input is summed again. Needs listings 134
+   (ParsePairChunk) and 138 (HashSourceBytes). */
+
+#define HAVERSINE_CHECKPOINT_MAGIC 0x4B435648 // NOTE: "HVCK" in little-endian
+#define HAVERSINE_CHECKPOINT_VERSION 1
+
+struct haversine_sum_state
+{
+    u64 PairCount;
+    f64 Sum;
+    f64 Compensation;
+};
+
+struct haversine_checkpoint
+{
+    u32 Magic;
+    u32 Version;
+    u64 SourceOffset;
+    u64 PrefixHash;
+    haversine_sum_state State;
+};
+
+enum checkpoint_status
+{
+    Checkpoint_Missing,
+    Checkpoint_Valid,
+    Checkpoint_Shrunk,
+    Checkpoint_Changed,
+    
+    Checkpoint_Count,
+};
+
+static char const *CheckpointStatusNames[Checkpoint_Count] =
+{
+    "none",
+    "valid",
+    "input shrank",
+    "input changed before the checkpoint",
+};
+
+static void AccumulateHaversine(haversine_sum_state *State, u64 PairCount, haversine_pair *Pairs)
+{
+    TimeBandwidth(__func__, PairCount*sizeof(haversine_pair));
+    
+    f64 Sum = State->Sum;
+    f64 Compensation = State->Compensation;
+    for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+    {
+        haversine_pair Pair = Pairs[PairIndex];
+        f64 EarthRadius = 6372.8;
+        f64 Value = ReferenceHaversine(Pair.X0, Pair.Y0, Pair.X1, Pair.Y1, EarthRadius) - Compensation;
+        f64 NewSum = Sum + Value;
+        Compensation = (NewSum - Sum) - Value;
+        Sum = NewSum;
+    }
+    
+    State->PairCount += PairCount;
+    State->Sum = Sum;
+    State->Compensation = Compensation;
+}
+
+static f64 GetHaversineMean(haversine_sum_state State)
+{
+    f64 Result = State.PairCount ? (State.Sum / (f64)State.PairCount) : 0;
+    return Result;
+}
+
+static b32 LoadHaversineCheckpoint(char *FileName, haversine_checkpoint *Checkpoint)
+{
+    b32 Result = false;
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+        haversine_checkpoint Loaded = {};
+        if((fread(&Loaded, sizeof(Loaded), 1, File) == 1) &&
+           (Loaded.Magic == HAVERSINE_CHECKPOINT_MAGIC) &&
+           (Loaded.Version == HAVERSINE_CHECKPOINT_VERSION))
+        {
+            *Checkpoint = Loaded;
+            Result = true;
+        }
+        
+        fclose(File);
+    }
+    
+    return Result;
+}
+
+static b32 SaveHaversineCheckpoint(char *FileName, haversine_checkpoint *Checkpoint)
+{
+    // NOTE: Written to a temporary file and renamed over the old one, so a crash mid-write leaves the old checkpoint
+    b32 Result = false;
+    
+    char TempName[4096];
+    int NameLength = snprintf(TempName, sizeof(TempName), "%s.tmp", FileName);
+    if((NameLength > 0) && (NameLength < (int)sizeof(TempName)))
+    {
+        FILE *File = fopen(TempName, "wb");
+        if(File)
+        {
+            b32 Written = (fwrite(Checkpoint, sizeof(*Checkpoint), 1, File) == 1);
+            Written = (fclose(File) == 0) && Written;
+
+#if _WIN32
+            Result = Written && MoveFileExA(TempName, FileName, MOVEFILE_REPLACE_EXISTING);
+#else
+            Result = Written && (rename(TempName, FileName) == 0);
+#endif
+        }
+    }
+    
+    return Result;
+}
+
+static checkpoint_status CheckHaversineCheckpoint(haversine_checkpoint *Checkpoint, buffer InputJSON)
+{
+    checkpoint_status Result = Checkpoint_Shrunk;
+    if(InputJSON.Count >= Checkpoint->SourceOffset)
+    {
+        buffer Prefix = {Checkpoint->SourceOffset, InputJSON.Data};
+        Result = (HashSourceBytes(Prefix) == Checkpoint->PrefixHash) ? Checkpoint_Valid : Checkpoint_Changed;
+    }
+    
+    return Result;
+}
+
+static u64 FindResumeOffset(buffer InputJSON, u64 SourceOffset)
+{
+    // NOTE: Right after a pair, the next thing has to be a comma (more pairs) or the ] (none yet).
+    // Right after the [ of an array that was empty, it can also be the first pair. Returns the
+    // offset to start parsing at, or 0 if it's anything else.
+    u64 Result = 0;
+    
+    u64 At = SourceOffset;
+    while(IsJSONWhitespace(InputJSON, At)) {++At;}
+    if(At < InputJSON.Count)
+    {
+        if(InputJSON.Data[At] == ',')
+        {
+            Result = At + 1;
+        }
+        else if((InputJSON.Data[At] == ']') || (InputJSON.Data[SourceOffset - 1] == '['))
+        {
+            Result = At;
+        }
+    }
+    
+    return Result;
+}
+
+static b32 SumAppendedPairs(buffer InputJSON, haversine_checkpoint *Checkpoint)
+{
+    // NOTE: A checkpoint with a SourceOffset of 0 means start from the beginning of the array.
+    // On success, the checkpoint is moved forward past every pair that was added.
+    TimeFunction;
+    
+    b32 Result = false;
+    
+    u64 Start = Checkpoint->SourceOffset ? FindResumeOffset(InputJSON, Checkpoint->SourceOffset) : FindPairsArray(InputJSON);
+    if(Start)
+    {
+        u32 MinimumJSONPairEncoding = 6*4;
+        u64 MaxPairCount = ((InputJSON.Count - Start) / MinimumJSONPairEncoding) + 1;
+        buffer ParsedValues = AllocateBuffer(MaxPairCount*sizeof(haversine_pair));
+        if(ParsedValues.Count)
+        {
+            pair_chunk Chunk = {};
+            Chunk.InputJSON = InputJSON;
+            Chunk.Start = Start;
+            Chunk.OnePastEnd = InputJSON.Count;
+            Chunk.Pairs = (haversine_pair *)ParsedValues.Data;
+            Chunk.MaxPairCount = MaxPairCount;
+            
+            {
+                TimeBandwidth("Parse appended pairs", InputJSON.Count - Start);
+                ParsePairChunk(&Chunk);
+            }
+            
+            // NOTE: Anything other than a clean run to the ] (like an append that's still being written) leaves the checkpoint alone
+            if(!Chunk.Failed && Chunk.ReachedEndOfArray)
+            {
+                AccumulateHaversine(&Checkpoint->State, Chunk.PairCount, Chunk.Pairs);
+                
+                u64 SourceOffset = Checkpoint->SourceOffset;
+                if(!Checkpoint->SourceOffset || Chunk.PairCount)
+                {
+                    // NOTE: Back from the ] over whitespace to just past the last pair's }, or the [ if there are none
+                    SourceOffset = Chunk.StoppedAt;
+                    while(SourceOffset && IsJSONWhitespace(InputJSON, SourceOffset - 1)) {--SourceOffset;}
+                }
+                
+                Checkpoint->Magic = HAVERSINE_CHECKPOINT_MAGIC;
+                Checkpoint->Version = HAVERSINE_CHECKPOINT_VERSION;
+                Checkpoint->SourceOffset = SourceOffset;
+                Checkpoint->PrefixHash = HashSourceBytes({SourceOffset, InputJSON.Data});
+                
+                Result = true;
+            }
+        }
+        
+        FreeBuffer(&ParsedValues);
+    }
+    
+    return Result;
+}
@@ -0,0 +1,268 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 154
+   ======================================================================== */
+
+/* NOTE: Sums a JSON input that keeps having pairs appended to it, using the checkpoint from
+   listing 153. The checkpoint goes next to the input as <input>.hvcheckpoint unless
+   -checkpoint names another file. Run it, append pairs to the input, and run it again to
+   see only the new pairs get parsed. -full ignores the checkpoint and starts over, which
+   should print exactly the same sum.
+   
+   The sum printed is the mean of the distances, like the other listings, but it's divided
+   out of a Kahan sum rather than summed as Dist/PairCount, so it can differ from the
+   answers file in the last few digits. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#define PROFILER 1
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0132_field_index_json_parser.cpp"
+#include "listing_0134_parallel_haversine_parser.cpp"
+#include "listing_0136_haversine_pair_file.cpp"
+#include "listing_0138_pair_cache.cpp"
+#include "listing_0153_haversine_checkpoint.cpp"
+
+static buffer ReadEntireFile(char *FileName)
+{
+    TimeFunction;
+    
+    buffer Result = {};
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        Result = AllocateBuffer(Stat.st_size);
+        if(Result.Data)
+        {
+            TimeBandwidth("fread", Result.Count);
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+static void Validate(char *AnswersFileName, u64 PairCount, f64 Sum)
+{
+    buffer AnswersF64 = ReadEntireFile(AnswersFileName);
+    if(AnswersF64.Count >= sizeof(f64))
+    {
+        f64 *AnswerValues = (f64 *)AnswersF64.Data;
+        
+        fprintf(stdout, "\nValidation:\n");
+        
+        u64 RefAnswerCount = (AnswersF64.Count - sizeof(f64)) / sizeof(f64);
+        if(PairCount != RefAnswerCount)
+        {
+            fprintf(stdout, "FAILED - pair count doesn't match %llu.\n", RefAnswerCount);
+        }
+        
+        f64 RefSum = AnswerValues[RefAnswerCount];
+        fprintf(stdout, "Reference sum: %.16f\n", RefSum);
+        fprintf(stdout, "Difference: %.16f\n", Sum - RefSum);
+        
+        fprintf(stdout, "\n");
+    }
+    
+    FreeBuffer(&AnswersF64);
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&FreeJSON;
+    (void)&TryToEnableLargePages;
+    (void)&ParseHaversinePairsParallel;
+    (void)&GetPairCacheKey;
+    (void)&GetCachedPairColumns;
+    (void)&WritePairCache;
+    
+    BeginProfile();
+    
+    int Result = 1;
+    
+    // NOTE: -checkpoint and -full can go anywhere on the command line
+    char *CheckpointArg = 0;
+    b32 ForceFull = false;
+    char *FileNames[2] = {};
+    u32 FileNameCount = 0;
+    b32 ValidArgs = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        if((strcmp(Args[ArgIndex], "-checkpoint") == 0) && ((ArgIndex + 1) < ArgCount))
+        {
+            CheckpointArg = Args[++ArgIndex];
+        }
+        else if(strcmp(Args[ArgIndex], "-full") == 0)
+        {
+            ForceFull = true;
+        }
+        else if(FileNameCount < ArrayCount(FileNames))
+        {
+            FileNames[FileNameCount++] = Args[ArgIndex];
+        }
+        else
+        {
+            ValidArgs = false;
+        }
+    }
+    
+    char CheckpointName[4096];
+    if(ValidArgs && FileNameCount)
+    {
+        int NameLength = CheckpointArg ?
+            snprintf(CheckpointName, sizeof(CheckpointName), "%s", CheckpointArg) :
+            snprintf(CheckpointName, sizeof(CheckpointName), "%s.hvcheckpoint", FileNames[0]);
+        ValidArgs = ((NameLength > 0) && (NameLength < (int)sizeof(CheckpointName)));
+    }
+    
+    if(ValidArgs && FileNameCount)
+    {
+        buffer Mapped = {};
+        {
+            TimeBlock("Map");
+            Mapped = MapFileReadOnly(FileNames[0]);
+        }
+        
+        if(Mapped.Count)
+        {
+            haversine_checkpoint Checkpoint = {};
+            checkpoint_status Status = Checkpoint_Missing;
+            if(!ForceFull && LoadHaversineCheckpoint(CheckpointName, &Checkpoint))
+            {
+                TimeBlock("Check checkpoint");
+                Status = CheckHaversineCheckpoint(&Checkpoint, Mapped);
+            }
+            
+            if(Status != Checkpoint_Valid)
+            {
+                Checkpoint = {};
+            }
+            
+            haversine_checkpoint Previous = Checkpoint;
+            if(SumAppendedPairs(Mapped, &Checkpoint))
+            {
+                Result = 0;
+                
+                fprintf(stdout, "Input size: %llu\n", Mapped.Count);
+                if(Status == Checkpoint_Valid)
+                {
+                    fprintf(stdout, "Resumed at: pair %llu (byte %llu)\n", Previous.State.PairCount, Previous.SourceOffset);
+                }
+                else
+                {
+                    fprintf(stdout, "Full recompute: %s\n", ForceFull ? "requested" : CheckpointStatusNames[Status]);
+                }
+                fprintf(stdout, "New pairs: %llu (%llu bytes)\n",
+                        Checkpoint.State.PairCount - Previous.State.PairCount, Mapped.Count - Previous.SourceOffset);
+                fprintf(stdout, "Pair count: %llu\n", Checkpoint.State.PairCount);
+                fprintf(stdout, "Haversine sum: %.16f\n", GetHaversineMean(Checkpoint.State));
+                
+                if(!SaveHaversineCheckpoint(CheckpointName, &Checkpoint))
+                {
+                    fprintf(stderr, "WARNING: Unable to write checkpoint \"%s\".\n", CheckpointName);
+                }
+                
+                if(FileNameCount == 2)
+                {
+                    Validate(FileNames[1], Checkpoint.State.PairCount, GetHaversineMean(Checkpoint.State));
+                }
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Malformed input\n");
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileNames[0]);
+        }
+        
+        UnmapFile(&Mapped);
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [haversine_input.json] [-checkpoint file] [-full]\n", Args[0]);
+        fprintf(stderr, "       %s [haversine_input.json] [answers.f64] [-checkpoint file] [-full]\n", Args[0]);
+    }
+    
+    if(Result == 0)
+    {
+        EndAndPrintProfile();
+    }
+    
+    return Result;
+}
+
+ProfilerEndOfCompilationUnit;
@@ -0,0 +1,460 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 155
+   ======================================================================== */
+
+/* NOTE: A lazy version of ParseJSON from listing 132. ParseJSONLazy only walks the structural
+   index from listing 126 once, checking the grammar as it goes, and writes a flat tape with
+   one entry per value or label:
+       
+       Offset - where the token starts in the source
+       Link   - for { and [, the tape index just past everything inside them
+                for strings, the offset of the closing quote
+                for anything else, 0
+   
+   No json_element is made until something asks for it. FirstSubElement, NextSibling and
+   LookupElement take the document and make elements in the arena for just the entries they
+   walk over. NextSibling on a container jumps straight over its contents with Link, so a
+   subtree that nobody looks into costs nothing past building the tape.
+   
+   Elements from here are ordinary json_elements, but their FirstSubElement and NextSibling
+   fields are only filled in once the functions of the same name have been called on them,
+   so a lazy tree has to be walked through those functions. Scalars are only tokenized when
+   their element is made, so a bad number or keyword in a part of the input that is never
+   looked at is never reported. Needs listing 132. */
+
+#define JSON_TAPE_MAX_DEPTH 1024
+
+struct json_tape_entry
+{
+    u64 Offset;
+    u64 Link;
+};
+
+struct json_document
+{
+    // NOTE: Holds the source, the arena elements go into, and HadError. Never has an Index.
+    json_parser Parser;
+    
+    u64 TapeCount;
+    u64 TapeCapacity;
+    json_tape_entry *Tape;
+};
+
+struct json_lazy_element
+{
+    // NOTE: Element has to come first, since the json_element pointers handed out are cast back to this
+    json_element Element;
+    
+    u64 ValueIndex;
+    u64 OnePastValue;
+    u64 OnePastParent;
+    b32 HasLabel;
+    
+    b32 SubElementsLoaded;
+    b32 NextSiblingLoaded;
+};
+
+enum json_tape_expect
+{
+    Expect_Value,
+    Expect_ValueOrClose,
+    Expect_Key,
+    Expect_KeyOrClose,
+    Expect_Colon,
+    Expect_CommaOrClose,
+    Expect_End,
+};
+
+static u64 AppendTapeEntry(json_document *Document, u64 Offset, u64 Link)
+{
+    if(Document->TapeCount == Document->TapeCapacity)
+    {
+        u64 NewCapacity = Document->TapeCapacity ? 2*Document->TapeCapacity : 4096;
+        json_tape_entry *NewTape = (json_tape_entry *)realloc(Document->Tape, NewCapacity*sizeof(json_tape_entry));
+        if(NewTape)
+        {
+            Document->Tape = NewTape;
+            Document->TapeCapacity = NewCapacity;
+        }
+    }
+    
+    u64 Result = Document->TapeCount;
+    if(Result < Document->TapeCapacity)
+    {
+        Document->Tape[Document->TapeCount++] = {Offset, Link};
+    }
+    else
+    {
+        Document->Parser.HadError = true;
+        fprintf(stderr, "ERROR: Unable to allocate JSON tape\n");
+    }
+    
+    return Result;
+}
+
+static void BuildJSONTape(json_document *Document)
+{
+    TimeBandwidth(__func__, Document->Parser.Source.Count);
+    
+    json_parser *Parser = &Document->Parser;
+    buffer Source = Parser->Source;
+    
+    json_structural_indexer Index;
+    BeginStructuralIndex(&Index, Source);
+    
+    u64 OpenIndex[JSON_TAPE_MAX_DEPTH];
+    u32 Depth = 0;
+    json_tape_expect Expect = Expect_Value;
+    
+    for(u64 At = NextStructural(&Index); !Parser->HadError && (At < Source.Count); At = NextStructural(&Index))
+    {
+        json_token Token = {Token_error, {1, Source.Data + At}};
+        
+        b32 IsValue = ((Expect == Expect_Value) || (Expect == Expect_ValueOrClose));
+        b32 IsKey = ((Expect == Expect_Key) || (Expect == Expect_KeyOrClose));
+        b32 AfterValue = false;
+        
+        u8 Val = Source.Data[At];
+        switch(Val)
+        {
+            case '{':
+            case '[':
+            {
+                if(!IsValue)
+                {
+                    Error(Parser, Token, "Unexpected token in JSON");
+                }
+                else if(Depth == JSON_TAPE_MAX_DEPTH)
+                {
+                    Error(Parser, Token, "JSON nested too deeply");
+                }
+                else
+                {
+                    OpenIndex[Depth++] = AppendTapeEntry(Document, At, 0);
+                    Expect = (Val == '{') ? Expect_KeyOrClose : Expect_ValueOrClose;
+                }
+            } break;
+            
+            case '}':
+            case ']':
+            {
+                u8 Open = Depth ? Source.Data[Document->Tape[OpenIndex[Depth - 1]].Offset] : 0;
+                b32 CanClose = ((Expect == Expect_CommaOrClose) ||
+                                ((Val == '}') && (Expect == Expect_KeyOrClose)) ||
+                                ((Val == ']') && (Expect == Expect_ValueOrClose)));
+                if(CanClose && (Open == ((Val == '}') ? '{' : '[')))
+                {
+                    Document->Tape[OpenIndex[--Depth]].Link = Document->TapeCount;
+                    AfterValue = true;
+                }
+                else
+                {
+                    Error(Parser, Token, "Unexpected token in JSON");
+                }
+            } break;
+            
+            case ',':
+            {
+                if(Expect == Expect_CommaOrClose)
+                {
+                    Expect = (Source.Data[Document->Tape[OpenIndex[Depth - 1]].Offset] == '{') ? Expect_Key : Expect_Value;
+                }
+                else
+                {
+                    Error(Parser, Token, "Unexpected token in JSON");
+                }
+            } break;
+            
+            case ':':
+            {
+                if(Expect == Expect_Colon)
+                {
+                    Expect = Expect_Value;
+                }
+                else
+                {
+                    Error(Parser, Token, "Expected colon after field name");
+                }
+            } break;
+            
+            case '"':
+            {
+                // NOTE: As in GetJSONTokenFromIndex, the next structural is the closing quote
+                u64 StringEnd = NextStructural(&Index);
+                if(!IsInBounds(Source, StringEnd))
+                {
+                    Error(Parser, Token, "Unterminated string in JSON");
+                }
+                else if(IsKey || IsValue)
+                {
+                    AppendTapeEntry(Document, At, StringEnd);
+                    Expect = Expect_Colon;
+                    AfterValue = IsValue;
+                }
+                else
+                {
+                    Error(Parser, Token, "Unexpected token in JSON");
+                }
+            } break;
+            
+            default:
+            {
+                // NOTE: The start of a number or keyword. It is checked when its element is made.
+                if(IsValue)
+                {
+                    AppendTapeEntry(Document, At, 0);
+                    AfterValue = true;
+                }
+                else
+                {
+                    Error(Parser, Token, "Unexpected token in JSON");
+                }
+            } break;
+        }
+        
+        if(AfterValue)
+        {
+            Expect = Depth ? Expect_CommaOrClose : Expect_End;
+        }
+    }
+    
+    if(!Parser->HadError && (Expect != Expect_End))
+    {
+        Error(Parser, {Token_end_of_stream, {}}, "Unexpected end of JSON");
+    }
+}
+
+static json_element *MakeLazyElement(json_document *Document, u64 TapeIndex, u64 OnePastParent, b32 HasLabel)
+{
+    // NOTE: Makes the element whose label (if HasLabel) or value is at TapeIndex, or returns 0 if that's past the parent
+    json_element *Result = 0;
+    
+    json_parser *Parser = &Document->Parser;
+    if((TapeIndex < OnePastParent) && !Parser->HadError)
+    {
+        buffer Source = Parser->Source;
+        
+        buffer Label = {};
+        u64 ValueIndex = TapeIndex;
+        if(HasLabel)
+        {
+            json_tape_entry LabelEntry = Document->Tape[TapeIndex];
+            Label.Data = Source.Data + LabelEntry.Offset + 1;
+            Label.Count = LabelEntry.Link - (LabelEntry.Offset + 1);
+            ++ValueIndex;
+        }
+        
+        json_tape_entry Entry = Document->Tape[ValueIndex];
+        u8 Val = Source.Data[Entry.Offset];
+        
+        json_token Value = {};
+        u64 OnePastValue = ValueIndex + 1;
+        if((Val == '{') || (Val == '['))
+        {
+            Value.Type = (Val == '{') ? Token_open_brace : Token_open_bracket;
+            Value.Value = {1, Source.Data + Entry.Offset};
+            OnePastValue = Entry.Link;
+        }
+        else if(Val == '"')
+        {
+            Value.Type = Token_string_literal;
+            Value.Value = {Entry.Link - (Entry.Offset + 1), Source.Data + Entry.Offset + 1};
+        }
+        else
+        {
+            Parser->At = Entry.Offset;
+            Value = GetJSONTokenByteAtATime(Parser);
+            if((Value.Type != Token_number) && (Value.Type != Token_true) &&
+               (Value.Type != Token_false) && (Value.Type != Token_null))
+            {
+                Error(Parser, Value, "Unexpected token in JSON");
+            }
+        }
+        
+        json_lazy_element *Lazy = Parser->HadError ? 0 : PushStruct(Parser->Arena, json_lazy_element);
+        if(Lazy)
+        {
+            Lazy->Element.Label = Label;
+            Lazy->Element.Value = Value.Value;
+            Lazy->Element.FirstSubElement = 0;
+            Lazy->Element.FieldIndex = 0;
+            Lazy->Element.NextSibling = 0;
+            
+            Lazy->ValueIndex = ValueIndex;
+            Lazy->OnePastValue = OnePastValue;
+            Lazy->OnePastParent = OnePastParent;
+            Lazy->HasLabel = HasLabel;
+            
+            // NOTE: Scalars have nothing inside them to load
+            Lazy->SubElementsLoaded = (OnePastValue == (ValueIndex + 1));
+            Lazy->NextSiblingLoaded = false;
+            
+            Result = &Lazy->Element;
+        }
+    }
+    
+    return Result;
+}
+
+static json_element *ParseJSONLazy(json_document *Document, buffer InputJSON, arena *Arena)
+{
+    // NOTE: Elements go into Arena. The tape is malloced and kept in Document until FreeJSONDocument.
+    TimeFunction;
+    
+    Document->Parser = {};
+    Document->Parser.Source = InputJSON;
+    Document->Parser.Arena = Arena;
+    Document->TapeCount = 0;
+    
+    BuildJSONTape(Document);
+    
+    json_element *Result = MakeLazyElement(Document, 0, Document->TapeCount, false);
+    return Result;
+}
+
+static void FreeJSONDocument(json_document *Document)
+{
+    free(Document->Tape);
+    Document->Tape = 0;
+    Document->TapeCount = 0;
+    Document->TapeCapacity = 0;
+}
+
+static json_element *FirstSubElement(json_document *Document, json_element *Element)
+{
+    json_element *Result = 0;
+    
+    json_lazy_element *Lazy = (json_lazy_element *)Element;
+    if(Lazy)
+    {
+        if(!Lazy->SubElementsLoaded)
+        {
+            b32 HasLabels = (Lazy->Element.Value.Data[0] == '{');
+            Lazy->Element.FirstSubElement = MakeLazyElement(Document, Lazy->ValueIndex + 1, Lazy->OnePastValue, HasLabels);
+            Lazy->SubElementsLoaded = true;
+        }
+        
+        Result = Lazy->Element.FirstSubElement;
+    }
+    
+    return Result;
+}
+
+static json_element *NextSibling(json_document *Document, json_element *Element)
+{
+    json_element *Result = 0;
+    
+    json_lazy_element *Lazy = (json_lazy_element *)Element;
+    if(Lazy)
+    {
+        if(!Lazy->NextSiblingLoaded)
+        {
+            Lazy->Element.NextSibling = MakeLazyElement(Document, Lazy->OnePastValue, Lazy->OnePastParent, Lazy->HasLabel);
+            Lazy->NextSiblingLoaded = true;
+        }
+        
+        Result = Lazy->Element.NextSibling;
+    }
+    
+    return Result;
+}
+
+static json_element *LookupElement(json_document *Document, json_element *Object, buffer ElementName)
+{
+    // NOTE: Builds a field index like listing 132 does once a lookup walks far enough. The index
+    // is built from the FirstSubElement/NextSibling fields, so every field gets loaded first.
+    json_element *Result = 0;
+    
+    if(Object)
+    {
+        if(Object->FieldIndex)
+        {
+            Result = LookupElement(Object, ElementName);
+        }
+        else
+        {
+            u64 SearchCount = 0;
+            for(json_element *Search = FirstSubElement(Document, Object); Search; Search = NextSibling(Document, Search))
+            {
+                if(AreEqual(Search->Label, ElementName))
+                {
+                    Result = Search;
+                    break;
+                }
+                
+                ++SearchCount;
+            }
+            
+            if(SearchCount >= JSON_FIELD_INDEX_THRESHOLD)
+            {
+                for(json_element *Search = Result; Search; Search = NextSibling(Document, Search)) {}
+                Object->FieldIndex = BuildFieldIndex(Object, Document->Parser.Arena);
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static f64 ConvertElementToF64(json_document *Document, json_element *Object, buffer ElementName)
+{
+    f64 Result = 0.0;
+    
+    json_element *Element = LookupElement(Document, Object, ElementName);
+    if(Element)
+    {
+        Result = ConvertJSONToF64Exact(Element->Value);
+    }
+    
+    return Result;
+}
+
+static u64 ParseHaversinePairsLazy(buffer InputJSON, u64 MaxPairCount, haversine_pair *Pairs, arena *Arena)
+{
+    // NOTE: Arena is used as scratch space for the elements and is reset before returning
+    TimeFunction;
+    
+    u64 PairCount = 0;
+    
+    json_document Document = {};
+    json_element *JSON = ParseJSONLazy(&Document, InputJSON, Arena);
+    
+    json_element *PairsArray = LookupElement(&Document, JSON, CONSTANT_STRING("pairs"));
+    if(PairsArray)
+    {
+        TimeBlock("Lookup and Convert");
+        
+        for(json_element *Element = FirstSubElement(&Document, PairsArray);
+            Element && (PairCount < MaxPairCount);
+            Element = NextSibling(&Document, Element))
+        {
+            haversine_pair *Pair = Pairs + PairCount++;
+            
+            Pair->X0 = ConvertElementToF64(&Document, Element, CONSTANT_STRING("x0"));
+            Pair->Y0 = ConvertElementToF64(&Document, Element, CONSTANT_STRING("y0"));
+            Pair->X1 = ConvertElementToF64(&Document, Element, CONSTANT_STRING("x1"));
+            Pair->Y1 = ConvertElementToF64(&Document, Element, CONSTANT_STRING("y1"));
+        }
+    }
+    
+    FreeJSONDocument(&Document);
+    
+    {
+        TimeBlock("ResetArena");
+        ResetArena(Arena);
+    }
+    
+    return PairCount;
+}
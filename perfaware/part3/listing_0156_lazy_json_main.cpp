@@ -0,0 +1,364 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 156
+   ======================================================================== */
+
+/* NOTE: Runs three queries on a haversine input, each with ParseJSON from listing 132 and
+   with ParseJSONLazy from listing 155:
+       
+       first pair - the four fields of pairs[0]
+       pair count - how many elements pairs has, without looking inside any of them
+       all pairs  - every field of every pair, like ParseHaversinePairs
+   
+   Before timing, each query is run both ways to check they agree, and the bytes each one
+   used are printed: the arena for the eager tree, and the arena plus the tape for lazy. The
+   tape is paid in full whatever the query touches, and it's a large part of the total: one
+   16-byte entry per label and value, in a buffer that grows by doubling. The first two
+   queries only make elements for what they touch, so first pair costs little more than the
+   tape. All pairs makes every element on top of the tape, so that's the worst case. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0103_repetition_tester.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0132_field_index_json_parser.cpp"
+#include "listing_0155_lazy_json_tape.cpp"
+
+// NOTE: Queries leave their elements in the arena, so the arena can be measured afterwards. They return the pair count.
+typedef u64 json_query_func(buffer InputJSON, arena *Arena, u64 MaxPairCount, haversine_pair *Pairs);
+
+static void ConvertPair(json_element *Element, haversine_pair *Pair)
+{
+    Pair->X0 = ConvertElementToF64(Element, CONSTANT_STRING("x0"));
+    Pair->Y0 = ConvertElementToF64(Element, CONSTANT_STRING("y0"));
+    Pair->X1 = ConvertElementToF64(Element, CONSTANT_STRING("x1"));
+    Pair->Y1 = ConvertElementToF64(Element, CONSTANT_STRING("y1"));
+}
+
+static void ConvertPair(json_document *Document, json_element *Element, haversine_pair *Pair)
+{
+    Pair->X0 = ConvertElementToF64(Document, Element, CONSTANT_STRING("x0"));
+    Pair->Y0 = ConvertElementToF64(Document, Element, CONSTANT_STRING("y0"));
+    Pair->X1 = ConvertElementToF64(Document, Element, CONSTANT_STRING("x1"));
+    Pair->Y1 = ConvertElementToF64(Document, Element, CONSTANT_STRING("y1"));
+}
+
+static u64 FirstPairEager(buffer InputJSON, arena *Arena, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    u64 Result = 0;
+    
+    json_element *PairsArray = LookupElement(ParseJSON(InputJSON, Arena), CONSTANT_STRING("pairs"));
+    json_element *Element = PairsArray ? PairsArray->FirstSubElement : 0;
+    if(Element && MaxPairCount)
+    {
+        ConvertPair(Element, Pairs);
+        Result = 1;
+    }
+    
+    return Result;
+}
+
+// NOTE: The tape is malloced rather than pushed on the arena, so the lazy queries leave its size here for CheckQuery
+static u64 GlobalLastTapeSize;
+
+static void FreeQueryDocument(json_document *Document)
+{
+    GlobalLastTapeSize = Document->TapeCapacity*sizeof(json_tape_entry);
+    FreeJSONDocument(Document);
+}
+
+static u64 FirstPairLazy(buffer InputJSON, arena *Arena, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    u64 Result = 0;
+    
+    json_document Document = {};
+    json_element *PairsArray = LookupElement(&Document, ParseJSONLazy(&Document, InputJSON, Arena), CONSTANT_STRING("pairs"));
+    json_element *Element = FirstSubElement(&Document, PairsArray);
+    if(Element && MaxPairCount)
+    {
+        ConvertPair(&Document, Element, Pairs);
+        Result = 1;
+    }
+    
+    FreeQueryDocument(&Document);
+    
+    return Result;
+}
+
+static u64 PairCountEager(buffer InputJSON, arena *Arena, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    u64 Result = 0;
+    
+    json_element *PairsArray = LookupElement(ParseJSON(InputJSON, Arena), CONSTANT_STRING("pairs"));
+    for(json_element *Element = PairsArray ? PairsArray->FirstSubElement : 0; Element; Element = Element->NextSibling)
+    {
+        ++Result;
+    }
+    
+    return Result;
+}
+
+static u64 PairCountLazy(buffer InputJSON, arena *Arena, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    u64 Result = 0;
+    
+    json_document Document = {};
+    json_element *PairsArray = LookupElement(&Document, ParseJSONLazy(&Document, InputJSON, Arena), CONSTANT_STRING("pairs"));
+    for(json_element *Element = FirstSubElement(&Document, PairsArray); Element; Element = NextSibling(&Document, Element))
+    {
+        ++Result;
+    }
+    
+    FreeQueryDocument(&Document);
+    
+    return Result;
+}
+
+static u64 AllPairsEager(buffer InputJSON, arena *Arena, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    u64 Result = 0;
+    
+    json_element *PairsArray = LookupElement(ParseJSON(InputJSON, Arena), CONSTANT_STRING("pairs"));
+    for(json_element *Element = PairsArray ? PairsArray->FirstSubElement : 0;
+        Element && (Result < MaxPairCount);
+        Element = Element->NextSibling)
+    {
+        ConvertPair(Element, Pairs + Result++);
+    }
+    
+    return Result;
+}
+
+static u64 AllPairsLazy(buffer InputJSON, arena *Arena, u64 MaxPairCount, haversine_pair *Pairs)
+{
+    u64 Result = 0;
+    
+    json_document Document = {};
+    json_element *PairsArray = LookupElement(&Document, ParseJSONLazy(&Document, InputJSON, Arena), CONSTANT_STRING("pairs"));
+    for(json_element *Element = FirstSubElement(&Document, PairsArray);
+        Element && (Result < MaxPairCount);
+        Element = NextSibling(&Document, Element))
+    {
+        ConvertPair(&Document, Element, Pairs + Result++);
+    }
+    
+    FreeQueryDocument(&Document);
+    
+    return Result;
+}
+
+struct json_query
+{
+    char const *Name;
+    json_query_func *Eager;
+    json_query_func *Lazy;
+};
+json_query Queries[] =
+{
+    {"first pair", FirstPairEager, FirstPairLazy},
+    {"pair count", PairCountEager, PairCountLazy},
+    {"all pairs", AllPairsEager, AllPairsLazy},
+};
+
+struct query_parameters
+{
+    buffer InputJSON;
+    arena *Arena;
+    u64 MaxPairCount;
+    haversine_pair *Pairs;
+    
+    u64 Sink;
+};
+
+static void RunQuery(repetition_tester *Tester, query_parameters *Params, json_query_func *Query)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        Params->Sink += Query(Params->InputJSON, Params->Arena, Params->MaxPairCount, Params->Pairs);
+        ResetArena(Params->Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static b32 CheckQuery(json_query Query, query_parameters *Params, haversine_pair *LazyPairs)
+{
+    // NOTE: Runs the query both ways, prints what each allocated, and returns whether they found the same pairs
+    u64 EagerCount = Query.Eager(Params->InputJSON, Params->Arena, Params->MaxPairCount, Params->Pairs);
+    u64 EagerBytes = Params->Arena->TotalUsed;
+    ResetArena(Params->Arena);
+    
+    GlobalLastTapeSize = 0;
+    u64 LazyCount = Query.Lazy(Params->InputJSON, Params->Arena, Params->MaxPairCount, LazyPairs);
+    u64 LazyElementBytes = Params->Arena->TotalUsed;
+    u64 LazyBytes = LazyElementBytes + GlobalLastTapeSize;
+    ResetArena(Params->Arena);
+    
+    // NOTE: pair count doesn't write any pairs, so there's nothing to compare but the count
+    u64 CompareCount = (Query.Eager == PairCountEager) ? 0 : EagerCount;
+    b32 Result = ((EagerCount == LazyCount) &&
+                  (memcmp(Params->Pairs, LazyPairs, CompareCount*sizeof(haversine_pair)) == 0));
+    
+    printf("%s: %llu pair(s), %s, bytes %llu eager / %llu lazy (%llu elements + %llu tape)\n", Query.Name, EagerCount,
+           Result ? "identical" : "MISMATCH", EagerBytes, LazyBytes, LazyElementBytes, GlobalLastTapeSize);
+    
+    return Result;
+}
+
+static buffer ReadEntireFile(char *FileName)
+{
+    buffer Result = {};
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        Result = AllocateBuffer(Stat.st_size);
+        if(Result.Data)
+        {
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&BeginProfile;
+    (void)&EndAndPrintProfile;
+    (void)&FreeJSON;
+    (void)&ParseHaversinePairs;
+    (void)&ParseHaversinePairsLazy;
+    (void)&TryToEnableLargePages;
+    
+    if(ArgCount == 2)
+    {
+        u64 CPUTimerFreq = EstimateCPUTimerFreq();
+        
+        arena Arena = {};
+        
+        query_parameters Params = {};
+        Params.InputJSON = ReadEntireFile(Args[1]);
+        Params.Arena = &Arena;
+        
+        u32 MinimumJSONPairEncoding = 6*4;
+        Params.MaxPairCount = Params.InputJSON.Count / MinimumJSONPairEncoding;
+        
+        buffer ParsedValues = AllocateBuffer(Params.MaxPairCount*sizeof(haversine_pair));
+        buffer LazyValues = AllocateBuffer(Params.MaxPairCount*sizeof(haversine_pair));
+        Params.Pairs = (haversine_pair *)ParsedValues.Data;
+        
+        if(Params.MaxPairCount && ParsedValues.Count && LazyValues.Count)
+        {
+            b32 AllMatch = true;
+            for(u32 QueryIndex = 0; QueryIndex < ArrayCount(Queries); ++QueryIndex)
+            {
+                AllMatch = CheckQuery(Queries[QueryIndex], &Params, (haversine_pair *)LazyValues.Data) && AllMatch;
+            }
+            FreeBuffer(&LazyValues);
+            
+            if(AllMatch)
+            {
+                repetition_tester Testers[ArrayCount(Queries)][2] = {};
+                
+                for(;;)
+                {
+                    for(u32 QueryIndex = 0; QueryIndex < ArrayCount(Queries); ++QueryIndex)
+                    {
+                        json_query Query = Queries[QueryIndex];
+                        
+                        printf("\n--- %s, eager ---\n", Query.Name);
+                        NewTestWave(&Testers[QueryIndex][0], Params.InputJSON.Count, CPUTimerFreq);
+                        RunQuery(&Testers[QueryIndex][0], &Params, Query.Eager);
+                        
+                        printf("\n--- %s, lazy ---\n", Query.Name);
+                        NewTestWave(&Testers[QueryIndex][1], Params.InputJSON.Count, CPUTimerFreq);
+                        RunQuery(&Testers[QueryIndex][1], &Params, Query.Lazy);
+                    }
+                }
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Malformed input JSON\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [haversine_input.json]\n", Args[0]);
+    }
+    
+    return 0;
+}
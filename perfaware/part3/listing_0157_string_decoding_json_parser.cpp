@@ -0,0 +1,1135 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 157
+   ======================================================================== */
+
+/* NOTE: The parser from listing 132, with strings handled to the spec instead of as opaque
+   bytes. Before, only \" was recognized, so a label written with any other escape never
+   matched in LookupElement, and nothing checked that strings were valid UTF-8.
+   
+   Every string token is now checked 32 bytes at a time with AVX2 (or a byte at a time
+   without it) for three things: whether it has a backslash, whether it has a raw control
+   character (which JSON doesn't allow), and whether it is valid UTF-8. The UTF-8 check is
+   the lookup-table method from Keiser and Lemire, "Validating UTF-8 In Less Than One
+   Instruction Per Byte": three table lookups on nibbles of each byte and the one before it
+   flag every bad two-byte combination, and the lengths of 3 and 4 byte sequences are checked
+   separately. Blocks that are all ASCII skip all of it.
+   
+   The byte-at-a-time tokenizer also finds the closing quote 32 bytes at a time, and skips
+   whatever follows any backslash, rather than only quotes.
+   
+   Strings with no backslash are still pointed to in the source, as before. Labels and string
+   values that do have one are decoded (\n, \uXXXX, surrogate pairs and so on) into space
+   allocated along with their element, so they go away with it whether the tree was parsed
+   into an arena or with malloc. Bad escapes, lone surrogates, control characters and bad
+   UTF-8 are all errors. */
+
+enum json_token_type
+{
+    Token_end_of_stream,
+    Token_error,
+    
+    Token_open_brace,
+    Token_open_bracket,
+    Token_close_brace,
+    Token_close_bracket,
+    Token_comma,
+    Token_colon,
+    Token_string_literal,
+    Token_number,
+    Token_true,
+    Token_false,
+    Token_null,
+    
+    Token_count,
+};
+
+struct json_token
+{
+    json_token_type Type;
+    buffer Value;
+    
+    // NOTE: Only for strings. If set, Value is still the raw bytes, and needs decoding.
+    b32 HasEscapes;
+};
+
+struct json_field_index;
+struct json_element
+{
+    buffer Label;
+    buffer Value;
+    json_element *FirstSubElement;
+    json_field_index *FieldIndex;
+    
+    json_element *NextSibling;
+};
+
+struct json_parser
+{
+    buffer Source;
+    u64 At;
+    b32 HadError;
+    
+    // NOTE: If set, elements are allocated from here instead of with malloc
+    arena *Arena;
+    
+    // NOTE: If set, tokens come from the structural index instead of scanning every byte
+    json_structural_indexer *Index;
+    
+    // NOTE: If set, strings are scanned with AVX2
+    b32 UseAVX2;
+};
+
+static b32 IsJSONDigit(buffer Source, u64 At)
+{
+    b32 Result = false;
+    if(IsInBounds(Source, At))
+    {
+        u8 Val = Source.Data[At];
+        Result = ((Val >= '0') && (Val <= '9'));
+    }
+    
+    return Result;
+}
+
+static b32 IsJSONWhitespace(buffer Source, u64 At)
+{
+    b32 Result = false;
+    if(IsInBounds(Source, At))
+    {
+        u8 Val = Source.Data[At];
+        Result = ((Val == ' ') || (Val == '\t') || (Val == '\n') || (Val == '\r'));
+    }
+    
+    return Result;
+}
+
+static b32 IsParsing(json_parser *Parser)
+{
+    b32 Result = !Parser->HadError;
+    if(Parser->Index)
+    {
+        Result = Result && (PeekStructural(Parser->Index) < Parser->Source.Count);
+    }
+    else
+    {
+        Result = Result && IsInBounds(Parser->Source, Parser->At);
+    }
+    
+    return Result;
+}
+
+static void Error(json_parser *Parser, json_token Token, char const *Message)
+{
+    Parser->HadError = true;
+    fprintf(stderr, "ERROR: \"%.*s\" - %s\n", (u32)Token.Value.Count, (char *)Token.Value.Data, Message);
+}
+
+#if _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+struct json_string_check
+{
+    b32 HasEscapes;
+    b32 Valid;
+};
+
+static u64 FindJSONStringEndScalar(buffer Source, u64 At)
+{
+    // NOTE: At is just past the opening quote. Returns the offset of the closing quote, or Source.Count if there isn't one.
+    while(IsInBounds(Source, At) && (Source.Data[At] != '"'))
+    {
+        At += (Source.Data[At] == '\\') ? 2 : 1;
+    }
+    
+    u64 Result = (At < Source.Count) ? At : Source.Count;
+    return Result;
+}
+
+TARGET_AVX2
+static u64 FindJSONStringEndAVX2(buffer Source, u64 At)
+{
+    __m256i Quote = _mm256_set1_epi8('"');
+    __m256i Backslash = _mm256_set1_epi8('\\');
+    
+    while((At + 32) <= Source.Count)
+    {
+        __m256i Bytes = _mm256_loadu_si256((__m256i *)(Source.Data + At));
+        u32 QuoteMask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Quote));
+        u32 BackslashMask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Backslash));
+        
+        u32 Either = QuoteMask | BackslashMask;
+        if(Either)
+        {
+            u32 First = CountTrailingZeros(Either);
+            if(QuoteMask & (1u << First))
+            {
+                return At + First;
+            }
+            
+            // NOTE: A backslash, so whatever comes after it can't end the string
+            At += First + 2;
+        }
+        else
+        {
+            At += 32;
+        }
+    }
+    
+    u64 Result = FindJSONStringEndScalar(Source, At);
+    return Result;
+}
+
+static u32 GetUTF8SequenceLength(buffer String, u64 At)
+{
+    // NOTE: Returns the length of the well-formed UTF-8 sequence starting at At, or 0 if it isn't one.
+    // The second byte's range depends on the first, to rule out overlongs, surrogates and anything past U+10FFFF.
+    u8 Lead = String.Data[At];
+    
+    u32 Length = 0;
+    u8 Low = 0x80;
+    u8 High = 0xBF;
+    if((Lead >= 0xC2) && (Lead <= 0xDF)) {Length = 2;}
+    else if(Lead == 0xE0) {Length = 3; Low = 0xA0;}
+    else if(Lead == 0xED) {Length = 3; High = 0x9F;}
+    else if((Lead >= 0xE1) && (Lead <= 0xEF)) {Length = 3;}
+    else if(Lead == 0xF0) {Length = 4; Low = 0x90;}
+    else if(Lead == 0xF4) {Length = 4; High = 0x8F;}
+    else if((Lead >= 0xF1) && (Lead <= 0xF3)) {Length = 4;}
+    
+    u32 Result = Length;
+    if((At + Length) > String.Count)
+    {
+        Result = 0;
+    }
+    
+    for(u32 Index = 1; Result && (Index < Length); ++Index)
+    {
+        u8 Byte = String.Data[At + Index];
+        if((Byte < Low) || (Byte > High))
+        {
+            Result = 0;
+        }
+        
+        Low = 0x80;
+        High = 0xBF;
+    }
+    
+    return Result;
+}
+
+static json_string_check CheckJSONStringScalar(buffer String)
+{
+    json_string_check Result = {};
+    Result.Valid = true;
+    
+    u64 At = 0;
+    while(Result.Valid && (At < String.Count))
+    {
+        u8 Byte = String.Data[At];
+        if(Byte < 0x20)
+        {
+            Result.Valid = false;
+        }
+        else if(Byte < 0x80)
+        {
+            Result.HasEscapes |= (Byte == '\\');
+            ++At;
+        }
+        else
+        {
+            u32 Length = GetUTF8SequenceLength(String, At);
+            Result.Valid = (Length != 0);
+            At += Length;
+        }
+    }
+    
+    return Result;
+}
+
+// NOTE: Error bits for the UTF-8 lookup tables. Each table gives the errors a nibble could be part of, and
+// a pair of bytes only has an error where all three agree. TOO_LARGE_1000 and OVERLONG_4 can share a bit,
+// since the first byte tells them apart.
+#define UTF8_TOO_SHORT (1 << 0)      // NOTE: 11______ followed by 0_______ or 11______
+#define UTF8_TOO_LONG (1 << 1)       // NOTE: 0_______ followed by 10______
+#define UTF8_OVERLONG_3 (1 << 2)     // NOTE: 11100000 100_____
+#define UTF8_TOO_LARGE (1 << 3)      // NOTE: 11110100 1001____, 11110100 101_____, or 11110101 and up
+#define UTF8_SURROGATE (1 << 4)      // NOTE: 11101101 101_____
+#define UTF8_OVERLONG_2 (1 << 5)     // NOTE: 1100000_ 10______
+#define UTF8_TOO_LARGE_1000 (1 << 6) // NOTE: 11110101 and up, followed by 1000____
+#define UTF8_OVERLONG_4 (1 << 6)     // NOTE: 11110000 1000____
+#define UTF8_TWO_CONTS (1 << 7)      // NOTE: 10______ 10______, unless a 3 or 4 byte lead is further back
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#define UTF8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+TARGET_AVX2
+static __m256i LookupNibbles(__m256i Nibbles, __m256i Table)
+{
+    __m256i Result = _mm256_shuffle_epi8(Table, Nibbles);
+    return Result;
+}
+
+TARGET_AVX2
+static __m256i GetPreviousBytes(__m256i Bytes, __m256i PrevBytes, int Count)
+{
+    // NOTE: Bytes shifted up by Count, with the top of PrevBytes shifted in. alignr only works within
+    // 128-bit lanes, so the lane below each lane is put next to it with a permute first.
+    __m256i Below = _mm256_permute2x128_si256(PrevBytes, Bytes, 0x21);
+    
+    __m256i Result = {};
+    switch(Count)
+    {
+        case 1: {Result = _mm256_alignr_epi8(Bytes, Below, 15);} break;
+        case 2: {Result = _mm256_alignr_epi8(Bytes, Below, 14);} break;
+        case 3: {Result = _mm256_alignr_epi8(Bytes, Below, 13);} break;
+    }
+    
+    return Result;
+}
+
+TARGET_AVX2
+static __m256i CheckUTF8Block(__m256i Bytes, __m256i PrevBytes)
+{
+    // NOTE: Returns non-zero bytes wherever Bytes (with the end of PrevBytes before it) isn't valid UTF-8
+    __m256i LowNibbleMask = _mm256_set1_epi8(0x0F);
+    
+    __m256i Prev1 = GetPreviousBytes(Bytes, PrevBytes, 1);
+    __m256i Prev1High = _mm256_and_si256(_mm256_srli_epi16(Prev1, 4), LowNibbleMask);
+    __m256i Prev1Low = _mm256_and_si256(Prev1, LowNibbleMask);
+    __m256i BytesHigh = _mm256_and_si256(_mm256_srli_epi16(Bytes, 4), LowNibbleMask);
+    
+    __m256i Byte1High = LookupNibbles(Prev1High, UTF8_TABLE(
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4));
+    
+    __m256i Byte1Low = LookupNibbles(Prev1Low, UTF8_TABLE(
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY,
+        UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000));
+    
+    __m256i Byte2High = LookupNibbles(BytesHigh, UTF8_TABLE(
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT));
+    
+    __m256i SpecialCases = _mm256_and_si256(_mm256_and_si256(Byte1High, Byte1Low), Byte2High);
+    
+    // NOTE: Two continuations in a row are fine exactly when the byte 2 or 3 back was a 3 or 4 byte lead.
+    // Subtracting with saturation leaves the top bit set only on 111_____ two back or 1111____ three back.
+    __m256i Prev2 = GetPreviousBytes(Bytes, PrevBytes, 2);
+    __m256i Prev3 = GetPreviousBytes(Bytes, PrevBytes, 3);
+    __m256i IsThirdByte = _mm256_subs_epu8(Prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i IsFourthByte = _mm256_subs_epu8(Prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i MustBeContinuation = _mm256_and_si256(_mm256_or_si256(IsThirdByte, IsFourthByte), _mm256_set1_epi8((char)0x80));
+    
+    __m256i Result = _mm256_xor_si256(MustBeContinuation, SpecialCases);
+    return Result;
+}
+
+TARGET_AVX2
+static __m256i IsIncompleteUTF8(__m256i Bytes)
+{
+    // NOTE: Non-zero if the block ends partway through a sequence, which is only an error if nothing follows
+    __m256i MaxComplete = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                           -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                           (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m256i Result = _mm256_subs_epu8(Bytes, MaxComplete);
+    return Result;
+}
+
+TARGET_AVX2
+static json_string_check CheckJSONStringAVX2(buffer String)
+{
+    __m256i Backslash = _mm256_set1_epi8('\\');
+    __m256i LastControl = _mm256_set1_epi8(0x1F);
+    
+    __m256i Errors = _mm256_setzero_si256();
+    __m256i PrevBytes = _mm256_setzero_si256();
+    __m256i PrevIncomplete = _mm256_setzero_si256();
+    u32 BackslashMask = 0;
+    
+    for(u64 At = 0; At < String.Count; At += 32)
+    {
+        __m256i Bytes;
+        if((At + 32) <= String.Count)
+        {
+            Bytes = _mm256_loadu_si256((__m256i *)(String.Data + At));
+        }
+        else
+        {
+            // NOTE: The last partial block is padded with spaces, which are ASCII and not control characters
+            u8 Padded[32];
+            u64 Remaining = String.Count - At;
+            for(u32 Index = 0; Index < 32; ++Index)
+            {
+                Padded[Index] = (Index < Remaining) ? String.Data[At + Index] : ' ';
+            }
+            Bytes = _mm256_loadu_si256((__m256i *)Padded);
+        }
+        
+        BackslashMask |= (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(Bytes, Backslash));
+        
+        // NOTE: Byte <= 0x1F exactly when the unsigned max with 0x1F is still 0x1F
+        __m256i IsControl = _mm256_cmpeq_epi8(_mm256_max_epu8(Bytes, LastControl), LastControl);
+        Errors = _mm256_or_si256(Errors, IsControl);
+        
+        if(_mm256_movemask_epi8(Bytes) == 0)
+        {
+            // NOTE: All ASCII, so the only possible error is a sequence left hanging from the block before
+            Errors = _mm256_or_si256(Errors, PrevIncomplete);
+        }
+        else
+        {
+            Errors = _mm256_or_si256(Errors, CheckUTF8Block(Bytes, PrevBytes));
+            PrevIncomplete = IsIncompleteUTF8(Bytes);
+        }
+        
+        PrevBytes = Bytes;
+    }
+    
+    Errors = _mm256_or_si256(Errors, PrevIncomplete);
+    
+    json_string_check Result = {};
+    Result.HasEscapes = (BackslashMask != 0);
+    Result.Valid = _mm256_testz_si256(Errors, Errors);
+    return Result;
+}
+
+static void FinishJSONString(json_parser *Parser, json_token *Token)
+{
+    json_string_check Check = Parser->UseAVX2 ? CheckJSONStringAVX2(Token->Value) : CheckJSONStringScalar(Token->Value);
+    Token->HasEscapes = Check.HasEscapes;
+    if(!Check.Valid)
+    {
+        Token->Type = Token_error;
+        Error(Parser, *Token, "Invalid UTF-8 or control character in string");
+    }
+}
+
+static u32 ParseHex4(buffer Source, u64 At, u32 *Value)
+{
+    // NOTE: Returns true if there are four hex digits at At
+    u32 Result = IsInBounds(Source, At + 3);
+    u32 CodePoint = 0;
+    for(u32 Index = 0; Result && (Index < 4); ++Index)
+    {
+        u8 Digit = Source.Data[At + Index];
+        if((Digit >= '0') && (Digit <= '9')) {CodePoint = 16*CodePoint + (Digit - '0');}
+        else if((Digit >= 'a') && (Digit <= 'f')) {CodePoint = 16*CodePoint + (Digit - 'a' + 10);}
+        else if((Digit >= 'A') && (Digit <= 'F')) {CodePoint = 16*CodePoint + (Digit - 'A' + 10);}
+        else {Result = false;}
+    }
+    
+    *Value = CodePoint;
+    return Result;
+}
+
+static u64 EncodeUTF8(u32 CodePoint, u8 *Dest)
+{
+    u64 Result = 0;
+    if(CodePoint < 0x80)
+    {
+        Dest[Result++] = (u8)CodePoint;
+    }
+    else if(CodePoint < 0x800)
+    {
+        Dest[Result++] = (u8)(0xC0 | (CodePoint >> 6));
+        Dest[Result++] = (u8)(0x80 | (CodePoint & 0x3F));
+    }
+    else if(CodePoint < 0x10000)
+    {
+        Dest[Result++] = (u8)(0xE0 | (CodePoint >> 12));
+        Dest[Result++] = (u8)(0x80 | ((CodePoint >> 6) & 0x3F));
+        Dest[Result++] = (u8)(0x80 | (CodePoint & 0x3F));
+    }
+    else
+    {
+        Dest[Result++] = (u8)(0xF0 | (CodePoint >> 18));
+        Dest[Result++] = (u8)(0x80 | ((CodePoint >> 12) & 0x3F));
+        Dest[Result++] = (u8)(0x80 | ((CodePoint >> 6) & 0x3F));
+        Dest[Result++] = (u8)(0x80 | (CodePoint & 0x3F));
+    }
+    
+    return Result;
+}
+
+static buffer DecodeJSONString(json_parser *Parser, json_token Token, u8 *Dest)
+{
+    // NOTE: Dest needs room for Token.Value.Count bytes. No escape decodes to more bytes than it was written with.
+    buffer Source = Token.Value;
+    buffer Result = {0, Dest};
+    
+    u64 At = 0;
+    while(!Parser->HadError && (At < Source.Count))
+    {
+        u8 Byte = Source.Data[At++];
+        if(Byte != '\\')
+        {
+            Dest[Result.Count++] = Byte;
+            continue;
+        }
+        
+        u8 Escape = IsInBounds(Source, At) ? Source.Data[At++] : 0;
+        switch(Escape)
+        {
+            case '"': {Dest[Result.Count++] = '"';} break;
+            case '\\': {Dest[Result.Count++] = '\\';} break;
+            case '/': {Dest[Result.Count++] = '/';} break;
+            case 'b': {Dest[Result.Count++] = '\b';} break;
+            case 'f': {Dest[Result.Count++] = '\f';} break;
+            case 'n': {Dest[Result.Count++] = '\n';} break;
+            case 'r': {Dest[Result.Count++] = '\r';} break;
+            case 't': {Dest[Result.Count++] = '\t';} break;
+            
+            case 'u':
+            {
+                u32 CodePoint = 0;
+                b32 Valid = ParseHex4(Source, At, &CodePoint);
+                At += 4;
+                
+                if(Valid && (CodePoint >= 0xD800) && (CodePoint <= 0xDBFF))
+                {
+                    // NOTE: A high surrogate only means something with a \u low surrogate right after it
+                    u32 Low = 0;
+                    Valid = (IsInBounds(Source, At + 1) && (Source.Data[At] == '\\') && (Source.Data[At + 1] == 'u') &&
+                             ParseHex4(Source, At + 2, &Low) && (Low >= 0xDC00) && (Low <= 0xDFFF));
+                    CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (Low - 0xDC00);
+                    At += 6;
+                }
+                else if((CodePoint >= 0xDC00) && (CodePoint <= 0xDFFF))
+                {
+                    Valid = false;
+                }
+                
+                if(Valid)
+                {
+                    Result.Count += EncodeUTF8(CodePoint, Dest + Result.Count);
+                }
+                else
+                {
+                    Error(Parser, Token, "Invalid \\u escape in string");
+                }
+            } break;
+            
+            default:
+            {
+                Error(Parser, Token, "Invalid escape in string");
+            } break;
+        }
+    }
+    
+    return Result;
+}
+
+static void ParseKeyword(buffer Source, u64 *At, buffer KeywordRemaining, json_token_type Type, json_token *Result)
+{
+    if((Source.Count - *At) >= KeywordRemaining.Count)
+    {
+        buffer Check = Source;
+        Check.Data += *At;
+        Check.Count = KeywordRemaining.Count;
+        if(AreEqual(Check, KeywordRemaining))
+        {
+            Result->Type = Type;
+            Result->Value.Count += KeywordRemaining.Count;
+            *At += KeywordRemaining.Count;
+        }
+    }
+}
+
+static void ParseNumber(buffer Source, u64 *AtResult, u8 Val, json_token *Result)
+{
+    // NOTE: Called with At just past the first character of the number, which is Val
+    u64 At = *AtResult;
+    
+    u64 Start = At - 1;
+    Result->Type = Token_number;
+    
+    // NOTE(casey): Move past a leading negative sign if one exists
+    if((Val == '-') && IsInBounds(Source, At))
+    {
+        Val = Source.Data[At++];
+    }
+    
+    // NOTE(casey): If the leading digit wasn't 0, parse any digits before the decimal point
+    if(Val != '0')
+    {
+        while(IsJSONDigit(Source, At))
+        {
+            ++At;
+        }
+    }
+    
+    // NOTE(casey): If there is a decimal point, parse any digits after the decimal point
+    if(IsInBounds(Source, At) && (Source.Data[At] == '.'))
+    {
+        ++At;
+        while(IsJSONDigit(Source, At))
+        {
+            ++At;
+        }
+    }
+    
+    // NOTE(casey): If it's in scientific notation, parse any digits after the "e"
+    if(IsInBounds(Source, At) && ((Source.Data[At] == 'e') || (Source.Data[At] == 'E')))
+    {
+        ++At;
+        
+        if(IsInBounds(Source, At) && ((Source.Data[At] == '+') || (Source.Data[At] == '-')))
+        {
+            ++At;
+        }
+        
+        while(IsJSONDigit(Source, At))
+        {
+            ++At;
+        }
+    }
+    
+    Result->Value.Count = At - Start;
+    
+    *AtResult = At;
+}
+
+static json_token GetJSONTokenByteAtATime(json_parser *Parser)
+{
+    json_token Result = {};
+    
+    buffer Source = Parser->Source;
+    u64 At = Parser->At;
+    
+    while(IsJSONWhitespace(Source, At))
+    {
+        ++At;
+    }
+    
+    if(IsInBounds(Source, At))
+    {
+        Result.Type = Token_error;
+        Result.Value.Count = 1;
+        Result.Value.Data = Source.Data + At;
+        u8 Val = Source.Data[At++];
+        switch(Val)
+        {
+            case '{': {Result.Type = Token_open_brace;} break;
+            case '[': {Result.Type = Token_open_bracket;} break;
+            case '}': {Result.Type = Token_close_brace;} break;
+            case ']': {Result.Type = Token_close_bracket;} break;
+            case ',': {Result.Type = Token_comma;} break;
+            case ':': {Result.Type = Token_colon;} break;
+            
+            case 'f':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("alse"), Token_false, &Result);
+            } break;
+            
+            case 'n':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("ull"), Token_null, &Result);
+            } break;
+            
+            case 't':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("rue"), Token_true, &Result);
+            } break;
+            
+            case '"':
+            {
+                Result.Type = Token_string_literal;
+                
+                u64 StringStart = At;
+                At = Parser->UseAVX2 ? FindJSONStringEndAVX2(Source, At) : FindJSONStringEndScalar(Source, At);
+                
+                Result.Value.Data = Source.Data + StringStart;
+                Result.Value.Count = At - StringStart;
+                if(IsInBounds(Source, At))
+                {
+                    ++At;
+                }
+                
+                FinishJSONString(Parser, &Result);
+            } break;
+            
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            {
+                ParseNumber(Source, &At, Val, &Result);
+            } break;
+            
+            default:
+            {
+            } break;
+        }
+    }
+    
+    Parser->At = At;
+    
+    return Result;
+}
+
+static json_token GetJSONTokenFromIndex(json_parser *Parser)
+{
+    json_token Result = {};
+    
+    buffer Source = Parser->Source;
+    json_structural_indexer *Index = Parser->Index;
+    u64 At = NextStructural(Index);
+    
+    if(IsInBounds(Source, At))
+    {
+        Result.Type = Token_error;
+        Result.Value.Count = 1;
+        Result.Value.Data = Source.Data + At;
+        u8 Val = Source.Data[At++];
+        switch(Val)
+        {
+            case '{': {Result.Type = Token_open_brace;} break;
+            case '[': {Result.Type = Token_open_bracket;} break;
+            case '}': {Result.Type = Token_close_brace;} break;
+            case ']': {Result.Type = Token_close_bracket;} break;
+            case ',': {Result.Type = Token_comma;} break;
+            case ':': {Result.Type = Token_colon;} break;
+            
+            case 'f':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("alse"), Token_false, &Result);
+            } break;
+            
+            case 'n':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("ull"), Token_null, &Result);
+            } break;
+            
+            case 't':
+            {
+                ParseKeyword(Source, &At, CONSTANT_STRING("rue"), Token_true, &Result);
+            } break;
+            
+            case '"':
+            {
+                // NOTE: The index has already matched up the quotes, so the next structural
+                // is the closing quote (or the end of the input, if the string never closes)
+                Result.Type = Token_string_literal;
+                
+                u64 StringStart = At;
+                u64 StringEnd = NextStructural(Index);
+                
+                Result.Value.Data = Source.Data + StringStart;
+                Result.Value.Count = StringEnd - StringStart;
+                At = IsInBounds(Source, StringEnd) ? (StringEnd + 1) : StringEnd;
+                
+                FinishJSONString(Parser, &Result);
+            } break;
+            
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            {
+                ParseNumber(Source, &At, Val, &Result);
+            } break;
+            
+            default:
+            {
+            } break;
+        }
+    }
+    
+    Parser->At = At;
+    
+    return Result;
+}
+
+static json_token GetJSONToken(json_parser *Parser)
+{
+    json_token Result = Parser->Index ? GetJSONTokenFromIndex(Parser) : GetJSONTokenByteAtATime(Parser);
+    return Result;
+}
+
+static json_element *ParseJSONList(json_parser *Parser, json_token_type EndType, b32 HasLabels);
+static json_element *ParseJSONElement(json_parser *Parser, json_token Label, json_token Value)
+{
+    b32 Valid = true;
+    
+    json_element *SubElement = 0;
+    if(Value.Type == Token_open_bracket)
+    {
+        SubElement = ParseJSONList(Parser, Token_close_bracket, false);
+    }
+    else if(Value.Type == Token_open_brace)
+    {
+        SubElement = ParseJSONList(Parser, Token_close_brace, true);
+    }
+    else if((Value.Type == Token_string_literal) ||
+            (Value.Type == Token_true) ||
+            (Value.Type == Token_false) ||
+            (Value.Type == Token_null) ||
+            (Value.Type == Token_number))
+    {
+        // NOTE(casey): Nothing to do here, since there is no additional data
+    }
+    else
+    {
+        Valid = false;
+    }
+    
+    json_element *Result = 0;
+    
+    if(Valid)
+    {
+        // NOTE: Strings with escapes are decoded into space right after the element, so freeing the element frees them too
+        u64 DecodedSize = ((Label.HasEscapes ? Label.Value.Count : 0) +
+                           (Value.HasEscapes ? Value.Value.Count : 0));
+        u64 Size = sizeof(json_element) + DecodedSize;
+        Result = Parser->Arena ? (json_element *)PushSize(Parser->Arena, Size, alignof(json_element)) : (json_element *)malloc(Size);
+        
+        u8 *Decoded = (u8 *)(Result + 1);
+        Result->Label = Label.Value;
+        if(Label.HasEscapes)
+        {
+            Result->Label = DecodeJSONString(Parser, Label, Decoded);
+            Decoded += Result->Label.Count;
+        }
+        
+        Result->Value = Value.HasEscapes ? DecodeJSONString(Parser, Value, Decoded) : Value.Value;
+        Result->FirstSubElement = SubElement;
+        Result->FieldIndex = 0;
+        Result->NextSibling = 0;
+        
+        if(Parser->HadError && (Label.HasEscapes || Value.HasEscapes))
+        {
+            // NOTE: A bad escape. It has already been reported, and the element is dropped like any other bad one.
+            if(!Parser->Arena)
+            {
+                free(Result);
+            }
+            Result = 0;
+        }
+    }
+    
+    return Result;
+}
+
+static json_element *ParseJSONList(json_parser *Parser, json_token_type EndType, b32 HasLabels)
+{
+    json_element *FirstElement = {};
+    json_element *LastElement = {};
+    
+    while(IsParsing(Parser))
+    {
+        json_token Label = {};
+        json_token Value = GetJSONToken(Parser);
+        if(HasLabels)
+        {
+            if(Value.Type == Token_string_literal)
+            {
+                Label = Value;
+                
+                json_token Colon = GetJSONToken(Parser);
+                if(Colon.Type == Token_colon)
+                {
+                    Value = GetJSONToken(Parser);
+                }
+                else
+                {
+                    Error(Parser, Colon, "Expected colon after field name");
+                }
+            }
+            else if(Value.Type != EndType)
+            {
+                Error(Parser, Value, "Unexpected token in JSON");
+            }
+        }
+        
+        json_element *Element = ParseJSONElement(Parser, Label, Value);
+        if(Element)
+        {
+            LastElement = (LastElement ? LastElement->NextSibling : FirstElement) = Element;
+        }
+        else if(Value.Type == EndType)
+        {
+            break;
+        }
+        else if(!Parser->HadError)
+        {
+            Error(Parser, Value, "Unexpected token in JSON");
+        }
+        
+        json_token Comma = GetJSONToken(Parser);
+        if(Comma.Type == EndType)
+        {
+            break;
+        }
+        else if(Comma.Type != Token_comma)
+        {
+            Error(Parser, Comma, "Unexpected token in JSON");
+        }
+    }
+    
+    return FirstElement;
+}
+
+static json_element *ParseJSON(buffer InputJSON, arena *Arena = 0, b32 ByteAtATime = false)
+{
+    TimeFunction;
+    
+    json_structural_indexer Index;
+    
+    json_parser Parser = {};
+    Parser.Source = InputJSON;
+    Parser.Arena = Arena;
+    Parser.UseAVX2 = CPUHasAVX2();
+    if(!ByteAtATime)
+    {
+        BeginStructuralIndex(&Index, InputJSON);
+        Parser.Index = &Index;
+    }
+    
+    json_element *Result = ParseJSONElement(&Parser, {}, GetJSONToken(&Parser));
+    return Result;
+}
+
+static void FreeJSON(json_element *Element)
+{
+    // NOTE: Only for trees parsed without an arena. Trees in an arena are freed by resetting it.
+    while(Element)
+    {
+        json_element *FreeElement = Element;
+        Element = Element->NextSibling;
+        
+        FreeJSON(FreeElement->FirstSubElement);
+        free(FreeElement);
+    }
+}
+
+#define JSON_FIELD_INDEX_THRESHOLD 32
+
+struct json_field_slot
+{
+    u64 Hash;
+    json_element *Element;
+};
+
+struct json_field_index
+{
+    u64 Mask;
+    json_field_slot *Slots;
+};
+
+static u64 HashJSONLabel(buffer Label)
+{
+    // NOTE: FNV-1a. Labels are short, so there's no point doing anything wider per step.
+    u64 Result = 0xcbf29ce484222325ull;
+    for(u64 Index = 0; Index < Label.Count; ++Index)
+    {
+        Result ^= Label.Data[Index];
+        Result *= 0x100000001b3ull;
+    }
+    
+    return Result;
+}
+
+static json_field_index *BuildFieldIndex(json_element *Object, arena *Arena)
+{
+    u64 ChildCount = 0;
+    for(json_element *Child = Object->FirstSubElement; Child; Child = Child->NextSibling)
+    {
+        ++ChildCount;
+    }
+    
+    // NOTE: At least twice as many slots as children keeps the probe sequences short
+    u64 SlotCount = 16;
+    while(SlotCount < 2*ChildCount)
+    {
+        SlotCount *= 2;
+    }
+    
+    json_field_index *Result = PushStruct(Arena, json_field_index);
+    json_field_slot *Slots = PushArray(Arena, SlotCount, json_field_slot);
+    if(Result && Slots)
+    {
+        memset(Slots, 0, SlotCount*sizeof(json_field_slot));
+        Result->Mask = SlotCount - 1;
+        Result->Slots = Slots;
+        
+        for(json_element *Child = Object->FirstSubElement; Child; Child = Child->NextSibling)
+        {
+            u64 Hash = HashJSONLabel(Child->Label);
+            u64 SlotIndex = Hash & Result->Mask;
+            
+            // NOTE: If a label appears more than once, the first one keeps the slot, which
+            // matches what walking the list finds
+            while(Slots[SlotIndex].Element &&
+                  !((Slots[SlotIndex].Hash == Hash) && AreEqual(Slots[SlotIndex].Element->Label, Child->Label)))
+            {
+                SlotIndex = (SlotIndex + 1) & Result->Mask;
+            }
+            
+            if(!Slots[SlotIndex].Element)
+            {
+                Slots[SlotIndex].Hash = Hash;
+                Slots[SlotIndex].Element = Child;
+            }
+        }
+    }
+    else
+    {
+        Result = 0;
+    }
+    
+    return Result;
+}
+
+static json_element *LookupElement(json_element *Object, buffer ElementName, arena *Arena = 0)
+{
+    // NOTE: Pass the arena the tree was parsed into to allow building an index for Object
+    json_element *Result = 0;
+    
+    if(Object)
+    {
+        json_field_index *Index = Object->FieldIndex;
+        if(Index)
+        {
+            u64 Hash = HashJSONLabel(ElementName);
+            for(u64 SlotIndex = Hash & Index->Mask;
+                Index->Slots[SlotIndex].Element;
+                SlotIndex = (SlotIndex + 1) & Index->Mask)
+            {
+                json_field_slot *Slot = Index->Slots + SlotIndex;
+                if((Slot->Hash == Hash) && AreEqual(Slot->Element->Label, ElementName))
+                {
+                    Result = Slot->Element;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            u64 SearchCount = 0;
+            for(json_element *Search = Object->FirstSubElement; Search; Search = Search->NextSibling)
+            {
+                if(AreEqual(Search->Label, ElementName))
+                {
+                    Result = Search;
+                    break;
+                }
+                
+                ++SearchCount;
+            }
+            
+            if(Arena && (SearchCount >= JSON_FIELD_INDEX_THRESHOLD))
+            {
+                Object->FieldIndex = BuildFieldIndex(Object, Arena);
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static f64 ConvertElementToF64(json_element *Object, buffer ElementName, arena *Arena = 0)
+{
+    f64 Result = 0.0;
+    
+    json_element *Element = LookupElement(Object, ElementName, Arena);
+    if(Element)
+    {
+        Result = ConvertJSONToF64Exact(Element->Value);
+    }
+    
+    return Result;
+}
+
+static u64 ParseHaversinePairs(buffer InputJSON, u64 MaxPairCount, haversine_pair *Pairs, arena *Arena = 0)
+{
+    // NOTE: If an arena is passed, it is used as scratch space for the tree and is reset before returning
+    TimeFunction;
+    
+    u64 PairCount = 0;
+    
+    json_element *JSON = ParseJSON(InputJSON, Arena);
+    
+    json_element *PairsArray = LookupElement(JSON, CONSTANT_STRING("pairs"));
+    if(PairsArray)
+    {
+        TimeBlock("Lookup and Convert");
+        
+        for(json_element *Element = PairsArray->FirstSubElement;
+            Element && (PairCount < MaxPairCount);
+            Element = Element->NextSibling)
+        {
+            haversine_pair *Pair = Pairs + PairCount++;
+            
+            Pair->X0 = ConvertElementToF64(Element, CONSTANT_STRING("x0"));
+            Pair->Y0 = ConvertElementToF64(Element, CONSTANT_STRING("y0"));
+            Pair->X1 = ConvertElementToF64(Element, CONSTANT_STRING("x1"));
+            Pair->Y1 = ConvertElementToF64(Element, CONSTANT_STRING("y1"));
+        }
+    }
+    
+    if(Arena)
+    {
+        TimeBlock("ResetArena");
+        ResetArena(Arena);
+    }
+    else
+    {
+        TimeBlock("FreeJSON");
+        FreeJSON(JSON);
+    }
+    
+    return PairCount;
+}
@@ -0,0 +1,338 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 158
+   ======================================================================== */
+
+/* NOTE: Checks the string handling from listing 157 three ways:
+       
+       1. Random strings are run through both the AVX2 and byte-at-a-time versions of
+          CheckJSONString and FindJSONStringEnd, which have to agree on every one. The
+          strings are built from valid sequences of every length, with random bytes
+          overwritten, so that most of them are nearly valid, which is where a mistake in
+          the tables would show up.
+       2. A few small documents with escapes in labels and values, and some that have to be
+          rejected, are parsed both with and without the structural index.
+       3. Both versions of each function are timed on a large block of mixed text. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0157_string_decoding_json_parser.cpp"
+
+static u64 RandomU64(u64 *State)
+{
+    // NOTE: SplitMix64
+    u64 Result = (*State += 0x9E3779B97F4A7C15ull);
+    Result = (Result ^ (Result >> 30))*0xBF58476D1CE4E5B9ull;
+    Result = (Result ^ (Result >> 27))*0x94D049BB133111EBull;
+    Result ^= (Result >> 31);
+    return Result;
+}
+
+static u64 WriteRandomText(u64 *Seed, u8 *Dest, u64 MaxCount, u32 QuotePercent)
+{
+    // NOTE: Valid UTF-8, mostly ASCII with a mix of 2, 3 and 4 byte characters. Never writes a quote
+    // or backslash unless QuotePercent is non-zero, and never writes a control character.
+    u64 Count = 0;
+    while((Count + 4) <= MaxCount)
+    {
+        u64 Random = RandomU64(Seed);
+        u32 Kind = (u32)(Random % 100);
+        u32 CodePoint = 0;
+        if(Kind < QuotePercent)
+        {
+            CodePoint = (Random & 0x100) ? '"' : '\\';
+        }
+        else if(Kind < 70)
+        {
+            CodePoint = 0x20 + (u32)((Random >> 8) % 0x5F);
+            if((CodePoint == '"') || (CodePoint == '\\'))
+            {
+                CodePoint = 'x';
+            }
+        }
+        else if(Kind < 85)
+        {
+            CodePoint = 0x80 + (u32)((Random >> 8) % (0x800 - 0x80));
+        }
+        else if(Kind < 95)
+        {
+            CodePoint = 0x800 + (u32)((Random >> 8) % (0x10000 - 0x800 - 0x800));
+            if(CodePoint >= 0xD800)
+            {
+                // NOTE: Skip over the surrogates
+                CodePoint += 0x800;
+            }
+        }
+        else
+        {
+            CodePoint = 0x10000 + (u32)((Random >> 8) % (0x110000 - 0x10000));
+        }
+        
+        Count += EncodeUTF8(CodePoint, Dest + Count);
+    }
+    
+    return Count;
+}
+
+static void FuzzStringFunctions(u64 StringCount)
+{
+    u64 Seed = 0x5EED;
+    u8 Text[160];
+    
+    u64 CheckMismatches = 0;
+    u64 EndMismatches = 0;
+    u64 ValidCount = 0;
+    for(u64 StringIndex = 0; StringIndex < StringCount; ++StringIndex)
+    {
+        buffer String = {WriteRandomText(&Seed, Text, 4 + RandomU64(&Seed) % (sizeof(Text) - 4), 2), Text};
+        
+        // NOTE: Sometimes cut off partway through the last character
+        u64 Cut = RandomU64(&Seed) % 4;
+        String.Count -= (Cut < String.Count) ? Cut : 0;
+        
+        // NOTE: Overwrite a few bytes with ones picked to be near UTF-8 boundaries (or anything at all)
+        static u8 const Interesting[] =
+        {
+            0x00, 0x1F, 0x20, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF,
+            0xE0, 0xE1, 0xEC, 0xED, 0xEE, 0xEF, 0xF0, 0xF1, 0xF3, 0xF4, 0xF5, 0xF8, 0xFF, '"', '\\',
+        };
+        u32 ChangeCount = (u32)(RandomU64(&Seed) % 4);
+        for(u32 Change = 0; String.Count && (Change < ChangeCount); ++Change)
+        {
+            u64 Random = RandomU64(&Seed);
+            u64 At = Random % String.Count;
+            String.Data[At] = (Random & 0x10000) ? (u8)(Random >> 24) : Interesting[(Random >> 24) % ArrayCount(Interesting)];
+        }
+        
+        json_string_check Scalar = CheckJSONStringScalar(String);
+        json_string_check AVX2 = CheckJSONStringAVX2(String);
+        // NOTE: The scalar version stops at the first error, so HasEscapes only has to agree on valid strings
+        if((Scalar.Valid != AVX2.Valid) || (Scalar.Valid && (Scalar.HasEscapes != AVX2.HasEscapes)))
+        {
+            if(CheckMismatches++ < 8)
+            {
+                printf("  CheckJSONString mismatch (scalar %d, AVX2 %d):", Scalar.Valid, AVX2.Valid);
+                for(u64 Index = 0; Index < String.Count; ++Index)
+                {
+                    printf(" %02X", String.Data[Index]);
+                }
+                printf("\n");
+            }
+        }
+        ValidCount += Scalar.Valid;
+        
+        u64 Start = String.Count ? (RandomU64(&Seed) % String.Count) : 0;
+        if(FindJSONStringEndScalar(String, Start) != FindJSONStringEndAVX2(String, Start))
+        {
+            ++EndMismatches;
+        }
+    }
+    
+    printf("Fuzzed %llu strings (%llu valid): %llu CheckJSONString mismatches, %llu FindJSONStringEnd mismatches\n",
+           StringCount, ValidCount, CheckMismatches, EndMismatches);
+}
+
+struct decode_case
+{
+    char const *JSON;
+    char const *Label;    // NOTE: Looked up in the top-level object, if the JSON is valid
+    char const *Expected; // NOTE: Its value, decoded. 0 means the JSON should be rejected.
+};
+
+static void RunDecodeCases(void)
+{
+    decode_case Cases[] =
+    {
+        {"{\"plain\": \"value\"}", "plain", "value"},
+        {"{\"tab\\there\": \"line\\nbreak\"}", "tab\there", "line\nbreak"},
+        {"{\"a\\u0062c\": \"\\\"quoted\\\" \\\\ \\/\"}", "abc", "\"quoted\" \\ /"},
+        {"{\"x\": 1, \"caf\\u00e9\": \"\\u20ac\"}", "caf\xC3\xA9", "\xE2\x82\xAC"},
+        {"{\"\\ud83d\\ude00\": \"\\uD834\\uDD1E\"}", "\xF0\x9F\x98\x80", "\xF0\x9D\x84\x9E"},
+        {"{\"raw\": \"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80\"}", "raw", "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"},
+        {"{\"ends\\\\\": \"backslash\"}", "ends\\", "backslash"},
+        {"{\"bad\": \"\\q\"}", "bad", 0},
+        {"{\"lone\": \"\\ud83d\"}", "lone", 0},
+        {"{\"low\": \"\\ude00\"}", "low", 0},
+        {"{\"short\": \"\\u12\"}", "short", 0},
+        {"{\"ctrl\": \"a\tb\"}", "ctrl", 0},
+        {"{\"overlong\": \"\xC0\xAF\"}", "overlong", 0},
+        {"{\"surrogate\": \"\xED\xA0\x80\"}", "surrogate", 0},
+        {"{\"cut\": \"\xE2\x82\"}", "cut", 0},
+        {"{\"big\": \"\xF4\x90\x80\x80\"}", "big", 0},
+    };
+    
+    u64 FailCount = 0;
+    for(u32 CaseIndex = 0; CaseIndex < ArrayCount(Cases); ++CaseIndex)
+    {
+        decode_case Case = Cases[CaseIndex];
+        for(u32 ByteAtATime = 0; ByteAtATime < 2; ++ByteAtATime)
+        {
+            arena Arena = {};
+            
+            buffer JSON = {strlen(Case.JSON), (u8 *)Case.JSON};
+            buffer Label = {strlen(Case.Label), (u8 *)Case.Label};
+            
+            // NOTE: The rejected cases print their own errors
+            json_element *Root = ParseJSON(JSON, &Arena, ByteAtATime);
+            json_element *Element = LookupElement(Root, Label);
+            
+            b32 Passed = false;
+            if(Case.Expected)
+            {
+                buffer Expected = {strlen(Case.Expected), (u8 *)Case.Expected};
+                Passed = (Element && AreEqual(Element->Value, Expected));
+            }
+            else
+            {
+                // NOTE: Errors stop the parse, so the element that had the error is never linked in
+                Passed = !Element;
+            }
+            
+            if(!Passed)
+            {
+                ++FailCount;
+                printf("  FAILED (%s): %s\n", ByteAtATime ? "byte at a time" : "indexed", Case.JSON);
+            }
+            
+            FreeArena(&Arena);
+        }
+    }
+    
+    printf("Decode cases: %u, failures: %llu\n", (u32)ArrayCount(Cases), FailCount);
+}
+
+typedef json_string_check check_json_string_func(buffer String);
+typedef u64 find_json_string_end_func(buffer Source, u64 At);
+
+static void TimeStringFunctions(u64 TextSize, u64 CPUFreq)
+{
+    buffer Text = AllocateBuffer(TextSize);
+    if(Text.Count)
+    {
+        u64 Seed = 1234;
+        Text.Count = WriteRandomText(&Seed, Text.Data, Text.Count - 1, 0);
+        
+        // NOTE: One quote at the very end, so FindJSONStringEnd has to scan everything
+        Text.Data[Text.Count++] = '"';
+        
+        check_json_string_func *CheckFuncs[] = {CheckJSONStringScalar, CheckJSONStringAVX2};
+        find_json_string_end_func *EndFuncs[] = {FindJSONStringEndScalar, FindJSONStringEndAVX2};
+        char const *Names[] = {"scalar", "AVX2"};
+        
+        printf("\nThroughput on %.2fmb of text:\n", (f64)Text.Count / (1024.0*1024.0));
+        for(u32 FuncIndex = 0; FuncIndex < ArrayCount(Names); ++FuncIndex)
+        {
+            u64 BestCheck = (u64)-1;
+            u64 BestEnd = (u64)-1;
+            b32 Valid = true;
+            u64 End = 0;
+            for(u32 Repetition = 0; Repetition < 5; ++Repetition)
+            {
+                buffer String = {Text.Count - 1, Text.Data};
+                
+                u64 StartTime = ReadCPUTimer();
+                Valid = CheckFuncs[FuncIndex](String).Valid;
+                u64 CheckTime = ReadCPUTimer() - StartTime;
+                
+                StartTime = ReadCPUTimer();
+                End = EndFuncs[FuncIndex](Text, 0);
+                u64 EndTime = ReadCPUTimer() - StartTime;
+                
+                if(BestCheck > CheckTime) BestCheck = CheckTime;
+                if(BestEnd > EndTime) BestEnd = EndTime;
+            }
+            
+            f64 Gigabyte = 1024.0*1024.0*1024.0;
+            printf("  %-6s CheckJSONString %.2fgb/s (%s), FindJSONStringEnd %.2fgb/s (%s)\n", Names[FuncIndex],
+                   (f64)Text.Count / ((f64)BestCheck / (f64)CPUFreq) / Gigabyte, Valid ? "valid" : "INVALID",
+                   (f64)Text.Count / ((f64)BestEnd / (f64)CPUFreq) / Gigabyte, (End == (Text.Count - 1)) ? "found" : "WRONG END");
+        }
+    }
+    
+    FreeBuffer(&Text);
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&BeginProfile;
+    (void)&EndAndPrintProfile;
+    (void)&FreeJSON;
+    (void)&ParseHaversinePairs;
+    (void)&TryToEnableLargePages;
+    
+    int Result = 1;
+    
+    u64 FuzzCount = (ArgCount == 2) ? strtoull(Args[1], 0, 10) : 1000000;
+    if(FuzzCount && (ArgCount <= 2))
+    {
+        if(CPUHasAVX2())
+        {
+            FuzzStringFunctions(FuzzCount);
+            RunDecodeCases();
+            TimeStringFunctions(256*1024*1024, EstimateCPUTimerFreq());
+            Result = 0;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: This CPU doesn't have AVX2, so there is nothing to compare.\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [fuzz string count]\n", Args[0]);
+    }
+    
+    return Result;
+}
@@ -0,0 +1,215 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 159
+   ======================================================================== */
+
+/* NOTE: The generator from listing 66 (part 2), writing into memory instead of files, so
+   benchmarks can make their own inputs. It's the same random series, the same cluster logic
+   and the same %.16f formatting, so for a given method, seed and pair count the JSON is
+   byte-identical to the data_*_flex.json that listing 66 writes, and ExpectedSum is the same
+   as the one at the end of its haveranswer file. If asked, the distance of every pair is kept
+   as well, like the rest of the haveranswer file. */
+
+enum generator_method
+{
+    Generate_Uniform,
+    Generate_Cluster,
+    
+    Generate_Count,
+};
+
+static char const *GeneratorMethodNames[Generate_Count] =
+{
+    "uniform",
+    "cluster",
+};
+
+struct generated_input
+{
+    buffer JSON;
+    u64 PairCount;
+    f64 ExpectedSum;
+    
+    f64 *Answers; // NOTE: One distance per pair, or 0 if they weren't asked for
+};
+
+struct random_series
+{
+    u64 A, B, C, D;
+};
+
+static u64 RotateLeft(u64 V, int Shift)
+{
+    u64 Result = ((V << Shift) | (V >> (64-Shift)));
+    return Result;
+}
+
+static u64 RandomU64(random_series *Series)
+{
+    u64 A = Series->A;
+    u64 B = Series->B;
+    u64 C = Series->C;
+    u64 D = Series->D;
+    
+    u64 E = A - RotateLeft(B, 27);
+    
+    A = (B ^ RotateLeft(C, 17));
+    B = (C + D);
+    C = (D + E);
+    D = (E + A);
+    
+    Series->A = A;
+    Series->B = B;
+    Series->C = C;
+    Series->D = D;
+    
+    return D;
+}
+
+static random_series Seed(u64 Value)
+{
+    random_series Series = {};
+    
+    // NOTE(casey): This is the seed pattern for JSF generators, as per the original post
+    Series.A = 0xf1ea5eed;
+    Series.B = Value;
+    Series.C = Value;
+    Series.D = Value;
+    
+    u32 Count = 20;
+    while(Count--)
+    {
+        RandomU64(&Series);
+    }
+    
+    return Series;
+}
+
+static f64 RandomInRange(random_series *Series, f64 Min, f64 Max)
+{
+    f64 t = (f64)RandomU64(Series) / (f64)U64Max;
+    f64 Result = (1.0 - t)*Min + t*Max;
+    
+    return Result;
+}
+
+static f64 RandomDegree(random_series *Series, f64 Center, f64 Radius, f64 MaxAllowed)
+{
+    f64 MinVal = Center - Radius;
+    if(MinVal < -MaxAllowed)
+    {
+        MinVal = -MaxAllowed;
+    }
+    
+    f64 MaxVal = Center + Radius;
+    if(MaxVal > MaxAllowed)
+    {
+        MaxVal = MaxAllowed;
+    }
+    
+    f64 Result = RandomInRange(Series, MinVal, MaxVal);
+    return Result;
+}
+
+#define MAX_JSON_PAIR_SIZE 128 // NOTE: 4 labels and separators (33 bytes) plus 4 numbers of at most 22 characters
+
+static void FreeGeneratedInput(generated_input *Input)
+{
+    FreeBuffer(&Input->JSON);
+    free(Input->Answers);
+    *Input = {};
+}
+
+static generated_input GenerateHaversineInput(generator_method Method, u64 SeedValue, u64 PairCount, b32 KeepAnswers)
+{
+    generated_input Result = {};
+    
+    // NOTE: Room for the worst case; pages past the end of what's written are never touched
+    char const Header[] = "{\"pairs\":[\n";
+    char const Footer[] = "]}\n";
+    buffer JSON = AllocateBuffer(sizeof(Header) + PairCount*MAX_JSON_PAIR_SIZE + sizeof(Footer));
+    f64 *Answers = KeepAnswers ? (f64 *)malloc(PairCount*sizeof(f64)) : 0;
+    
+    if(JSON.Count && (Answers || !KeepAnswers))
+    {
+        u64 ClusterCountLeft = U64Max;
+        f64 MaxAllowedX = 180;
+        f64 MaxAllowedY = 90;
+        
+        f64 XCenter = 0;
+        f64 YCenter = 0;
+        f64 XRadius = MaxAllowedX;
+        f64 YRadius = MaxAllowedY;
+        
+        if(Method == Generate_Cluster)
+        {
+            ClusterCountLeft = 0;
+        }
+        
+        random_series Series = Seed(SeedValue);
+        u64 ClusterCountMax = 1 + (PairCount / 64);
+        
+        char *At = (char *)JSON.Data;
+        memcpy(At, Header, sizeof(Header) - 1);
+        At += sizeof(Header) - 1;
+        
+        f64 Sum = 0;
+        f64 SumCoef = 1.0 / (f64)PairCount;
+        for(u64 PairIndex = 0; PairIndex < PairCount; ++PairIndex)
+        {
+            if(ClusterCountLeft-- == 0)
+            {
+                ClusterCountLeft = ClusterCountMax;
+                XCenter = RandomInRange(&Series, -MaxAllowedX, MaxAllowedX);
+                YCenter = RandomInRange(&Series, -MaxAllowedY, MaxAllowedY);
+                XRadius = RandomInRange(&Series, 0, MaxAllowedX);
+                YRadius = RandomInRange(&Series, 0, MaxAllowedY);
+            }
+            
+            f64 X0 = RandomDegree(&Series, XCenter, XRadius, MaxAllowedX);
+            f64 Y0 = RandomDegree(&Series, YCenter, YRadius, MaxAllowedY);
+            f64 X1 = RandomDegree(&Series, XCenter, XRadius, MaxAllowedX);
+            f64 Y1 = RandomDegree(&Series, YCenter, YRadius, MaxAllowedY);
+            
+            f64 EarthRadius = 6372.8;
+            f64 HaversineDistance = ReferenceHaversine(X0, Y0, X1, Y1, EarthRadius);
+            
+            Sum += SumCoef*HaversineDistance;
+            if(Answers)
+            {
+                Answers[PairIndex] = HaversineDistance;
+            }
+            
+            char const *JSONSep = (PairIndex == (PairCount - 1)) ? "\n" : ",\n";
+            At += sprintf(At, "    {\"x0\":%.16f, \"y0\":%.16f, \"x1\":%.16f, \"y1\":%.16f}%s", X0, Y0, X1, Y1, JSONSep);
+        }
+        
+        memcpy(At, Footer, sizeof(Footer) - 1);
+        At += sizeof(Footer) - 1;
+        
+        Result.JSON = JSON;
+        Result.JSON.Count = (At - (char *)JSON.Data);
+        Result.PairCount = PairCount;
+        Result.ExpectedSum = Sum;
+        Result.Answers = Answers;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate memory for %llu generated pairs.\n", PairCount);
+        FreeBuffer(&JSON);
+        free(Answers);
+    }
+    
+    return Result;
+}
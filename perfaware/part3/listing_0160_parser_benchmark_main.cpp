@@ -0,0 +1,598 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 160
+   ======================================================================== */
+
+/* NOTE: A standing benchmark for every haversine parser in part 3. It generates uniform and
+   cluster inputs of 1K, 10K, ... up to 100M pairs in memory with listing 159 (listing 66's
+   logic), and runs each parser on each one under the page fault repetition tester from
+   listing 109. Each result is appended to a CSV, one line per parser, method and size, so runs
+   from different commits can be lined up against each other. Pass -label (a commit hash, say)
+   to tell them apart.
+   
+   The CSV has the fastest run's time, GB/s and pairs/s, the average page faults per run, the
+   peak resident set size during that parser's runs, and how many bytes it allocated per run,
+   also per byte of input. Bytes allocated counts every malloc and realloc request and
+   every anonymous mmap (VirtualAlloc on Windows) made by the parser code, which is compiled
+   below with those calls wrapped. Arenas are fresh for every run, so they are counted each
+   time too. On Linux the peak RSS is reset through /proc/self/clear_refs before each parser;
+   Windows can't reset PeakWorkingSetSize, so there it's the peak since the program started.
+   
+   Most of the parsers reuse the same names (ParseJSON, json_element, ParseHaversinePairs...),
+   so each family gets its own namespace here. Everything they depend on (the structural
+   index, the f64 conversion, the arena) is shared. The pipelined parser from listing 142
+   reads its input from a file as it parses, so it has nothing to measure against in-memory
+   inputs and is left out.
+   
+   The inputs are big: 100M pairs is about 10.5GB of JSON, plus 3.2GB of pairs, plus whatever
+   the parser needs for its tree. -maxpairs caps the sizes on machines that can't hold that. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+#define U64Max UINT64_MAX
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0108_platform_metrics.cpp"
+#include "listing_0109_pagefault_repetition_tester.cpp"
+
+// NOTE: The profiler from listing 100 can't be included alongside listing 108, so its markup compiles out here, the same way it does with PROFILER 0
+#define TimeBandwidth(...)
+#define TimeBlock(Name) TimeBandwidth(Name, 0)
+#define TimeFunction TimeBlock(__func__)
+#define ProfilerEndOfCompilationUnit
+
+// NOTE: Every system header the parsers include has to come in here, before the namespaces
+#if _WIN32
+#include <intrin.h>
+#include <windows.h>
+#else
+#include <cpuid.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <immintrin.h>
+
+static u64 volatile GlobalAllocatedBytes;
+
+static void CountAllocatedBytes(u64 Size)
+{
+    // NOTE: The parallel parser allocates from several threads at once
+#if _WIN32
+    InterlockedExchangeAdd64((LONG64 volatile *)&GlobalAllocatedBytes, (LONG64)Size);
+#else
+    __atomic_fetch_add(&GlobalAllocatedBytes, Size, __ATOMIC_RELAXED);
+#endif
+}
+
+static void *CountedMalloc(size_t Size)
+{
+    CountAllocatedBytes(Size);
+    void *Result = malloc(Size);
+    return Result;
+}
+
+static void *CountedRealloc(void *Memory, size_t Size)
+{
+    // NOTE: The whole new size counts, since realloc is free to move the block
+    CountAllocatedBytes(Size);
+    void *Result = realloc(Memory, Size);
+    return Result;
+}
+
+#if _WIN32
+static LPVOID CountedVirtualAlloc(LPVOID Address, SIZE_T Size, DWORD AllocationType, DWORD Protect)
+{
+    if(AllocationType & MEM_COMMIT)
+    {
+        CountAllocatedBytes(Size);
+    }
+    LPVOID Result = VirtualAlloc(Address, Size, AllocationType, Protect);
+    return Result;
+}
+#define VirtualAlloc(Address, Size, AllocationType, Protect) CountedVirtualAlloc(Address, Size, AllocationType, Protect)
+#else
+static void *CountedMap(void *Address, size_t Size, int Protect, int Flags, int File, off_t Offset)
+{
+    // NOTE: Only anonymous maps are allocations; mapping a file is not
+    if(Flags & MAP_ANONYMOUS)
+    {
+        CountAllocatedBytes(Size);
+    }
+    void *Result = mmap(Address, Size, Protect, Flags, File, Offset);
+    return Result;
+}
+#define mmap(Address, Size, Protect, Flags, File, Offset) CountedMap(Address, Size, Protect, Flags, File, Offset)
+#endif
+
+#define malloc(Size) CountedMalloc(Size)
+#define realloc(Memory, Size) CountedRealloc(Memory, Size)
+
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0159_haversine_input_generator.cpp"
+
+namespace lookup_parser
+{
+#include "listing_0094_profiled_lookup_json_parser.cpp"
+#include "listing_0121_streaming_json_parser.cpp"
+}
+
+namespace arena_parser
+{
+#include "listing_0124_arena_json_parser.cpp"
+}
+
+namespace indexed_parser
+{
+#include "listing_0127_indexed_json_parser.cpp"
+}
+
+namespace exact_parser
+{
+#include "listing_0130_exact_json_parser.cpp"
+}
+
+namespace field_index_parser
+{
+#include "listing_0132_field_index_json_parser.cpp"
+#include "listing_0134_parallel_haversine_parser.cpp"
+#include "listing_0136_haversine_pair_file.cpp"
+#include "listing_0144_simd_haversine.cpp"
+#include "listing_0146_pair_columns.cpp"
+#include "listing_0155_lazy_json_tape.cpp"
+}
+
+// NOTE: Listing 157 targets plain AVX2, where listing 144 also asks for FMA
+#undef TARGET_AVX2
+namespace string_parser
+{
+#include "listing_0157_string_decoding_json_parser.cpp"
+}
+
+struct parse_parameters
+{
+    buffer InputJSON;
+    u64 PairCount;
+    haversine_pair *Pairs;
+    field_index_parser::pair_column_storage *Columns;
+    u32 ThreadCount;
+    
+    u64 ParsedPairCount;
+};
+
+typedef void parse_test_func(repetition_tester *Tester, parse_parameters *Params);
+
+static void ParseLookupTree(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        Params->ParsedPairCount = lookup_parser::ParseHaversinePairs(Params->InputJSON, Params->PairCount, Params->Pairs);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseStreaming(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        Params->ParsedPairCount = lookup_parser::ParseHaversinePairsStreaming(Params->InputJSON, Params->PairCount, Params->Pairs);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseArenaTree(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Params->ParsedPairCount = arena_parser::ParseHaversinePairs(Params->InputJSON, Params->PairCount, Params->Pairs, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseIndexedTree(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Params->ParsedPairCount = indexed_parser::ParseHaversinePairs(Params->InputJSON, Params->PairCount, Params->Pairs, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseExactTree(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Params->ParsedPairCount = exact_parser::ParseHaversinePairs(Params->InputJSON, Params->PairCount, Params->Pairs, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseFieldIndexTree(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Params->ParsedPairCount = field_index_parser::ParseHaversinePairs(Params->InputJSON, Params->PairCount, Params->Pairs, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseParallel(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        Params->ParsedPairCount = field_index_parser::ParseHaversinePairsParallel(Params->InputJSON, Params->PairCount, Params->Pairs, Params->ThreadCount);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseColumns(repetition_tester *Tester, parse_parameters *Params)
+{
+    // NOTE: The columns are allocated once per input, outside the timing, like the pairs are for everything else
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Params->ParsedPairCount = field_index_parser::ParseHaversinePairColumns(Params->InputJSON, Params->Columns, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseLazyTape(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Params->ParsedPairCount = field_index_parser::ParseHaversinePairsLazy(Params->InputJSON, Params->PairCount, Params->Pairs, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+static void ParseDecodedStrings(repetition_tester *Tester, parse_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        arena Arena = {};
+        Params->ParsedPairCount = string_parser::ParseHaversinePairs(Params->InputJSON, Params->PairCount, Params->Pairs, &Arena);
+        FreeArena(&Arena);
+        EndTime(Tester);
+        
+        CountBytes(Tester, Params->InputJSON.Count);
+    }
+}
+
+struct test_function
+{
+    char const *Name;
+    parse_test_func *Func;
+};
+test_function TestFunctions[] =
+{
+    {"lookup tree (94)", ParseLookupTree},
+    {"streaming (121)", ParseStreaming},
+    {"arena tree (124)", ParseArenaTree},
+    {"indexed tree (127)", ParseIndexedTree},
+    {"exact tree (130)", ParseExactTree},
+    {"field index tree (132)", ParseFieldIndexTree},
+    {"parallel (134)", ParseParallel},
+    {"pair columns (146)", ParseColumns},
+    {"lazy tape (155)", ParseLazyTape},
+    {"decoded strings (157)", ParseDecodedStrings},
+};
+
+#if _WIN32
+
+static void ResetPeakResidentBytes(void)
+{
+    // NOTE: There's no way to reset PeakWorkingSetSize, so on Windows it's the peak for the whole run
+}
+
+static u64 ReadPeakResidentBytes(void)
+{
+    PROCESS_MEMORY_COUNTERS Counters = {};
+    Counters.cb = sizeof(Counters);
+    GetProcessMemoryInfo(GlobalMetrics.ProcessHandle, &Counters, sizeof(Counters));
+    
+    u64 Result = Counters.PeakWorkingSetSize;
+    return Result;
+}
+
+#else
+
+static void ResetPeakResidentBytes(void)
+{
+    // NOTE: Writing 5 to clear_refs resets VmHWM to the current RSS (Linux 4.0 and up)
+    FILE *File = fopen("/proc/self/clear_refs", "w");
+    if(File)
+    {
+        fputs("5", File);
+        fclose(File);
+    }
+}
+
+static u64 ReadPeakResidentBytes(void)
+{
+    u64 Result = 0;
+    
+    FILE *File = fopen("/proc/self/status", "r");
+    if(File)
+    {
+        char Line[256];
+        while(fgets(Line, sizeof(Line), File))
+        {
+            if(strncmp(Line, "VmHWM:", 6) == 0)
+            {
+                Result = 1024*strtoull(Line + 6, 0, 10);
+                break;
+            }
+        }
+        
+        fclose(File);
+    }
+    
+    return Result;
+}
+
+#endif
+
+static FILE *OpenCSV(char *FileName)
+{
+    // NOTE: Results are appended, so runs from different commits collect in one file. The header only goes at the top.
+    FILE *Result = fopen(FileName, "ab");
+    if(Result)
+    {
+        fseek(Result, 0, SEEK_END);
+        if(ftell(Result) == 0)
+        {
+            fprintf(Result, "label,parser,method,pairs,input_bytes,runs,min_seconds,gb_per_s,pairs_per_s,"
+                    "page_faults_per_run,peak_rss_bytes,allocated_bytes_per_run,allocated_per_input_byte,valid\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&lookup_parser::ParseHaversinePairStreaming;
+    (void)&field_index_parser::GetHaversineColumnsSumFunc;
+    (void)&field_index_parser::GetBestHaversineKernel;
+    (void)&field_index_parser::GetHaversineKernelFuncs;
+    (void)&field_index_parser::HaversineKernelNames;
+    (void)&field_index_parser::MapFileReadOnly;
+    (void)&field_index_parser::UnmapFile;
+    (void)&field_index_parser::GetHaversinePairColumns;
+    (void)&TryToEnableLargePages;
+    
+    char *CSVFileName = (char *)"parser_benchmark.csv";
+    char const *Label = "";
+    u64 MinPairCount = 1000;
+    u64 MaxPairCount = 100000000;
+    u64 SeedValue = 1234567;
+    u32 SecondsToTry = 2;
+    u32 ThreadCount = 4;
+    
+    b32 ValidArgs = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        char *Arg = Args[ArgIndex];
+        b32 HasValue = ((ArgIndex + 1) < ArgCount);
+        if((strcmp(Arg, "-csv") == 0) && HasValue)
+        {
+            CSVFileName = Args[++ArgIndex];
+        }
+        else if((strcmp(Arg, "-label") == 0) && HasValue)
+        {
+            Label = Args[++ArgIndex];
+        }
+        else if((strcmp(Arg, "-minpairs") == 0) && HasValue)
+        {
+            MinPairCount = strtoull(Args[++ArgIndex], 0, 10);
+        }
+        else if((strcmp(Arg, "-maxpairs") == 0) && HasValue)
+        {
+            MaxPairCount = strtoull(Args[++ArgIndex], 0, 10);
+        }
+        else if((strcmp(Arg, "-seed") == 0) && HasValue)
+        {
+            SeedValue = strtoull(Args[++ArgIndex], 0, 10);
+        }
+        else if((strcmp(Arg, "-seconds") == 0) && HasValue)
+        {
+            SecondsToTry = (u32)strtoul(Args[++ArgIndex], 0, 10);
+        }
+        else if((strcmp(Arg, "-threads") == 0) && HasValue)
+        {
+            ThreadCount = (u32)strtoul(Args[++ArgIndex], 0, 10);
+            ValidArgs = ValidArgs && (ThreadCount >= 1) && (ThreadCount <= MAX_PARSE_THREAD_COUNT);
+        }
+        else
+        {
+            ValidArgs = false;
+        }
+    }
+    
+    ValidArgs = ValidArgs && (SecondsToTry >= 1) && (MinPairCount >= 1);
+    
+    FILE *CSV = ValidArgs ? OpenCSV(CSVFileName) : 0;
+    if(CSV)
+    {
+        InitializeOSMetrics();
+        u64 CPUTimerFreq = EstimateCPUTimerFreq();
+        
+        for(u32 Method = 0; Method < Generate_Count; ++Method)
+        {
+            for(u64 PairCount = 1000; PairCount <= MaxPairCount; PairCount *= 10)
+            {
+                if(PairCount < MinPairCount)
+                {
+                    continue;
+                }
+                
+                char const *MethodName = GeneratorMethodNames[Method];
+                printf("\n=== %s, %llu pairs ===\n", MethodName, PairCount);
+                
+                generated_input Input = GenerateHaversineInput((generator_method)Method, SeedValue, PairCount, false);
+                buffer ParsedValues = AllocateBuffer(PairCount*sizeof(haversine_pair));
+                field_index_parser::pair_column_storage Columns = field_index_parser::AllocatePairColumns(PairCount);
+                
+                if(Input.JSON.Count && ParsedValues.Count && Columns.Memory)
+                {
+                    printf("%llu bytes of JSON, expected sum %.16f\n", Input.JSON.Count, Input.ExpectedSum);
+                    
+                    parse_parameters Params = {};
+                    Params.InputJSON = Input.JSON;
+                    Params.PairCount = PairCount;
+                    Params.Pairs = (haversine_pair *)ParsedValues.Data;
+                    Params.Columns = &Columns;
+                    Params.ThreadCount = ThreadCount;
+                    
+                    for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+                    {
+                        test_function TestFunc = TestFunctions[FuncIndex];
+                        printf("\n--- %s ---\n", TestFunc.Name);
+                        
+                        repetition_tester Tester = {};
+                        Params.ParsedPairCount = 0;
+                        
+                        ResetPeakResidentBytes();
+                        u64 AllocatedBefore = GlobalAllocatedBytes;
+                        
+                        NewTestWave(&Tester, Input.JSON.Count, CPUTimerFreq, SecondsToTry);
+                        TestFunc.Func(&Tester, &Params);
+                        
+                        u64 Allocated = GlobalAllocatedBytes - AllocatedBefore;
+                        u64 PeakResidentBytes = ReadPeakResidentBytes();
+                        
+                        repetition_test_results Results = Tester.Results;
+                        u64 RunCount = Results.Total.E[RepValue_TestCount];
+                        if((Tester.Mode == TestMode_Completed) && RunCount)
+                        {
+                            f64 Seconds = SecondsFromCPUTime((f64)Results.Min.E[RepValue_CPUTimer], CPUTimerFreq);
+                            f64 Gigabyte = (1024.0f * 1024.0f * 1024.0f);
+                            f64 PageFaultsPerRun = (f64)Results.Total.E[RepValue_MemPageFaults] / (f64)RunCount;
+                            f64 AllocatedPerRun = (f64)Allocated / (f64)RunCount;
+                            b32 Valid = (Params.ParsedPairCount == PairCount);
+                            
+                            if(!Valid)
+                            {
+                                fprintf(stderr, "ERROR: %s parsed %llu pairs, expected %llu.\n", TestFunc.Name, Params.ParsedPairCount, PairCount);
+                            }
+                            
+                            fprintf(CSV, "%s,%s,%s,%llu,%llu,%llu,%.9f,%.6f,%.1f,%.1f,%llu,%.0f,%.6f,%d\n",
+                                    Label, TestFunc.Name, MethodName, PairCount, Input.JSON.Count, RunCount,
+                                    Seconds, (f64)Input.JSON.Count / (Gigabyte * Seconds), (f64)PairCount / Seconds,
+                                    PageFaultsPerRun, PeakResidentBytes, AllocatedPerRun,
+                                    AllocatedPerRun / (f64)Input.JSON.Count, Valid);
+                            fflush(CSV);
+                        }
+                    }
+                }
+                
+                field_index_parser::FreePairColumns(&Columns);
+                FreeBuffer(&ParsedValues);
+                FreeGeneratedInput(&Input);
+            }
+        }
+        
+        fclose(CSV);
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [-csv file] [-label text] [-minpairs count] [-maxpairs count]\n"
+                "          [-seed value] [-seconds count] [-threads count]\n", Args[0]);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,509 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 161
+   ======================================================================== */
+
+/* NOTE: The pair columns from listing 146 in single precision, with kernels that do 8 (AVX2)
+   or 16 (AVX-512) pairs at a time, twice as many as the f64 ones in the same registers, and
+   read half the bytes. Only the distances are f32. Each vector of distances is widened to
+   f64 before it's added to the sums, so summing a lot of pairs doesn't lose anything on top
+   of the error already in each distance.
+   
+   The parser converts each number exactly to f64 (listing 129) and then rounds that to f32.
+   Rounding twice can land one f32 ulp away from rounding the decimal directly, but only
+   when the f64 is right at the halfway point between two f32s, which with 16 decimal digits
+   of input is far below the error of storing the coordinate as an f32 in the first place.
+   
+   The math is listing 144's, with f32 constants: sin and cos reduce by the nearest multiple
+   of pi (split in two parts), then a Taylor polynomial out to x^13 or x^14. asin folds
+   [0.5, 1] onto [0, 0.5] and uses 12 Taylor terms. In f32 that's already past the point
+   where more terms change the result. Every column is padded to a multiple of 16 pairs with
+   zeros, like listing 146's, so the kernels always run whole vectors. Needs listings 123
+   (OSAllocate), 132 (the parser) and 144 (haversine_kernel, TARGET_AVX2/TARGET_AVX512). */
+
+#define PAIR_COLUMN_F32_VECTOR_COUNT 16
+
+struct haversine_pair_columns_f32
+{
+    u64 PairCount;
+    f32 *X0;
+    f32 *Y0;
+    f32 *X1;
+    f32 *Y1;
+};
+
+struct pair_column_storage_f32
+{
+    haversine_pair_columns_f32 Columns;
+    u64 Capacity;
+    
+    u8 *Memory;
+    u64 MemorySize;
+};
+
+static pair_column_storage_f32 AllocatePairColumnsF32(u64 MaxPairCount)
+{
+    // NOTE: OSAllocate hands back zeroed pages, which takes care of the padding
+    pair_column_storage_f32 Result = {};
+    
+    u64 Capacity = (MaxPairCount + PAIR_COLUMN_F32_VECTOR_COUNT - 1) & ~(u64)(PAIR_COLUMN_F32_VECTOR_COUNT - 1);
+    u64 ColumnSize = Capacity*sizeof(f32);
+    
+    Result.Memory = OSAllocate(4*ColumnSize, false);
+    if(Result.Memory)
+    {
+        Result.Capacity = Capacity;
+        Result.MemorySize = 4*ColumnSize;
+        Result.Columns.X0 = (f32 *)(Result.Memory + 0*ColumnSize);
+        Result.Columns.Y0 = (f32 *)(Result.Memory + 1*ColumnSize);
+        Result.Columns.X1 = (f32 *)(Result.Memory + 2*ColumnSize);
+        Result.Columns.Y1 = (f32 *)(Result.Memory + 3*ColumnSize);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %llu bytes.\n", 4*ColumnSize);
+    }
+    
+    return Result;
+}
+
+static void FreePairColumnsF32(pair_column_storage_f32 *Storage)
+{
+    if(Storage->Memory)
+    {
+        OSFree(Storage->Memory, Storage->MemorySize);
+    }
+    *Storage = {};
+}
+
+static u64 ParseHaversinePairColumnsF32(buffer InputJSON, pair_column_storage_f32 *Storage, arena *Arena = 0)
+{
+    // NOTE: Same as ParseHaversinePairColumns, rounding each coordinate to f32 as it goes in
+    TimeFunction;
+    
+    haversine_pair_columns_f32 *Columns = &Storage->Columns;
+    u64 MaxPairCount = Storage->Capacity;
+    u64 PairCount = 0;
+    
+    json_element *JSON = ParseJSON(InputJSON, Arena);
+    
+    json_element *PairsArray = LookupElement(JSON, CONSTANT_STRING("pairs"));
+    if(PairsArray)
+    {
+        TimeBlock("Lookup and Convert");
+        
+        for(json_element *Element = PairsArray->FirstSubElement;
+            Element && (PairCount < MaxPairCount);
+            Element = Element->NextSibling)
+        {
+            Columns->X0[PairCount] = (f32)ConvertElementToF64(Element, CONSTANT_STRING("x0"));
+            Columns->Y0[PairCount] = (f32)ConvertElementToF64(Element, CONSTANT_STRING("y0"));
+            Columns->X1[PairCount] = (f32)ConvertElementToF64(Element, CONSTANT_STRING("x1"));
+            Columns->Y1[PairCount] = (f32)ConvertElementToF64(Element, CONSTANT_STRING("y1"));
+            ++PairCount;
+        }
+    }
+    
+    Columns->PairCount = PairCount;
+    
+    if(Arena)
+    {
+        TimeBlock("ResetArena");
+        ResetArena(Arena);
+    }
+    else
+    {
+        TimeBlock("FreeJSON");
+        FreeJSON(JSON);
+    }
+    
+    return PairCount;
+}
+
+// NOTE: Distances writes whole vectors, so it needs room for PairCount rounded up to PAIR_COLUMN_F32_VECTOR_COUNT
+typedef f64 haversine_columns_f32_sum_func(haversine_pair_columns_f32 Columns, f32 EarthRadius);
+typedef void haversine_columns_f32_distances_func(haversine_pair_columns_f32 Columns, f32 EarthRadius, f32 *Distances);
+
+struct haversine_columns_f32_funcs
+{
+    haversine_columns_f32_sum_func *Sum;
+    haversine_columns_f32_distances_func *Distances;
+};
+
+static f32 const SinCoefficientsF32[] =
+{
+    1.0f, -0.16666667f, 0.0083333333f, -0.00019841270f, 2.7557319e-06f, -2.5052108e-08f, 1.6059044e-10f,
+};
+
+static f32 const CosCoefficientsF32[] =
+{
+    1.0f, -0.5f, 0.041666667f, -0.0013888889f, 2.4801587e-05f, -2.7557319e-07f, 2.0876757e-09f, -1.1470746e-11f,
+};
+
+static f32 const AsinCoefficientsF32[] =
+{
+    1.0f, 0.16666667f, 0.075f, 0.044642857f, 0.030381944f, 0.022372159f,
+    0.017352764f, 0.013964844f, 0.011551801f, 0.0097616095f, 0.0083903358f, 0.0073125259f,
+};
+
+// NOTE: Pi as the nearest f32 (which is a little above pi) plus what that leaves out
+#define HAVERSINE_PI_HIGH_F32 3.14159274101257324f
+#define HAVERSINE_PI_LOW_F32 -8.74227766e-08f
+#define HAVERSINE_INV_PI_F32 0.318309886f
+#define HAVERSINE_HALF_PI_F32 1.57079637f
+#define HAVERSINE_RADIANS_PER_DEGREE_F32 0.0174532925f
+
+// NOTE: Adding 1.5*2^23 rounds to an integer and leaves it in the low bits of the mantissa
+#define HAVERSINE_ROUNDING_MAGIC_F32 12582912.0f
+
+//
+// NOTE: Reference
+//
+
+static f32 ReferenceHaversineF32(f32 X0, f32 Y0, f32 X1, f32 Y1, f32 EarthRadius)
+{
+    // NOTE: ReferenceHaversine from listing 65, with every step in f32
+    f32 RadiansPerDegree = HAVERSINE_RADIANS_PER_DEGREE_F32;
+    
+    f32 dLat = RadiansPerDegree*(Y1 - Y0);
+    f32 dLon = RadiansPerDegree*(X1 - X0);
+    f32 Lat1 = RadiansPerDegree*Y0;
+    f32 Lat2 = RadiansPerDegree*Y1;
+    
+    f32 SinLat = sinf(dLat/2.0f);
+    f32 SinLon = sinf(dLon/2.0f);
+    f32 a = SinLat*SinLat + cosf(Lat1)*cosf(Lat2)*SinLon*SinLon;
+    f32 c = 2.0f*asinf(sqrtf(a));
+    
+    f32 Result = EarthRadius * c;
+    return Result;
+}
+
+static f64 SumHaversineReferenceColumnsF32(haversine_pair_columns_f32 Columns, f32 EarthRadius)
+{
+    TimeBandwidth(__func__, Columns.PairCount*4*sizeof(f32));
+    
+    f64 Sum = 0;
+    
+    f64 SumCoef = 1 / (f64)Columns.PairCount;
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; ++PairIndex)
+    {
+        f32 Dist = ReferenceHaversineF32(Columns.X0[PairIndex], Columns.Y0[PairIndex],
+                                         Columns.X1[PairIndex], Columns.Y1[PairIndex], EarthRadius);
+        Sum += SumCoef*(f64)Dist;
+    }
+    
+    return Sum;
+}
+
+static void HaversineDistancesReferenceColumnsF32(haversine_pair_columns_f32 Columns, f32 EarthRadius, f32 *Distances)
+{
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; ++PairIndex)
+    {
+        Distances[PairIndex] = ReferenceHaversineF32(Columns.X0[PairIndex], Columns.Y0[PairIndex],
+                                                     Columns.X1[PairIndex], Columns.Y1[PairIndex], EarthRadius);
+    }
+}
+
+//
+// NOTE: AVX2
+//
+
+TARGET_AVX2 static __m256 EvaluatePolynomialF32X8(f32 const *Coefficients, u32 Count, __m256 X)
+{
+    __m256 Result = _mm256_set1_ps(Coefficients[Count - 1]);
+    for(u32 Index = Count - 1; Index > 0; --Index)
+    {
+        Result = _mm256_fmadd_ps(Result, X, _mm256_set1_ps(Coefficients[Index - 1]));
+    }
+    
+    return Result;
+}
+
+TARGET_AVX2 static __m256 ReduceByPiF32X8(__m256 X, __m256 *Sign)
+{
+    __m256 Magic = _mm256_set1_ps(HAVERSINE_ROUNDING_MAGIC_F32);
+    __m256 Shifted = _mm256_fmadd_ps(X, _mm256_set1_ps(HAVERSINE_INV_PI_F32), Magic);
+    __m256 K = _mm256_sub_ps(Shifted, Magic);
+    
+    *Sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_castps_si256(Shifted), 31));
+    
+    __m256 Result = _mm256_fnmadd_ps(K, _mm256_set1_ps(HAVERSINE_PI_HIGH_F32), X);
+    Result = _mm256_fnmadd_ps(K, _mm256_set1_ps(HAVERSINE_PI_LOW_F32), Result);
+    return Result;
+}
+
+TARGET_AVX2 static __m256 SinF32X8(__m256 X)
+{
+    __m256 Sign;
+    __m256 R = ReduceByPiF32X8(X, &Sign);
+    __m256 Result = _mm256_mul_ps(R, EvaluatePolynomialF32X8(SinCoefficientsF32, ArrayCount(SinCoefficientsF32), _mm256_mul_ps(R, R)));
+    Result = _mm256_xor_ps(Result, Sign);
+    return Result;
+}
+
+TARGET_AVX2 static __m256 CosF32X8(__m256 X)
+{
+    __m256 Sign;
+    __m256 R = ReduceByPiF32X8(X, &Sign);
+    __m256 Result = EvaluatePolynomialF32X8(CosCoefficientsF32, ArrayCount(CosCoefficientsF32), _mm256_mul_ps(R, R));
+    Result = _mm256_xor_ps(Result, Sign);
+    return Result;
+}
+
+TARGET_AVX2 static __m256 AsinF32X8(__m256 X)
+{
+    // NOTE: X must be in [0, 1]
+    __m256 Half = _mm256_set1_ps(0.5f);
+    __m256 IsLarge = _mm256_cmp_ps(X, Half, _CMP_GT_OQ);
+    
+    __m256 Folded = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), X), Half));
+    __m256 Z = _mm256_blendv_ps(X, Folded, IsLarge);
+    
+    __m256 P = _mm256_mul_ps(Z, EvaluatePolynomialF32X8(AsinCoefficientsF32, ArrayCount(AsinCoefficientsF32), _mm256_mul_ps(Z, Z)));
+    __m256 Unfolded = _mm256_fnmadd_ps(_mm256_set1_ps(2.0f), P, _mm256_set1_ps(HAVERSINE_HALF_PI_F32));
+    
+    __m256 Result = _mm256_blendv_ps(P, Unfolded, IsLarge);
+    return Result;
+}
+
+TARGET_AVX2 static __m256 HaversineF32X8(__m256 X0, __m256 Y0, __m256 X1, __m256 Y1, __m256 EarthRadius)
+{
+    __m256 RadiansPerDegree = _mm256_set1_ps(HAVERSINE_RADIANS_PER_DEGREE_F32);
+    __m256 Half = _mm256_set1_ps(0.5f);
+    
+    __m256 dLat = _mm256_mul_ps(_mm256_sub_ps(Y1, Y0), RadiansPerDegree);
+    __m256 dLon = _mm256_mul_ps(_mm256_sub_ps(X1, X0), RadiansPerDegree);
+    __m256 Lat1 = _mm256_mul_ps(Y0, RadiansPerDegree);
+    __m256 Lat2 = _mm256_mul_ps(Y1, RadiansPerDegree);
+    
+    __m256 SinLat = SinF32X8(_mm256_mul_ps(dLat, Half));
+    __m256 SinLon = SinF32X8(_mm256_mul_ps(dLon, Half));
+    __m256 CosProduct = _mm256_mul_ps(CosF32X8(Lat1), CosF32X8(Lat2));
+    
+    __m256 A = _mm256_fmadd_ps(_mm256_mul_ps(CosProduct, SinLon), SinLon, _mm256_mul_ps(SinLat, SinLat));
+    A = _mm256_min_ps(A, _mm256_set1_ps(1.0f));
+    
+    __m256 C = _mm256_mul_ps(_mm256_set1_ps(2.0f), AsinF32X8(_mm256_sqrt_ps(A)));
+    
+    __m256 Result = _mm256_mul_ps(EarthRadius, C);
+    return Result;
+}
+
+TARGET_AVX2 static __m256 HaversineColumnsF32X8(haversine_pair_columns_f32 Columns, u64 PairIndex, __m256 EarthRadius)
+{
+    __m256 X0 = _mm256_load_ps(Columns.X0 + PairIndex);
+    __m256 Y0 = _mm256_load_ps(Columns.Y0 + PairIndex);
+    __m256 X1 = _mm256_load_ps(Columns.X1 + PairIndex);
+    __m256 Y1 = _mm256_load_ps(Columns.Y1 + PairIndex);
+    
+    __m256 Result = HaversineF32X8(X0, Y0, X1, Y1, EarthRadius);
+    return Result;
+}
+
+TARGET_AVX2 static f64 SumHaversineAVX2ColumnsF32(haversine_pair_columns_f32 Columns, f32 EarthRadius)
+{
+    TimeBandwidth(__func__, Columns.PairCount*4*sizeof(f32));
+    
+    __m256 Radius = _mm256_set1_ps(EarthRadius);
+    __m256d SumCoef = _mm256_set1_pd(1 / (f64)Columns.PairCount);
+    __m256d SumsLow = _mm256_setzero_pd();
+    __m256d SumsHigh = _mm256_setzero_pd();
+    
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; PairIndex += 8)
+    {
+        __m256 Distances = HaversineColumnsF32X8(Columns, PairIndex, Radius);
+        
+        __m256d Low = _mm256_cvtps_pd(_mm256_castps256_ps128(Distances));
+        __m256d High = _mm256_cvtps_pd(_mm256_extractf128_ps(Distances, 1));
+        SumsLow = _mm256_fmadd_pd(SumCoef, Low, SumsLow);
+        SumsHigh = _mm256_fmadd_pd(SumCoef, High, SumsHigh);
+    }
+    
+    f64 Lanes[4];
+    _mm256_storeu_pd(Lanes, _mm256_add_pd(SumsLow, SumsHigh));
+    
+    f64 Result = (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+    return Result;
+}
+
+TARGET_AVX2 static void HaversineDistancesAVX2ColumnsF32(haversine_pair_columns_f32 Columns, f32 EarthRadius, f32 *Distances)
+{
+    __m256 Radius = _mm256_set1_ps(EarthRadius);
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; PairIndex += 8)
+    {
+        _mm256_storeu_ps(Distances + PairIndex, HaversineColumnsF32X8(Columns, PairIndex, Radius));
+    }
+}
+
+//
+// NOTE: AVX-512
+//
+
+#if __GNUC__ && !__clang__
+// NOTE: Same GCC 12 avx512fintrin.h warning as in listing 144. Depending on what gets inlined
+// where, it can also come out as "maybe" uninitialized.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+TARGET_AVX512 static __m512 EvaluatePolynomialF32X16(f32 const *Coefficients, u32 Count, __m512 X)
+{
+    __m512 Result = _mm512_set1_ps(Coefficients[Count - 1]);
+    for(u32 Index = Count - 1; Index > 0; --Index)
+    {
+        Result = _mm512_fmadd_ps(Result, X, _mm512_set1_ps(Coefficients[Index - 1]));
+    }
+    
+    return Result;
+}
+
+TARGET_AVX512 static __m512 ReduceByPiF32X16(__m512 X, __m512i *Sign)
+{
+    __m512 Magic = _mm512_set1_ps(HAVERSINE_ROUNDING_MAGIC_F32);
+    __m512 Shifted = _mm512_fmadd_ps(X, _mm512_set1_ps(HAVERSINE_INV_PI_F32), Magic);
+    __m512 K = _mm512_sub_ps(Shifted, Magic);
+    
+    *Sign = _mm512_slli_epi32(_mm512_castps_si512(Shifted), 31);
+    
+    __m512 Result = _mm512_fnmadd_ps(K, _mm512_set1_ps(HAVERSINE_PI_HIGH_F32), X);
+    Result = _mm512_fnmadd_ps(K, _mm512_set1_ps(HAVERSINE_PI_LOW_F32), Result);
+    return Result;
+}
+
+TARGET_AVX512 static __m512 SinF32X16(__m512 X)
+{
+    __m512i Sign;
+    __m512 R = ReduceByPiF32X16(X, &Sign);
+    __m512 Result = _mm512_mul_ps(R, EvaluatePolynomialF32X16(SinCoefficientsF32, ArrayCount(SinCoefficientsF32), _mm512_mul_ps(R, R)));
+    Result = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(Result), Sign));
+    return Result;
+}
+
+TARGET_AVX512 static __m512 CosF32X16(__m512 X)
+{
+    __m512i Sign;
+    __m512 R = ReduceByPiF32X16(X, &Sign);
+    __m512 Result = EvaluatePolynomialF32X16(CosCoefficientsF32, ArrayCount(CosCoefficientsF32), _mm512_mul_ps(R, R));
+    Result = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(Result), Sign));
+    return Result;
+}
+
+TARGET_AVX512 static __m512 AsinF32X16(__m512 X)
+{
+    __m512 Half = _mm512_set1_ps(0.5f);
+    __mmask16 IsLarge = _mm512_cmp_ps_mask(X, Half, _CMP_GT_OQ);
+    
+    __m512 Folded = _mm512_sqrt_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(1.0f), X), Half));
+    __m512 Z = _mm512_mask_blend_ps(IsLarge, X, Folded);
+    
+    __m512 P = _mm512_mul_ps(Z, EvaluatePolynomialF32X16(AsinCoefficientsF32, ArrayCount(AsinCoefficientsF32), _mm512_mul_ps(Z, Z)));
+    __m512 Unfolded = _mm512_fnmadd_ps(_mm512_set1_ps(2.0f), P, _mm512_set1_ps(HAVERSINE_HALF_PI_F32));
+    
+    __m512 Result = _mm512_mask_blend_ps(IsLarge, P, Unfolded);
+    return Result;
+}
+
+TARGET_AVX512 static __m512 HaversineF32X16(__m512 X0, __m512 Y0, __m512 X1, __m512 Y1, __m512 EarthRadius)
+{
+    __m512 RadiansPerDegree = _mm512_set1_ps(HAVERSINE_RADIANS_PER_DEGREE_F32);
+    __m512 Half = _mm512_set1_ps(0.5f);
+    
+    __m512 dLat = _mm512_mul_ps(_mm512_sub_ps(Y1, Y0), RadiansPerDegree);
+    __m512 dLon = _mm512_mul_ps(_mm512_sub_ps(X1, X0), RadiansPerDegree);
+    __m512 Lat1 = _mm512_mul_ps(Y0, RadiansPerDegree);
+    __m512 Lat2 = _mm512_mul_ps(Y1, RadiansPerDegree);
+    
+    __m512 SinLat = SinF32X16(_mm512_mul_ps(dLat, Half));
+    __m512 SinLon = SinF32X16(_mm512_mul_ps(dLon, Half));
+    __m512 CosProduct = _mm512_mul_ps(CosF32X16(Lat1), CosF32X16(Lat2));
+    
+    __m512 A = _mm512_fmadd_ps(_mm512_mul_ps(CosProduct, SinLon), SinLon, _mm512_mul_ps(SinLat, SinLat));
+    A = _mm512_min_ps(A, _mm512_set1_ps(1.0f));
+    
+    __m512 C = _mm512_mul_ps(_mm512_set1_ps(2.0f), AsinF32X16(_mm512_sqrt_ps(A)));
+    
+    __m512 Result = _mm512_mul_ps(EarthRadius, C);
+    return Result;
+}
+
+TARGET_AVX512 static __m512 HaversineColumnsF32X16(haversine_pair_columns_f32 Columns, u64 PairIndex, __m512 EarthRadius)
+{
+    __m512 X0 = _mm512_load_ps(Columns.X0 + PairIndex);
+    __m512 Y0 = _mm512_load_ps(Columns.Y0 + PairIndex);
+    __m512 X1 = _mm512_load_ps(Columns.X1 + PairIndex);
+    __m512 Y1 = _mm512_load_ps(Columns.Y1 + PairIndex);
+    
+    __m512 Result = HaversineF32X16(X0, Y0, X1, Y1, EarthRadius);
+    return Result;
+}
+
+TARGET_AVX512 static f64 SumHaversineAVX512ColumnsF32(haversine_pair_columns_f32 Columns, f32 EarthRadius)
+{
+    TimeBandwidth(__func__, Columns.PairCount*4*sizeof(f32));
+    
+    __m512 Radius = _mm512_set1_ps(EarthRadius);
+    __m512d SumCoef = _mm512_set1_pd(1 / (f64)Columns.PairCount);
+    __m512d SumsLow = _mm512_setzero_pd();
+    __m512d SumsHigh = _mm512_setzero_pd();
+    
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; PairIndex += 16)
+    {
+        __m512 Distances = HaversineColumnsF32X16(Columns, PairIndex, Radius);
+        
+        // NOTE: Plain AVX-512F has no 256-bit extract for floats, so the high half goes through the f64 one
+        __m512d Low = _mm512_cvtps_pd(_mm512_castps512_ps256(Distances));
+        __m512d High = _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(Distances), 1)));
+        SumsLow = _mm512_fmadd_pd(SumCoef, Low, SumsLow);
+        SumsHigh = _mm512_fmadd_pd(SumCoef, High, SumsHigh);
+    }
+    
+    f64 Lanes[8];
+    _mm512_storeu_pd(Lanes, _mm512_add_pd(SumsLow, SumsHigh));
+    
+    f64 Result = (((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) +
+                  ((Lanes[4] + Lanes[5]) + (Lanes[6] + Lanes[7])));
+    return Result;
+}
+
+TARGET_AVX512 static void HaversineDistancesAVX512ColumnsF32(haversine_pair_columns_f32 Columns, f32 EarthRadius, f32 *Distances)
+{
+    __m512 Radius = _mm512_set1_ps(EarthRadius);
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; PairIndex += 16)
+    {
+        _mm512_storeu_ps(Distances + PairIndex, HaversineColumnsF32X16(Columns, PairIndex, Radius));
+    }
+}
+
+#if __GNUC__ && !__clang__
+#pragma GCC diagnostic pop
+#endif
+
+//
+// NOTE: Selection
+//
+
+static haversine_columns_f32_funcs GetHaversineColumnsF32Funcs(haversine_kernel Kernel)
+{
+    haversine_columns_f32_funcs Result = {SumHaversineReferenceColumnsF32, HaversineDistancesReferenceColumnsF32};
+    switch(Kernel)
+    {
+        case HaversineKernel_AVX2: {Result = {SumHaversineAVX2ColumnsF32, HaversineDistancesAVX2ColumnsF32};} break;
+        case HaversineKernel_AVX512: {Result = {SumHaversineAVX512ColumnsF32, HaversineDistancesAVX512ColumnsF32};} break;
+        default: {} break;
+    }
+    
+    return Result;
+}
@@ -0,0 +1,348 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 162
+   ======================================================================== */
+
+/* NOTE: What switching to the f32 pipeline from listing 161 costs in accuracy, and what it
+   buys in speed. Uniform and cluster inputs are generated in memory with listing 159, which
+   also keeps every pair's distance (what listing 66 writes to the haveranswer file). Each
+   input is parsed into f64 columns (listing 146) and f32 columns, and for each kernel this
+   reports:
+       
+       mean       - the f32 sum against the generator's f64 sum, and the f64 kernel's error
+                    on the same input for scale
+       per-pair   - max, mean and RMS of |f32 distance - answer| in km, the largest relative
+                    error over pairs at least 1km apart, and the pair where the max happened
+       inputs     - the same per-pair errors for the f64 reference formula run on the
+                    f32-rounded coordinates, which is how much of the error comes from
+                    storing the coordinates as f32 at all, before any f32 math
+       speed      - the best of several sums for both layouts, in pairs/s and GB/s of
+                    column data read
+   
+   The cluster inputs matter here because many of their pairs are close together, so the
+   same absolute error in the coordinates is a much bigger part of those distances. The
+   worst single pairs are the nearly antipodal ones in both modes: there asin's input is
+   right next to 1, and the f32 rounding of it is what's left after folding. */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+#define U64Max UINT64_MAX
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+struct haversine_pair
+{
+    f64 X0, Y0;
+    f64 X1, Y1;
+};
+
+#include "listing_0100_bandwidth_profiler.cpp"
+#include "listing_0065_haversine_formula.cpp"
+#include "listing_0068_buffer.cpp"
+#include "listing_0123_arena.cpp"
+#include "listing_0126_json_structural_index.cpp"
+#include "listing_0129_fast_f64_conversion.cpp"
+#include "listing_0132_field_index_json_parser.cpp"
+#include "listing_0136_haversine_pair_file.cpp"
+#include "listing_0144_simd_haversine.cpp"
+#include "listing_0146_pair_columns.cpp"
+#include "listing_0159_haversine_input_generator.cpp"
+#include "listing_0161_f32_pair_columns.cpp"
+
+struct pair_error_stats
+{
+    f64 MaxError;
+    u64 MaxErrorIndex;
+    f64 TotalError;
+    f64 TotalSquaredError;
+    f64 MaxRelativeError;
+};
+
+static void AccumulatePairError(pair_error_stats *Stats, u64 PairIndex, f64 Distance, f64 Answer)
+{
+    f64 Error = fabs(Distance - Answer);
+    Stats->TotalError += Error;
+    Stats->TotalSquaredError += Error*Error;
+    
+    if(Stats->MaxError < Error)
+    {
+        Stats->MaxError = Error;
+        Stats->MaxErrorIndex = PairIndex;
+    }
+    
+    // NOTE: Relative error means nothing for pairs that are practically on top of each other
+    if(Answer >= 1.0)
+    {
+        f64 RelativeError = Error / Answer;
+        if(Stats->MaxRelativeError < RelativeError)
+        {
+            Stats->MaxRelativeError = RelativeError;
+        }
+    }
+}
+
+static void PrintPairErrors(char const *Label, pair_error_stats Stats, u64 PairCount)
+{
+    fprintf(stdout, "  %s: max %.3e km (pair %llu), mean %.3e km, RMS %.3e km, max relative %.3e\n",
+            Label, Stats.MaxError, Stats.MaxErrorIndex, Stats.TotalError / (f64)PairCount,
+            sqrt(Stats.TotalSquaredError / (f64)PairCount), Stats.MaxRelativeError);
+}
+
+static pair_error_stats GetInputRoundingErrors(haversine_pair_columns_f32 Columns, f64 *Answers)
+{
+    // NOTE: The f64 formula on the rounded coordinates, so none of this is the f32 math
+    pair_error_stats Result = {};
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; ++PairIndex)
+    {
+        f64 Distance = ReferenceHaversine(Columns.X0[PairIndex], Columns.Y0[PairIndex],
+                                          Columns.X1[PairIndex], Columns.Y1[PairIndex], 6372.8);
+        AccumulatePairError(&Result, PairIndex, Distance, Answers[PairIndex]);
+    }
+    
+    return Result;
+}
+
+static pair_error_stats GetKernelErrors(haversine_columns_f32_distances_func *Distances, haversine_pair_columns_f32 Columns,
+                                        f32 *DistanceBuffer, f64 *Answers)
+{
+    Distances(Columns, 6372.8f, DistanceBuffer);
+    
+    pair_error_stats Result = {};
+    for(u64 PairIndex = 0; PairIndex < Columns.PairCount; ++PairIndex)
+    {
+        AccumulatePairError(&Result, PairIndex, (f64)DistanceBuffer[PairIndex], Answers[PairIndex]);
+    }
+    
+    return Result;
+}
+
+static f64 TimeF64Sum(haversine_columns_sum_func *Sum, haversine_pair_columns Columns, u64 *BestTime)
+{
+    u32 const RepetitionCount = 10;
+    
+    f64 Result = 0;
+    *BestTime = (u64)-1;
+    for(u32 Repetition = 0; Repetition < RepetitionCount; ++Repetition)
+    {
+        u64 StartTime = ReadCPUTimer();
+        Result = Sum(Columns, 6372.8);
+        u64 Elapsed = ReadCPUTimer() - StartTime;
+        
+        if(*BestTime > Elapsed)
+        {
+            *BestTime = Elapsed;
+        }
+    }
+    
+    return Result;
+}
+
+static f64 TimeF32Sum(haversine_columns_f32_sum_func *Sum, haversine_pair_columns_f32 Columns, u64 *BestTime)
+{
+    u32 const RepetitionCount = 10;
+    
+    f64 Result = 0;
+    *BestTime = (u64)-1;
+    for(u32 Repetition = 0; Repetition < RepetitionCount; ++Repetition)
+    {
+        u64 StartTime = ReadCPUTimer();
+        Result = Sum(Columns, 6372.8f);
+        u64 Elapsed = ReadCPUTimer() - StartTime;
+        
+        if(*BestTime > Elapsed)
+        {
+            *BestTime = Elapsed;
+        }
+    }
+    
+    return Result;
+}
+
+static void PrintSpeed(char const *Label, u64 PairCount, u64 ByteCount, u64 Time, u64 CPUFreq)
+{
+    f64 Seconds = (f64)Time / (f64)CPUFreq;
+    f64 Gigabyte = (1024.0f * 1024.0f * 1024.0f);
+    fprintf(stdout, "  %s: %.2fm pairs/s, %.3fgb/s\n", Label, (f64)PairCount / Seconds / 1000000.0, (f64)ByteCount / (Gigabyte * Seconds));
+}
+
+static b32 CompareMethod(generator_method Method, u64 SeedValue, u64 PairCount, b32 RunAllKernels, haversine_kernel FirstKernel, u64 CPUFreq)
+{
+    b32 Result = false;
+    
+    generated_input Input = GenerateHaversineInput(Method, SeedValue, PairCount, true);
+    pair_column_storage Storage = AllocatePairColumns(PairCount);
+    pair_column_storage_f32 StorageF32 = AllocatePairColumnsF32(PairCount);
+    f32 *DistanceBuffer = (f32 *)malloc(StorageF32.Capacity*sizeof(f32));
+    
+    if(Input.JSON.Count && Storage.Memory && StorageF32.Memory && DistanceBuffer)
+    {
+        arena Arena = {};
+        ParseHaversinePairColumns(Input.JSON, &Storage, &Arena);
+        ParseHaversinePairColumnsF32(Input.JSON, &StorageF32, &Arena);
+        FreeArena(&Arena);
+        
+        haversine_pair_columns Columns = Storage.Columns;
+        haversine_pair_columns_f32 ColumnsF32 = StorageF32.Columns;
+        
+        fprintf(stdout, "\n=== %s, %llu pairs (seed %llu) ===\n", GeneratorMethodNames[Method], PairCount, SeedValue);
+        fprintf(stdout, "Reference mean: %.16f\n", Input.ExpectedSum);
+        
+        if((Columns.PairCount == PairCount) && (ColumnsF32.PairCount == PairCount))
+        {
+            pair_error_stats InputErrors = GetInputRoundingErrors(ColumnsF32, Input.Answers);
+            
+            for(u32 Kernel = 0; Kernel < HaversineKernel_Count; ++Kernel)
+            {
+                if((RunAllKernels || (Kernel == FirstKernel)) && IsHaversineKernelSupported((haversine_kernel)Kernel))
+                {
+                    haversine_columns_f32_funcs Funcs = GetHaversineColumnsF32Funcs((haversine_kernel)Kernel);
+                    
+                    u64 F64Time = 0;
+                    u64 F32Time = 0;
+                    f64 Sum = TimeF64Sum(GetHaversineColumnsSumFunc((haversine_kernel)Kernel), Columns, &F64Time);
+                    f64 SumF32 = TimeF32Sum(Funcs.Sum, ColumnsF32, &F32Time);
+                    pair_error_stats KernelErrors = GetKernelErrors(Funcs.Distances, ColumnsF32, DistanceBuffer, Input.Answers);
+                    
+                    f64 MeanError = SumF32 - Input.ExpectedSum;
+                    u32 Worst = (u32)KernelErrors.MaxErrorIndex;
+                    
+                    fprintf(stdout, "\n%s:\n", HaversineKernelNames[Kernel]);
+                    fprintf(stdout, "  f32 mean: %.16f (error %.3e, relative %.3e)\n", SumF32, MeanError, fabs(MeanError) / Input.ExpectedSum);
+                    fprintf(stdout, "  f64 mean: %.16f (error %.3e)\n", Sum, Sum - Input.ExpectedSum);
+                    PrintPairErrors("f32 per-pair", KernelErrors, PairCount);
+                    PrintPairErrors("f32 inputs only", InputErrors, PairCount);
+                    fprintf(stdout, "  Worst pair: (%.7f, %.7f) (%.7f, %.7f), %.9f km, f32 gave %.9f km\n",
+                            ColumnsF32.X0[Worst], ColumnsF32.Y0[Worst], ColumnsF32.X1[Worst], ColumnsF32.Y1[Worst],
+                            Input.Answers[Worst], DistanceBuffer[Worst]);
+                    PrintSpeed("f64 columns", PairCount, PairCount*4*sizeof(f64), F64Time, CPUFreq);
+                    PrintSpeed("f32 columns", PairCount, PairCount*4*sizeof(f32), F32Time, CPUFreq);
+                }
+            }
+            
+            Result = true;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Parsed %llu (f64) and %llu (f32) pairs, expected %llu.\n",
+                    Columns.PairCount, ColumnsF32.PairCount, PairCount);
+        }
+    }
+    
+    free(DistanceBuffer);
+    FreePairColumnsF32(&StorageF32);
+    FreePairColumns(&Storage);
+    FreeGeneratedInput(&Input);
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    // NOTE(casey): Since we do not use these functions in this particular build, we reference their pointers
+    // here to prevent the compiler from complaining about "unused functions".
+    (void)&TryToEnableLargePages;
+    (void)&MapFileReadOnly;
+    (void)&UnmapFile;
+    (void)&GetHaversinePairColumns;
+    (void)&GetHaversineKernelFuncs;
+    (void)&ParseHaversinePairs;
+    (void)&BeginProfile;
+    (void)&EndAndPrintProfile;
+    
+    int Result = 1;
+    
+    haversine_kernel FirstKernel = GetBestHaversineKernel();
+    b32 RunAllKernels = false;
+    u64 PairCount = 1000000;
+    u64 SeedValue = 1234567;
+    b32 ValidArgs = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        b32 HasValue = ((ArgIndex + 1) < ArgCount);
+        if((strcmp(Args[ArgIndex], "-kernel") == 0) && HasValue)
+        {
+            char *Name = Args[++ArgIndex];
+            RunAllKernels = (strcmp(Name, "all") == 0);
+            FirstKernel = RunAllKernels ? HaversineKernel_Reference : HaversineKernel_Count;
+            for(u32 Kernel = 0; Kernel < HaversineKernel_Count; ++Kernel)
+            {
+                if(strcmp(Name, HaversineKernelNames[Kernel]) == 0)
+                {
+                    FirstKernel = (haversine_kernel)Kernel;
+                }
+            }
+            
+            ValidArgs = ValidArgs && (FirstKernel != HaversineKernel_Count) && IsHaversineKernelSupported(FirstKernel);
+        }
+        else if((strcmp(Args[ArgIndex], "-pairs") == 0) && HasValue)
+        {
+            PairCount = strtoull(Args[++ArgIndex], 0, 10);
+            ValidArgs = ValidArgs && (PairCount >= 1);
+        }
+        else if((strcmp(Args[ArgIndex], "-seed") == 0) && HasValue)
+        {
+            SeedValue = strtoull(Args[++ArgIndex], 0, 10);
+        }
+        else
+        {
+            ValidArgs = false;
+        }
+    }
+    
+    if(ValidArgs)
+    {
+        u64 CPUFreq = EstimateCPUTimerFreq();
+        
+        b32 AllParsed = true;
+        for(u32 Method = 0; Method < Generate_Count; ++Method)
+        {
+            AllParsed = CompareMethod((generator_method)Method, SeedValue, PairCount, RunAllKernels, FirstKernel, CPUFreq) && AllParsed;
+        }
+        
+        fprintf(stdout, "\n");
+        Result = AllParsed ? 0 : 1;
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [-pairs count] [-seed value] [-kernel reference/avx2/avx512/all]\n", Args[0]);
+    }
+    
+    return Result;
+}
@@ -10,8 +10,8 @@ call clang -O3 -g -fuse-ld=lld ..\sim86.cpp -o sim86_clang_release.exe
 call clang -P -E ..\sim86_lib.h | call clang-format --style="Microsoft" > ..\shared\sim86_shared.h
 call clang -P -E ..\sim86_instruction_table_standalone.h | call clang-format --style="Microsoft" > sim86_instruction_table_standalone.h
 
-call cl -nologo -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_debug.dll /link /DLL /PDBALTPATH:sim86_shared_debug.pdb /export:Sim86_Decode8086Instruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion
-call cl -nologo -O2 -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_release.dll /link /DLL /PDBALTPATH:sim86_shared_release.pdb /export:Sim86_Decode8086Instruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion
+call cl -nologo -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_debug.dll /link /DLL /PDBALTPATH:sim86_shared_debug.pdb /export:Sim86_Decode8086Instruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion /export:Sim86_GetMachineFootprint /export:Sim86_CreateMachine /export:Sim86_LoadProgram /export:Sim86_ReadMemory /export:Sim86_WriteMemory /export:Sim86_GetRegister /export:Sim86_SetRegister /export:Sim86_Run /export:Sim86_RunLockstep /export:Sim86_GetEstimatedClocks
+call cl -nologo -O2 -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_release.dll /link /DLL /PDBALTPATH:sim86_shared_release.pdb /export:Sim86_Decode8086Instruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion /export:Sim86_GetMachineFootprint /export:Sim86_CreateMachine /export:Sim86_LoadProgram /export:Sim86_ReadMemory /export:Sim86_WriteMemory /export:Sim86_GetRegister /export:Sim86_SetRegister /export:Sim86_Run /export:Sim86_RunLockstep /export:Sim86_GetEstimatedClocks
 
 call copy sim86_shared*.dll ..\shared
 call copy sim86_shared*.lib ..\shared
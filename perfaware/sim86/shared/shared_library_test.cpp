@@ -11,6 +11,7 @@
    ======================================================================== */
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "sim86_shared.h"
 #pragma comment (lib, "sim86_shared_debug.lib")
@@ -35,6 +36,15 @@ unsigned char ExampleDisassembly[247] =
     0xDE, 0xE1, 0xDC, 0xE0, 0xDA, 0xE3, 0xD8
 };
 
+unsigned char ExampleExecution[] =
+{
+    0xB9, 0xC8, 0x00,       // mov cx, 200
+    0x89, 0xCB,             // mov bx, cx
+    0x81, 0xC1, 0xE8, 0x03, // add cx, 1000
+    0xBB, 0xD0, 0x07,       // mov bx, 2000
+    0x29, 0xD9,             // sub cx, bx
+};
+
 int main(void)
 {
     u32 Version = Sim86_GetVersion();
@@ -66,5 +76,25 @@ int main(void)
         }
     }
     
+    u32 FootprintSize = Sim86_GetMachineFootprint();
+    void *Footprint = malloc(FootprintSize);
+    sim86_machine *Machine = Sim86_CreateMachine(FootprintSize, Footprint);
+    if(Machine)
+    {
+        Sim86_LoadProgram(Machine, 0, sizeof(ExampleExecution), ExampleExecution);
+        
+        sim86_run_result Run;
+        Sim86_Run(Machine, 1000, &Run);
+        
+        u32 MinClocks, MaxClocks;
+        Sim86_GetEstimatedClocks(Machine, &MinClocks, &MaxClocks);
+        
+        // NOTE: Register indices match register_access::Index, so 2 is bx and 3 is cx
+        printf("Executed %u instructions (stop reason %u): bx:%u cx:%u clocks:[%u,%u]\n",
+               Run.InstructionCount, Run.StopReason, Sim86_GetRegister(Machine, 2), Sim86_GetRegister(Machine, 3),
+               MinClocks, MaxClocks);
+    }
+    free(Footprint);
+    
     return 0;
 }
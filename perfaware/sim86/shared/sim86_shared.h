@@ -10,7 +10,7 @@ typedef long long s64;
 
 typedef s32 b32;
 
-static u32 const SIM86_VERSION = 4;
+static u32 const SIM86_VERSION = 5;
 typedef u32 register_index;
 
 typedef struct register_access register_access;
@@ -271,6 +271,27 @@ struct instruction_table
     u32 EncodingCount;
     u32 MaxInstructionByteCount;
 };
+typedef struct sim86_machine sim86_machine;
+
+typedef enum sim86_stop_reason : u32
+{
+    Sim86Stop_None,
+
+    Sim86Stop_InstructionLimit,
+    Sim86Stop_Ret,
+    Sim86Stop_Hlt,
+    Sim86Stop_EndOfProgram,
+    Sim86Stop_Unimplemented,
+    Sim86Stop_UnrecognizedInstruction,
+} sim86_stop_reason;
+
+typedef struct sim86_run_result sim86_run_result;
+struct sim86_run_result
+{
+    u32 InstructionCount;
+    sim86_stop_reason StopReason;
+    u32 StopAddress;
+};
 #ifdef __cplusplus
 extern "C"
 {
@@ -280,6 +301,18 @@ extern "C"
     char const *Sim86_RegisterNameFromOperand(register_access *RegAccess);
     char const *Sim86_MnemonicFromOperationType(operation_type Type);
     void Sim86_Get8086InstructionTable(instruction_table *Dest);
+
+    u32 Sim86_GetMachineFootprint(void);
+    sim86_machine *Sim86_CreateMachine(u32 FootprintSize, void *Footprint);
+    u32 Sim86_LoadProgram(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Source);
+    u32 Sim86_ReadMemory(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Dest);
+    u32 Sim86_WriteMemory(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Source);
+    u16 Sim86_GetRegister(sim86_machine *Machine, register_index Register);
+    void Sim86_SetRegister(sim86_machine *Machine, register_index Register, u16 Value);
+    void Sim86_Run(sim86_machine *Machine, u32 MaxInstructionCount, sim86_run_result *Result);
+    void Sim86_RunLockstep(u32 MachineCount, sim86_machine **Machines, u32 MaxInstructionCount,
+                           sim86_run_result *Results);
+    void Sim86_GetEstimatedClocks(sim86_machine *Machine, u32 *MinClocks, u32 *MaxClocks);
 #ifdef __cplusplus
 }
 #endif
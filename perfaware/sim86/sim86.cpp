@@ -27,9 +27,12 @@
 #include <string.h>
 #include <assert.h>
 
+#include "sim86_profiler.h"
+
 #include "sim86_instruction.h"
 #include "sim86_instruction_table.h"
 #include "sim86_memory.h"
+#include "sim86_memory_observer.h"
 #include "sim86_decode.h"
 #include "sim86_execute.h"
 #include "sim86_cycles.h"
@@ -38,6 +41,7 @@
 #include "sim86_instruction.cpp"
 #include "sim86_instruction_table.cpp"
 #include "sim86_memory.cpp"
+#include "sim86_memory_observer.cpp"
 #include "sim86_decode.cpp"
 #include "sim86_execute.cpp"
 #include "sim86_cycles.cpp"
@@ -51,10 +55,13 @@ enum sim_flags
     SimFlag_DumpMemory = 0x4,
     SimFlag_ExplainClocks = 0x8,
     SimFlag_NoRegisterDiffs = 0x10,
+    SimFlag_ObserveMemory = 0x20,
 };
 
 static u32 LoadMemoryFromFile(char *FileName, segmented_access SegMem, u32 AtOffset)
 {
+    TimeFunction;
+    
     u32 Result = 0;
     
     // NOTE(casey): Because we are simulating a machine, we only attempt to load as
@@ -67,7 +74,19 @@ static u32 LoadMemoryFromFile(char *FileName, segmented_access SegMem, u32 AtOff
     FILE *File = fopen(FileName, "rb");
     if(File)
     {
+#if PROFILER
+        // NOTE: The file size is only queried so the profiler can report the read bandwidth
+        fseek(File, 0, SEEK_END);
+        long FileSize = ftell(File);
+        fseek(File, 0, SEEK_SET);
+        
+        u32 ReadSize = ((FileSize > 0) && ((u32)FileSize < MaxBytes)) ? (u32)FileSize : MaxBytes;
+        
+        TimeBandwidth("fread", ReadSize);
+        Result = fread(SegMem.Memory + BaseAddress, 1, ReadSize, File);
+#else
         Result = fread(SegMem.Memory + BaseAddress, 1, MaxBytes, File);
+#endif
         fclose(File);
     }
     else
@@ -93,11 +112,34 @@ static segmented_access AllocateMemoryPow2(u32 SizePow2)
     return Result;
 }
 
+static memory_observer *AllocateMemoryObserver(u32 AddressSpaceSizePow2, memory_observer_config Config)
+{
+    memory_observer *Result = 0;
+    
+    u32 FootprintSize = GetMemoryObserverFootprint(AddressSpaceSizePow2, Config);
+    if(FootprintSize)
+    {
+        void *Footprint = malloc(FootprintSize);
+        if(Footprint)
+        {
+            Result = PlaceMemoryObserver(AddressSpaceSizePow2, Config, FootprintSize, Footprint);
+        }
+    }
+    
+    return Result;
+}
+
 static void PrintEstimatedClocks(timing_state State, instruction Instruction, u32 SimFlags,
-                                 instruction_clock_interval *Accum)
+                                 instruction_clock_interval *Accum, hardware_clock_loss *Loss)
 {
     instruction_timing Timing = EstimateInstructionClocks(State, Instruction);
-    instruction_clock_interval Clocks = ExpectedClocksFrom(State, Instruction, Timing);
+    instruction_clock_interval CPUClocks = ExpectedClocksFrom(State, Instruction, Timing);
+    
+    hardware_clock_loss PrevLoss = *Loss;
+    instruction_clock_interval Clocks = AddHardwareClockLoss(State, Instruction, Timing, CPUClocks, *Accum, Loss);
+    u32 WaitClocks = Loss->WaitStates.Min - PrevLoss.WaitStates.Min;
+    u32 RefreshClocks = Loss->Refresh.Min - PrevLoss.Refresh.Min;
+    
     Accum->Min += Clocks.Min;
     Accum->Max += Clocks.Max;
     
@@ -112,7 +154,15 @@ static void PrintEstimatedClocks(timing_state State, instruction Instruction, u3
     
     if(SimFlags & SimFlag_ExplainClocks)
     {
-        ExplainTiming(Timing, Clocks, stdout);
+        ExplainTiming(Timing, CPUClocks, stdout);
+        if(WaitClocks)
+        {
+            fprintf(stdout, " + %uws", WaitClocks);
+        }
+        if(RefreshClocks)
+        {
+            fprintf(stdout, " + %urefresh", RefreshClocks);
+        }
     }
 }
 
@@ -126,6 +176,10 @@ static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 Si
     // and that is what we would normally be timing.
     Timing.AssumeBranchTaken = true;
     instruction_clock_interval TimeAccum = {};
+    hardware_clock_loss Loss = {};
+    
+    // NOTE: Without executing, there are no memory addresses to look up wait states for
+    Timing.WaitStateRegionCount = 0;
     
     u32 Count = DisAsmByteCount;
     while(Count)
@@ -148,7 +202,7 @@ static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 Si
             if(SimFlags & SimFlag_ShowClocks)
             {
                 printf(" ; ");
-                PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum);
+                PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum, &Loss);
             }
             printf("\n");
         }
@@ -172,6 +226,7 @@ static void Run8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFla
     instruction_table Table = Get8086InstructionTable();
     register_state_8086 Registers = {};
     instruction_clock_interval TimeAccum = {};
+    hardware_clock_loss Loss = {};
     
     for(;;)
     {
@@ -204,7 +259,7 @@ static void Run8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFla
                     if(SimFlags & SimFlag_ShowClocks)
                     {
                         UpdateTimingForExec(&Timing, Exec);
-                        PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum);
+                        PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum, &Loss);
                         fprintf(stdout, " | ");
                     }
                     if(!(SimFlags & SimFlag_NoRegisterDiffs))
@@ -235,16 +290,32 @@ static void Run8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFla
     printf("Final registers:\n");
     PrintRegisters(&Registers, stdout);
     printf("\n");
+    
+    if((SimFlags & SimFlag_ShowClocks) && (Timing.RefreshInterval || Timing.WaitStateRegionCount))
+    {
+        PrintHardwareClockLoss(Loss, stdout);
+        printf("\n");
+    }
 }
 
 int main(int ArgCount, char **Args)
 {
+#if PROFILER
+    BeginProfile();
+#endif
+    
     b32 Execute = false;
+    b32 ProfileHost = false;
     u32 DumpIndex = 0;
     u32 SimFlags = 0;
     
     timing_state Timing = {};
     
+    u32 ObserveIndex = 0;
+    memory_observer *Observer = 0;
+    memory_observer_config ObserverConfig = {};
+    ObserverConfig.LineSize = 64;
+    
     u32 MainMemPow2 = 20;
     u32 MainMemSize = (1 << MainMemPow2);
     segmented_access MainMemory = AllocateMemoryPow2(MainMemPow2);
@@ -284,6 +355,40 @@ int main(int ArgCount, char **Args)
                 {
                     SimFlags |= SimFlag_StopOnRet;
                 }
+                else if((strcmp(FileName, "-refresh") == 0) && ((ArgIndex + 2) < ArgCount))
+                {
+                    Timing.RefreshInterval = strtoul(Args[++ArgIndex], 0, 0);
+                    Timing.RefreshCost = strtoul(Args[++ArgIndex], 0, 0);
+                }
+                else if((strcmp(FileName, "-waitstates") == 0) && ((ArgIndex + 3) < ArgCount))
+                {
+                    u32 StartAddress = strtoul(Args[++ArgIndex], 0, 0);
+                    u32 OnePastLastAddress = strtoul(Args[++ArgIndex], 0, 0);
+                    u32 WaitStates = strtoul(Args[++ArgIndex], 0, 0);
+                    if(!AddWaitStateRegion(&Timing, StartAddress, OnePastLastAddress, WaitStates))
+                    {
+                        fprintf(stderr, "ERROR: Unable to add wait state region (at most %u, and start must be below end).\n",
+                                (u32)MAX_WAIT_STATE_REGIONS);
+                    }
+                }
+                else if(strcmp(FileName, "-profilehost") == 0)
+                {
+                    ProfileHost = true;
+                }
+                else if(strcmp(FileName, "-observe") == 0)
+                {
+                    SimFlags |= SimFlag_ObserveMemory;
+                }
+                else if((strcmp(FileName, "-linesize") == 0) && ((ArgIndex + 1) < ArgCount))
+                {
+                    ObserverConfig.LineSize = atoi(Args[++ArgIndex]);
+                }
+                else if((strcmp(FileName, "-cache") == 0) && ((ArgIndex + 2) < ArgCount))
+                {
+                    SimFlags |= SimFlag_ObserveMemory;
+                    ObserverConfig.CacheSize = atoi(Args[++ArgIndex]);
+                    ObserverConfig.CacheWayCount = atoi(Args[++ArgIndex]);
+                }
                 else
                 {
                     if(SimFlags & SimFlag_ShowClocks)
@@ -296,11 +401,43 @@ int main(int ArgCount, char **Args)
                                 "\n");
                     }
                     
+                    if((SimFlags & SimFlag_ObserveMemory) && !Observer)
+                    {
+                        Observer = AllocateMemoryObserver(MainMemPow2, ObserverConfig);
+                        if(!Observer)
+                        {
+                            fprintf(stderr, "ERROR: Invalid memory observer configuration (line size, cache size and ways must be powers of two).\n");
+                            SimFlags &= ~SimFlag_ObserveMemory;
+                        }
+                    }
+                    
                     u32 BytesRead = LoadMemoryFromFile(FileName, MainMemory, 0);
                     if(Execute)
                     {
                         printf("--- %s execution ---\n", FileName);
-                        Run8086(BytesRead, MainMemory, SimFlags, Timing);
+                        
+                        segmented_access RunMemory = MainMemory;
+                        RunMemory.Observer = (SimFlags & SimFlag_ObserveMemory) ? Observer : 0;
+                        Run8086(BytesRead, RunMemory, SimFlags, Timing);
+                        
+                        if(RunMemory.Observer)
+                        {
+                            PrintMemoryObserverReport(Observer, stdout);
+                            
+                            char HeatmapFileName[256];
+                            sprintf(HeatmapFileName, "sim86_heatmap_%u.csv", ObserveIndex);
+                            FILE *HeatmapFile = fopen(HeatmapFileName, "wb");
+                            if(HeatmapFile)
+                            {
+                                WriteMemoryHeatmap(Observer, HeatmapFile);
+                                fclose(HeatmapFile);
+                                printf("Heatmap written to %s\n", HeatmapFileName);
+                            }
+                            printf("\n");
+                            
+                            ResetMemoryObserver(Observer);
+                            ++ObserveIndex;
+                        }
                     }
                     else
                     {
@@ -335,5 +472,16 @@ int main(int ArgCount, char **Args)
         fprintf(stderr, "ERROR: Unable to allow main memory for 8086.\n");
     }
     
+    if(ProfileHost)
+    {
+#if PROFILER
+        EndAndPrintProfile();
+#else
+        fprintf(stderr, "WARNING: -profilehost requires sim86 to be compiled with PROFILER=1.\n");
+#endif
+    }
+    
     return 0;
 }
+
+ProfilerEndOfCompilationUnit;
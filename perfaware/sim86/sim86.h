@@ -22,6 +22,12 @@ typedef long long s64;
 
 typedef s32 b32;
 
+#if PROFILER
+// NOTE: Only the host profiler uses floating point, so these stay out of the shared library's header
+typedef float f32;
+typedef double f64;
+#endif
+
 #define ArrayCount(Array) (sizeof(Array) / sizeof((Array)[0]))
 
-static u32 const SIM86_VERSION = 4;
+static u32 const SIM86_VERSION = 5;
@@ -77,6 +77,8 @@ static u32 CalculateEAClocksFrom(instruction Instruction, u32 OperandIndex)
     
 static instruction_timing EstimateInstructionClocks(timing_state State, instruction Instruction)
 {
+    TimeFunction;
+    
     /* TODO(casey): This routine is designed to return the results of the cycles table in the 8086 users manual.
        Based on some of the entries in the table, it is HIGHLY LIKELY that some of the entries are typos.
        Please do not use this as an actual reference for the behavior of an 8086. Without a more accurate
@@ -486,6 +488,7 @@ static void UpdateTimingForExec(timing_state *State, exec_result Exec)
     State->AssumeAddressUnanaligned = Exec.AddressIsUnaligned;
     State->AssumeRepCount = Exec.RepCount;
     State->AssumeShiftCount = Exec.ShiftCount;
+    State->AssumeMemoryAddress = Exec.MemoryAddress;
 }
 
 static instruction_clock_interval ExpectedClocksFrom(timing_state State, instruction Instruction, instruction_timing Timing)
@@ -503,3 +506,83 @@ static instruction_clock_interval ExpectedClocksFrom(timing_state State, instruc
     
     return Result;
 }
+
+#if !SIM86_LIBRARY
+static b32 AddWaitStateRegion(timing_state *State, u32 StartAddress, u32 OnePastLastAddress, u32 WaitStates)
+{
+    b32 Result = false;
+    
+    if((State->WaitStateRegionCount < ArrayCount(State->WaitStateRegions)) && (StartAddress < OnePastLastAddress))
+    {
+        wait_state_region *Region = State->WaitStateRegions + State->WaitStateRegionCount++;
+        Region->StartAddress = StartAddress;
+        Region->OnePastLastAddress = OnePastLastAddress;
+        Region->WaitStates = WaitStates;
+        
+        Result = true;
+    }
+    
+    return Result;
+}
+
+static u32 GetWaitStatesAt(timing_state State, u32 Address)
+{
+    u32 Result = 0;
+    
+    // NOTE: Regions are checked in the order they were added, so earlier ones take priority where they overlap
+    for(u32 RegionIndex = 0; RegionIndex < State.WaitStateRegionCount; ++RegionIndex)
+    {
+        wait_state_region Region = State.WaitStateRegions[RegionIndex];
+        if((Address >= Region.StartAddress) && (Address < Region.OnePastLastAddress))
+        {
+            Result = Region.WaitStates;
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+static u32 GetRefreshClocksBetween(timing_state State, u32 StartClock, u32 EndClock)
+{
+    // NOTE: Refresh is modeled as happening at every multiple of the interval, charging its
+    // full cost to whichever instruction is running at the time.
+    u32 Result = 0;
+    if(State.RefreshInterval)
+    {
+        Result = ((EndClock / State.RefreshInterval) - (StartClock / State.RefreshInterval))*State.RefreshCost;
+    }
+    
+    return Result;
+}
+
+static instruction_clock_interval AddHardwareClockLoss(timing_state State, instruction Instruction, instruction_timing Timing,
+                                                       instruction_clock_interval Clocks, instruction_clock_interval ElapsedBefore,
+                                                       hardware_clock_loss *Loss)
+{
+    u32 BusCycles = Timing.Transfers;
+    if((Instruction.Flags & Inst_Wide) && (State.Assume8088 || State.AssumeAddressUnanaligned))
+    {
+        // NOTE: Same as the 4-clock penalty in ExpectedClocksFrom: each word transfer takes two bus cycles
+        BusCycles *= 2;
+    }
+    
+    u32 WaitClocks = BusCycles*GetWaitStatesAt(State, State.AssumeMemoryAddress);
+    Loss->WaitStates.Min += WaitClocks;
+    Loss->WaitStates.Max += WaitClocks;
+    
+    instruction_clock_interval Result = Clocks;
+    Result.Min += WaitClocks;
+    Result.Max += WaitClocks;
+    
+    u32 RefreshMin = GetRefreshClocksBetween(State, ElapsedBefore.Min, ElapsedBefore.Min + Result.Min);
+    u32 RefreshMax = GetRefreshClocksBetween(State, ElapsedBefore.Max, ElapsedBefore.Max + Result.Max);
+    Loss->Refresh.Min += RefreshMin;
+    Loss->Refresh.Max += RefreshMax;
+    
+    Result.Min += RefreshMin;
+    Result.Max += RefreshMax;
+    
+    return Result;
+}
+#endif
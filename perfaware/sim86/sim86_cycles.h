@@ -23,6 +23,15 @@ struct instruction_timing
     u32 EAClocks;
 };
 
+struct wait_state_region
+{
+    u32 StartAddress;
+    u32 OnePastLastAddress;
+    u32 WaitStates; // NOTE: Extra clocks added to every bus transfer into this region
+};
+
+#define MAX_WAIT_STATE_REGIONS 8
+
 struct timing_state
 {
     b32 Assume8088;
@@ -30,8 +39,29 @@ struct timing_state
     b32 AssumeAddressUnanaligned;
     u32 AssumeRepCount;
     u32 AssumeShiftCount;
+    u32 AssumeMemoryAddress;
+    
+    // NOTE: Hardware outside the CPU that steals clocks from it. On the PC/XT, DMA channel 0
+    // refreshes DRAM every 72 clocks and holds the bus for about 4, and some cards (video memory
+    // in particular) add wait states to every transfer. Both are off when zero.
+    u32 RefreshInterval;
+    u32 RefreshCost;
+    u32 WaitStateRegionCount;
+    wait_state_region WaitStateRegions[MAX_WAIT_STATE_REGIONS];
+};
+
+struct hardware_clock_loss
+{
+    instruction_clock_interval Refresh;
+    instruction_clock_interval WaitStates;
 };
 
 static instruction_timing EstimateInstructionClocks(timing_state State, instruction Instruction);
 static void UpdateTimingForExec(timing_state *State, exec_result Exec);
 static instruction_clock_interval ExpectedClocksFrom(timing_state State, instruction Instruction, instruction_timing Timing);
+#if !SIM86_LIBRARY
+static b32 AddWaitStateRegion(timing_state *State, u32 StartAddress, u32 OnePastLastAddress, u32 WaitStates);
+static instruction_clock_interval AddHardwareClockLoss(timing_state State, instruction Instruction, instruction_timing Timing,
+                                                       instruction_clock_interval Clocks, instruction_clock_interval ElapsedBefore,
+                                                       hardware_clock_loss *Loss);
+#endif
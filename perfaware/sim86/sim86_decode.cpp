@@ -244,6 +244,8 @@ static instruction TryDecode(decode_context *Context, instruction_encoding *Inst
 
 static instruction DecodeInstruction(instruction_table Table, segmented_access At)
 {
+    TimeFunction;
+    
     /* TODO(casey): Hmm. It seems like this is a very inefficient way to parse
        instructions, isn't it? For every instruction, we check every entry in the
        table until we find a match. Is this bad design? Or did the person who wrote
@@ -56,11 +56,21 @@ static u16 GetRegisterValueU16(register_state_8086 *Registers, u32 Index)
 
 static void WriteU8(segmented_access Memory, u16 Offset, u8 Value)
 {
+    if(Memory.Observer)
+    {
+        ObserveMemoryAccess(Memory.Observer, GetAbsoluteAddressOf(Memory, Offset), true);
+    }
+    
     *AccessMemory(Memory, Offset) = Value;
 }
 
 static u8 ReadU8(segmented_access Memory, u16 Offset)
 {
+    if(Memory.Observer)
+    {
+        ObserveMemoryAccess(Memory.Observer, GetAbsoluteAddressOf(Memory, Offset), false);
+    }
+    
     u8 Result = *AccessMemory(Memory, Offset);
     return Result;
 }
@@ -244,6 +254,37 @@ static segmented_access DetermineSegmentAccess(segmented_access Memory, instruct
     return Result;
 }
 
+static u32 GetOperandReadSize(instruction Instruction, u32 OperandIndex)
+{
+    // NOTE: AccessOperand always fetches the operand value up front so the exec switch can use it.
+    // This says how many bytes of it the instruction actually reads, so the memory observer isn't
+    // told about fetches that a real 8086 would never have made.
+    u32 Result = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+    
+    switch(Instruction.Op)
+    {
+        case Op_mov:
+        case Op_pop:
+        {
+            Result = (OperandIndex == 0) ? 0 : Result;
+        } break;
+        
+        case Op_lea:
+        case Op_lds:
+        case Op_les:
+        {
+            // NOTE: LEA never touches memory, and LDS/LES read their source explicitly
+            Result = 0;
+        } break;
+        
+        default:
+        {
+        } break;
+    }
+    
+    return Result;
+}
+
 static operand_access AccessOperand(segmented_access Memory, register_state_8086 *Registers, instruction Instruction, u32 OperandIndex,
                                     u32 *IgnoredBytes)
 {
@@ -284,6 +325,7 @@ static operand_access AccessOperand(segmented_access Memory, register_state_8086
                 u16 SegReg = (Source.Address.Terms[0].Register.Index == Register_bp) ? Registers->ss : Registers->ds;
                 
                 Result.Op.Memory = Memory.Memory;
+                Result.Op.Observer = Memory.Observer;
                 Result.Op.SegmentBase = DetermineSegmentAccess(Memory, Instruction, Registers, SegReg).SegmentBase;
                 for(u32 TermIndex = 0; TermIndex < ArrayCount(Source.Address.Terms); ++TermIndex)
                 {
@@ -293,7 +335,19 @@ static operand_access AccessOperand(segmented_access Memory, register_state_8086
             }
             
             Result.AddressIsUnaligned |= (Result.Op.SegmentOffset & 1);
-            Result.Val = ReadU16(Result.Op, 0);
+            
+            segmented_access Fetch = Result.Op;
+            Fetch.Observer = 0;
+            Result.Val = ReadU16(Fetch, 0);
+            
+            if(Result.Op.Observer)
+            {
+                u32 ReadSize = GetOperandReadSize(Instruction, OperandIndex);
+                for(u32 ByteIndex = 0; ByteIndex < ReadSize; ++ByteIndex)
+                {
+                    ObserveMemoryAccess(Result.Op.Observer, GetAbsoluteAddressOf(Result.Op, ByteIndex), false);
+                }
+            }
         } break;
         
         case Operand_Immediate:
@@ -307,6 +361,8 @@ static operand_access AccessOperand(segmented_access Memory, register_state_8086
 
 static exec_result ExecInstruction(segmented_access Memory, register_state_8086 *Registers, instruction Instruction)
 {
+    TimeFunction;
+    
     exec_result Result = {};
     
     u32 WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
@@ -324,12 +380,18 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
     
     segmented_access DefaultSegment = DetermineSegmentAccess(Memory, Instruction, Registers, Registers->ds);
     
+    Result.MemoryAddress = GetAbsoluteAddressOf(SegmentFromRegister(Memory, Registers->ss), Registers->sp);
+    
     u32 IgnoredBytes = 0;
     operand_access OpAccess[ArrayCount(Instruction.Operands)];
     for(u32 OpIndex = 0; OpIndex < ArrayCount(Instruction.Operands); ++OpIndex)
     {
         OpAccess[OpIndex] = AccessOperand(Memory, Registers, Instruction, OpIndex, &IgnoredBytes);
         Result.AddressIsUnaligned |= OpAccess[OpIndex].AddressIsUnaligned;
+        if(Instruction.Operands[OpIndex].Type == Operand_Memory)
+        {
+            Result.MemoryAddress = GetAbsoluteAddressOf(OpAccess[OpIndex].Op);
+        }
     }
     
     segmented_access Op0 = OpAccess[0].Op;
@@ -366,6 +428,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
             // TODO(casey): The description of XLAT in the manual doesn't say whether it uses the
             // segment override or not. I assume here that it does, but if it doesn't, this should
             // be changed to use Registers->ds instead of SegmentBase.
+            Result.MemoryAddress = GetAbsoluteAddressOf(DefaultSegment, Registers->bx + Registers->al);
             Registers->al = ReadU8(DefaultSegment, Registers->bx + Registers->al);
         } break;
         
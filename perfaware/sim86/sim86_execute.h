@@ -67,6 +67,10 @@ struct exec_result
     b32 BranchTaken;
     b32 AddressIsUnaligned;
     b32 Unimplemented;
+    
+    // NOTE: The absolute address the instruction's bus transfers went to: its memory operand if
+    // it has one, otherwise the top of the stack (the only other place an instruction transfers to)
+    u32 MemoryAddress;
 };
 
 struct operand_access
@@ -14,17 +14,48 @@
 
 #include "sim86.h"
 
+// NOTE: The host profiler prints its results with the CRT, so it is never compiled into the shared library
+#undef PROFILER
+#define PROFILER 0
+#include "sim86_profiler.h"
+
+// NOTE: Leaves out what only the console program uses (placing a memory observer, wait states and DRAM refresh)
+#define SIM86_LIBRARY 1
+
 #include "sim86_instruction.h"
 #include "sim86_instruction_table.h"
 #include "sim86_memory.h"
+#include "sim86_memory_observer.h"
 #include "sim86_decode.h"
+#include "sim86_execute.h"
+#include "sim86_cycles.h"
+#include "sim86_lockstep.h"
+#include "sim86_machine.h"
 
 #include "sim86_instruction.cpp"
 #include "sim86_instruction_table.cpp"
 #include "sim86_memory.cpp"
+#include "sim86_memory_observer.cpp"
 #include "sim86_decode.cpp"
+#include "sim86_execute.cpp"
+#include "sim86_cycles.cpp"
+#include "sim86_lockstep.cpp"
 #include "sim86_text_table.cpp"
 
+static u32 const SIM86_MACHINE_MEMORY_POW2 = 20;
+
+struct sim86_machine
+{
+    register_state_8086 Registers;
+    timing_state Timing;
+    instruction_clock_interval Clocks;
+    
+    u32 ProgramStart;
+    u32 ProgramOnePastLast;
+    
+    u8 Memory[1 << SIM86_MACHINE_MEMORY_POW2];
+};
+
 extern "C" u32 Sim86_GetVersion(void)
 {
     u32 Result = SIM86_VERSION;
@@ -70,4 +101,418 @@ extern "C" char const *Sim86_MnemonicFromOperationType(operation_type Type)
 extern "C" void Sim86_Get8086InstructionTable(instruction_table *Dest)
 {
     *Dest = Get8086InstructionTable();
-}
\ No newline at end of file
+}
+
+static segmented_access GetMainMemory(sim86_machine *Machine)
+{
+    segmented_access Result = FixedMemoryPow2(SIM86_MACHINE_MEMORY_POW2, Machine->Memory);
+    return Result;
+}
+
+static u32 CopyMachineMemory(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Source, b32 ToMachine)
+{
+    // NOTE: Like the decode guard buffer above, this is a manual copy so that the library
+    // can be compiled without the CRT. Copies are clipped to the machine's memory.
+    u32 Result = 0;
+    
+    u32 MemorySize = sizeof(Machine->Memory);
+    if(Address < MemorySize)
+    {
+        Result = MemorySize - Address;
+        if(Result > ByteCount)
+        {
+            Result = ByteCount;
+        }
+        
+        u8 *MachineBytes = Machine->Memory + Address;
+        for(u32 I = 0; I < Result; ++I)
+        {
+            if(ToMachine)
+            {
+                MachineBytes[I] = Source[I];
+            }
+            else
+            {
+                Source[I] = MachineBytes[I];
+            }
+        }
+    }
+    
+    return Result;
+}
+
+extern "C" u32 Sim86_GetMachineFootprint(void)
+{
+    u32 Result = sizeof(sim86_machine);
+    return Result;
+}
+
+extern "C" sim86_machine *Sim86_CreateMachine(u32 FootprintSize, void *Footprint)
+{
+    sim86_machine *Result = 0;
+    
+    if(Footprint && (FootprintSize >= sizeof(sim86_machine)))
+    {
+        Result = (sim86_machine *)Footprint;
+        
+        Result->Registers = {};
+        Result->Timing = {};
+        Result->Clocks = {};
+        Result->ProgramStart = 0;
+        Result->ProgramOnePastLast = 0;
+        
+        u8 *Memory = Result->Memory;
+        for(u32 I = 0; I < sizeof(Result->Memory); ++I)
+        {
+            Memory[I] = 0;
+        }
+    }
+    
+    return Result;
+}
+
+extern "C" u32 Sim86_LoadProgram(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Source)
+{
+    // NOTE: Loading a program also points cs:ip at it, so that a subsequent Sim86_Run starts there.
+    // Execution stops once ip leaves the loaded bytes, the same way the sim86 console program does.
+    u32 Result = CopyMachineMemory(Machine, Address, ByteCount, Source, true);
+    
+    Machine->ProgramStart = Address;
+    Machine->ProgramOnePastLast = Address + Result;
+    Machine->Registers.cs = (u16)(Address >> 4);
+    Machine->Registers.ip = (u16)(Address & 0xf);
+    
+    return Result;
+}
+
+extern "C" u32 Sim86_ReadMemory(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Dest)
+{
+    u32 Result = CopyMachineMemory(Machine, Address, ByteCount, Dest, false);
+    return Result;
+}
+
+extern "C" u32 Sim86_WriteMemory(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Source)
+{
+    u32 Result = CopyMachineMemory(Machine, Address, ByteCount, Source, true);
+    return Result;
+}
+
+extern "C" u16 Sim86_GetRegister(sim86_machine *Machine, register_index Register)
+{
+    // NOTE: Register uses the same numbering as register_access::Index (Register_a = 1 ... Register_flags = 14)
+    u16 Result = 0;
+    if(Register < Register_count)
+    {
+        Result = Machine->Registers.u16[Register];
+    }
+    
+    return Result;
+}
+
+extern "C" void Sim86_SetRegister(sim86_machine *Machine, register_index Register, u16 Value)
+{
+    if((Register > Register_none) && (Register < Register_count))
+    {
+        Machine->Registers.u16[Register] = Value;
+    }
+}
+
+static segmented_access GetInstructionPointer(sim86_machine *Machine, u16 CS, u16 IP)
+{
+    segmented_access Result = GetMainMemory(Machine);
+    Result.Mask = 0xffff;
+    Result.SegmentBase = CS;
+    Result.SegmentOffset = IP;
+    return Result;
+}
+
+static sim86_stop_reason GetStopReason(sim86_machine *Machine, u32 Address, u32 InstructionCount, u32 MaxInstructionCount)
+{
+    sim86_stop_reason Result = Sim86Stop_None;
+    
+    if(InstructionCount >= MaxInstructionCount)
+    {
+        Result = Sim86Stop_InstructionLimit;
+    }
+    else if((Address < Machine->ProgramStart) || (Address >= Machine->ProgramOnePastLast))
+    {
+        Result = Sim86Stop_EndOfProgram;
+    }
+    
+    return Result;
+}
+
+static sim86_stop_reason GetStopReason(instruction Instruction)
+{
+    sim86_stop_reason Result = Sim86Stop_None;
+    
+    if(!Instruction.Op)
+    {
+        Result = Sim86Stop_UnrecognizedInstruction;
+    }
+    else if((Instruction.Op == Op_ret) || (Instruction.Op == Op_retf))
+    {
+        Result = Sim86Stop_Ret;
+    }
+    else if(Instruction.Op == Op_hlt)
+    {
+        Result = Sim86Stop_Hlt;
+    }
+    
+    return Result;
+}
+
+static void AccumulateClocks(sim86_machine *Machine, instruction Instruction, exec_result Exec)
+{
+    UpdateTimingForExec(&Machine->Timing, Exec);
+    instruction_timing Timing = EstimateInstructionClocks(Machine->Timing, Instruction);
+    instruction_clock_interval Clocks = ExpectedClocksFrom(Machine->Timing, Instruction, Timing);
+    Machine->Clocks.Min += Clocks.Min;
+    Machine->Clocks.Max += Clocks.Max;
+}
+
+static b32 ExecMachineInstruction(sim86_machine *Machine, instruction Instruction)
+{
+    register_state_8086 *Registers = &Machine->Registers;
+    register_state_8086 PrevRegisters = *Registers;
+    
+    Registers->ip += Instruction.Size;
+    exec_result Exec = ExecInstruction(GetMainMemory(Machine), Registers, Instruction);
+    
+    b32 Result = !Exec.Unimplemented;
+    if(Result)
+    {
+        AccumulateClocks(Machine, Instruction, Exec);
+    }
+    else
+    {
+        // NOTE: Leave the machine exactly as it was before the instruction, so the caller can inspect it
+        *Registers = PrevRegisters;
+    }
+    
+    return Result;
+}
+
+extern "C" void Sim86_Run(sim86_machine *Machine, u32 MaxInstructionCount, sim86_run_result *Result)
+{
+    instruction_table Table = Get8086InstructionTable();
+    register_state_8086 *Registers = &Machine->Registers;
+    
+    *Result = {};
+    while(!Result->StopReason)
+    {
+        segmented_access At = GetInstructionPointer(Machine, Registers->cs, Registers->ip);
+        
+        u32 Address = GetAbsoluteAddressOf(At);
+        Result->StopAddress = Address;
+        
+        Result->StopReason = GetStopReason(Machine, Address, Result->InstructionCount, MaxInstructionCount);
+        if(!Result->StopReason)
+        {
+            instruction Instruction = DecodeInstruction(Table, At);
+            Result->StopReason = GetStopReason(Instruction);
+            if(!Result->StopReason)
+            {
+                if(ExecMachineInstruction(Machine, Instruction))
+                {
+                    ++Result->InstructionCount;
+                }
+                else
+                {
+                    Result->StopReason = Sim86Stop_Unimplemented;
+                }
+            }
+        }
+    }
+}
+
+static b32 HasSameBytes(sim86_machine *A, sim86_machine *B, u32 Address, u32 ByteCount)
+{
+    b32 Result = true;
+    
+    u32 AddressMask = sizeof(A->Memory) - 1;
+    for(u32 ByteIndex = 0; ByteIndex < ByteCount; ++ByteIndex)
+    {
+        u32 At = (Address + ByteIndex) & AddressMask;
+        Result = Result && (A->Memory[At] == B->Memory[At]);
+    }
+    
+    return Result;
+}
+
+static void RunLockstepGroup(u32 LaneCount, sim86_machine **Machines, u32 MaxInstructionCount, sim86_run_result *Results)
+{
+    /* NOTE: All lanes start together, and every step executes the instruction at the lowest
+       address any running lane is at, on every lane that is at that same address (with the
+       same instruction bytes). Lanes further ahead are masked off and wait, which lets lanes
+       that took a different side of a branch catch up and reconverge at the join point.
+       A lane that has been masked off for too long is split out of the group and
+       finished on its own with Sim86_Run, so one slow lane can't stall the others
+       (or a lane that never reconverges can't stall forever). */
+    
+    assert(LaneCount <= LOCKSTEP_LANE_COUNT);
+    
+    instruction_table Table = Get8086InstructionTable();
+    
+    lockstep_registers Registers;
+    u32 DivergedSteps[LOCKSTEP_LANE_COUNT] = {};
+    u32 Addresses[LOCKSTEP_LANE_COUNT] = {};
+    
+    for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+    {
+        register_state_8086 Unused = {};
+        LoadLockstepLane(&Registers, Lane, (Lane < LaneCount) ? &Machines[Lane]->Registers : &Unused);
+    }
+    
+    u32 SplitMask = 0;
+    u32 RunningMask = 0;
+    for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+    {
+        Results[Lane] = {};
+        RunningMask |= (1 << Lane);
+    }
+    
+    u16 *CS = Registers.Lanes[Register_cs];
+    u16 *IP = Registers.Lanes[Register_ip];
+    
+    while(RunningMask)
+    {
+        u32 Leader = LOCKSTEP_LANE_COUNT;
+        for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+        {
+            if(RunningMask & (1 << Lane))
+            {
+                sim86_machine *Machine = Machines[Lane];
+                sim86_run_result *Result = Results + Lane;
+                
+                Addresses[Lane] = GetAbsoluteAddressOf(GetInstructionPointer(Machine, CS[Lane], IP[Lane]));
+                Result->StopAddress = Addresses[Lane];
+                Result->StopReason = GetStopReason(Machine, Addresses[Lane], Result->InstructionCount, MaxInstructionCount);
+                if(Result->StopReason)
+                {
+                    RunningMask &= ~(1 << Lane);
+                }
+                else if((Leader == LOCKSTEP_LANE_COUNT) || (Addresses[Lane] < Addresses[Leader]))
+                {
+                    Leader = Lane;
+                }
+            }
+        }
+        
+        if(RunningMask)
+        {
+            sim86_machine *LeaderMachine = Machines[Leader];
+            instruction Instruction = DecodeInstruction(Table, GetInstructionPointer(LeaderMachine, CS[Leader], IP[Leader]));
+            u32 InstructionAddress = Addresses[Leader];
+            
+            u32 ExecMask = 0;
+            for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+            {
+                if(RunningMask & (1 << Lane))
+                {
+                    if((Addresses[Lane] == InstructionAddress) &&
+                       HasSameBytes(LeaderMachine, Machines[Lane], InstructionAddress, Instruction.Size))
+                    {
+                        ExecMask |= (1 << Lane);
+                        DivergedSteps[Lane] = 0;
+                    }
+                    else if(++DivergedSteps[Lane] > LOCKSTEP_MAX_DIVERGED_STEPS)
+                    {
+                        sim86_machine *Machine = Machines[Lane];
+                        sim86_run_result *Result = Results + Lane;
+                        
+                        StoreLockstepLane(&Registers, Lane, &Machine->Registers);
+                        RunningMask &= ~(1 << Lane);
+                        SplitMask |= (1 << Lane);
+                        
+                        sim86_run_result Rest;
+                        Sim86_Run(Machine, MaxInstructionCount - Result->InstructionCount, &Rest);
+                        Result->InstructionCount += Rest.InstructionCount;
+                        Result->StopReason = Rest.StopReason;
+                        Result->StopAddress = Rest.StopAddress;
+                    }
+                }
+            }
+            
+            sim86_stop_reason StopReason = GetStopReason(Instruction);
+            if(StopReason)
+            {
+                for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+                {
+                    if(ExecMask & (1 << Lane))
+                    {
+                        Results[Lane].StopReason = StopReason;
+                    }
+                }
+                
+                RunningMask &= ~ExecMask;
+            }
+            else if(IsLockstepInstruction(Instruction))
+            {
+                ExecLockstepInstruction(&Registers, ExecMask, Instruction);
+                
+                // NOTE: Lockstep instructions never branch, shift, repeat, or touch memory, so the
+                // clocks only depend on whether the machine is an 8088
+                exec_result NoExec = {};
+                for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+                {
+                    if(ExecMask & (1 << Lane))
+                    {
+                        AccumulateClocks(Machines[Lane], Instruction, NoExec);
+                        ++Results[Lane].InstructionCount;
+                    }
+                }
+            }
+            else
+            {
+                for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+                {
+                    if(ExecMask & (1 << Lane))
+                    {
+                        sim86_machine *Machine = Machines[Lane];
+                        
+                        StoreLockstepLane(&Registers, Lane, &Machine->Registers);
+                        if(ExecMachineInstruction(Machine, Instruction))
+                        {
+                            ++Results[Lane].InstructionCount;
+                        }
+                        else
+                        {
+                            Results[Lane].StopReason = Sim86Stop_Unimplemented;
+                            RunningMask &= ~(1 << Lane);
+                        }
+                        LoadLockstepLane(&Registers, Lane, &Machine->Registers);
+                    }
+                }
+            }
+        }
+    }
+    
+    for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+    {
+        if(!(SplitMask & (1 << Lane)))
+        {
+            StoreLockstepLane(&Registers, Lane, &Machines[Lane]->Registers);
+        }
+    }
+}
+
+extern "C" void Sim86_RunLockstep(u32 MachineCount, sim86_machine **Machines, u32 MaxInstructionCount, sim86_run_result *Results)
+{
+    for(u32 FirstMachine = 0; FirstMachine < MachineCount; FirstMachine += LOCKSTEP_LANE_COUNT)
+    {
+        u32 LaneCount = MachineCount - FirstMachine;
+        if(LaneCount > LOCKSTEP_LANE_COUNT)
+        {
+            LaneCount = LOCKSTEP_LANE_COUNT;
+        }
+        
+        RunLockstepGroup(LaneCount, Machines + FirstMachine, MaxInstructionCount, Results + FirstMachine);
+    }
+}
+
+extern "C" void Sim86_GetEstimatedClocks(sim86_machine *Machine, u32 *MinClocks, u32 *MaxClocks)
+{
+    *MinClocks = Machine->Clocks.Min;
+    *MaxClocks = Machine->Clocks.Max;
+}
@@ -13,6 +13,7 @@
 #include "sim86.h"
 #include "sim86_instruction.h"
 #include "sim86_instruction_table.h"
+#include "sim86_machine.h"
 
 // NOTE(casey): This ridiculousness is just here so that we can preprocess these files
 // and still have #ifdef's in the resulting file to support compilation via C-like
@@ -30,6 +31,17 @@ void Sim86_Decode8086Instruction(u32 SourceSize, u8 *Source, instruction *Dest);
 char const *Sim86_RegisterNameFromOperand(register_access *RegAccess);
 char const *Sim86_MnemonicFromOperationType(operation_type Type);
 void Sim86_Get8086InstructionTable(instruction_table *Dest);
+
+u32 Sim86_GetMachineFootprint(void);
+sim86_machine *Sim86_CreateMachine(u32 FootprintSize, void *Footprint);
+u32 Sim86_LoadProgram(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Source);
+u32 Sim86_ReadMemory(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Dest);
+u32 Sim86_WriteMemory(sim86_machine *Machine, u32 Address, u32 ByteCount, u8 *Source);
+u16 Sim86_GetRegister(sim86_machine *Machine, register_index Register);
+void Sim86_SetRegister(sim86_machine *Machine, register_index Register, u16 Value);
+void Sim86_Run(sim86_machine *Machine, u32 MaxInstructionCount, sim86_run_result *Result);
+void Sim86_RunLockstep(u32 MachineCount, sim86_machine **Machines, u32 MaxInstructionCount, sim86_run_result *Results);
+void Sim86_GetEstimatedClocks(sim86_machine *Machine, u32 *MinClocks, u32 *MaxClocks);
 ifdefcpp
 closebrace
 endif
@@ -0,0 +1,371 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* NOTE: Lockstep execution applies one decoded instruction to many register files at once.
+   The loops in this file always run over every lane and blend the results in with a
+   select mask at the end, rather than branching per lane, so that the compiler can turn
+   each one into straight-line vector code. With 16 lanes of u16 registers, that is one
+   AVX2 register per machine register (or one AVX-512 register once widened to u32).
+   
+   The results must match ExecInstruction exactly, so the flag computations below
+   deliberately mirror the ones in sim86_execute.cpp, quirks and all. */
+
+static void LoadLockstepLane(lockstep_registers *Registers, u32 Lane, register_state_8086 *Source)
+{
+    for(u32 RegIndex = 0; RegIndex < Register_count; ++RegIndex)
+    {
+        Registers->Lanes[RegIndex][Lane] = Source->u16[RegIndex];
+    }
+}
+
+static void StoreLockstepLane(lockstep_registers *Registers, u32 Lane, register_state_8086 *Dest)
+{
+    for(u32 RegIndex = 0; RegIndex < Register_count; ++RegIndex)
+    {
+        Dest->u16[RegIndex] = Registers->Lanes[RegIndex][Lane];
+    }
+}
+
+static b32 IsLockstepOperand(instruction_operand Operand, u32 WWidth)
+{
+    b32 Result = ((Operand.Type == Operand_None) ||
+                  (Operand.Type == Operand_Immediate) ||
+                  ((Operand.Type == Operand_Register) && (Operand.Register.Count == WWidth)));
+    return Result;
+}
+
+static b32 IsLockstepInstruction(instruction Instruction)
+{
+    // NOTE: Only instructions that work purely on registers and immediates, and never change ip
+    // other than stepping over themselves, are run in lockstep. Anything that touches memory
+    // (which is separate for each machine) or branches is executed one lane at a time.
+    b32 Result = false;
+    
+    switch(Instruction.Op)
+    {
+        case Op_mov:
+        case Op_add:
+        case Op_sub:
+        case Op_cmp:
+        case Op_inc:
+        case Op_dec:
+        case Op_neg:
+        case Op_not:
+        case Op_and:
+        case Op_or:
+        case Op_xor:
+        case Op_test:
+        case Op_cbw:
+        case Op_cwd:
+        case Op_lahf:
+        case Op_sahf:
+        case Op_clc:
+        case Op_cmc:
+        case Op_stc:
+        case Op_cld:
+        case Op_std:
+        case Op_cli:
+        case Op_sti:
+        {
+            Result = true;
+        } break;
+        
+        default:
+        {
+        } break;
+    }
+    
+    u32 WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+    for(u32 OpIndex = 0; OpIndex < ArrayCount(Instruction.Operands); ++OpIndex)
+    {
+        Result = Result && IsLockstepOperand(Instruction.Operands[OpIndex], WWidth);
+    }
+    
+    return Result;
+}
+
+static u16 SelectLane(u32 Select, u32 New, u32 Old)
+{
+    u16 Result = (u16)((New & Select) | (Old & ~Select));
+    return Result;
+}
+
+static u32 LockstepCommonFlags(u32 Flags, u32 MaskedResult, u32 SignBit)
+{
+    Flags &= ~(Flag_SF | Flag_ZF | Flag_PF);
+    Flags |= (MaskedResult & SignBit) ? Flag_SF : 0;
+    Flags |= (MaskedResult == 0) ? Flag_ZF : 0;
+    Flags |= ParityFlagOf((u16)MaskedResult);
+    return Flags;
+}
+
+static u32 LockstepArithFlags(u32 Flags, u32 UnmaskedResult, u32 MaskedResult, u32 SignBit, u32 OF, u32 AF)
+{
+    Flags &= ~(Flag_OF | Flag_CF | Flag_AF);
+    Flags |= (UnmaskedResult & (SignBit << 1)) ? Flag_CF : 0;
+    Flags |= OF ? Flag_OF : 0;
+    Flags |= AF ? Flag_AF : 0;
+    
+    u32 Result = LockstepCommonFlags(Flags, MaskedResult, SignBit);
+    return Result;
+}
+
+static u32 LockstepLogFlags(u32 Flags, u32 MaskedResult, u32 SignBit)
+{
+    Flags &= ~(Flag_OF | Flag_CF | Flag_AF);
+    
+    u32 Result = LockstepCommonFlags(Flags, MaskedResult, SignBit);
+    return Result;
+}
+
+static void LoadLockstepOperand(lockstep_registers *Registers, instruction_operand Operand, u32 *Values)
+{
+    switch(Operand.Type)
+    {
+        case Operand_Register:
+        {
+            u16 *Reg = Registers->Lanes[Operand.Register.Index % Register_count];
+            u32 Shift = 8*Operand.Register.Offset;
+            u32 Mask = (Operand.Register.Count == 2) ? 0xffff : 0xff;
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                Values[Lane] = (Reg[Lane] >> Shift) & Mask;
+            }
+        } break;
+        
+        case Operand_Immediate:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                Values[Lane] = (u32)Operand.Immediate.Value;
+            }
+        } break;
+        
+        default:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                Values[Lane] = 0;
+            }
+        } break;
+    }
+}
+
+static void StoreLockstepOperand(lockstep_registers *Registers, instruction_operand Operand, u32 *Select, u32 *Values)
+{
+    if(Operand.Type == Operand_Register)
+    {
+        u16 *Reg = Registers->Lanes[Operand.Register.Index % Register_count];
+        u32 Shift = 8*Operand.Register.Offset;
+        u32 Mask = ((Operand.Register.Count == 2) ? 0xffff : 0xff) << Shift;
+        for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+        {
+            u32 New = (Reg[Lane] & ~Mask) | ((Values[Lane] << Shift) & Mask);
+            Reg[Lane] = SelectLane(Select[Lane], New, Reg[Lane]);
+        }
+    }
+}
+
+static void ExecLockstepInstruction(lockstep_registers *Registers, u32 LaneMask, instruction Instruction)
+{
+    assert(IsLockstepInstruction(Instruction));
+    
+    u32 WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+    u32 SignBit = SignBitFor(WWidth);
+    u32 WidthMask = WidthMaskFor(WWidth);
+    
+    u32 Select[LOCKSTEP_LANE_COUNT];
+    for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+    {
+        Select[Lane] = 0 - ((LaneMask >> Lane) & 1);
+    }
+    
+    u32 V0[LOCKSTEP_LANE_COUNT];
+    u32 V1[LOCKSTEP_LANE_COUNT];
+    LoadLockstepOperand(Registers, Instruction.Operands[0], V0);
+    LoadLockstepOperand(Registers, Instruction.Operands[1], V1);
+    
+    u16 *A = Registers->Lanes[Register_a];
+    u16 *D = Registers->Lanes[Register_d];
+    u16 *Flags = Registers->Lanes[Register_flags];
+    
+    u32 R[LOCKSTEP_LANE_COUNT];
+    u32 NewFlags[LOCKSTEP_LANE_COUNT];
+    for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+    {
+        R[Lane] = 0;
+        NewFlags[Lane] = Flags[Lane];
+    }
+    
+    b32 WriteBack = false;
+    switch(Instruction.Op)
+    {
+        case Op_mov:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                R[Lane] = V1[Lane];
+            }
+            WriteBack = true;
+        } break;
+        
+        case Op_add:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                u32 Sum = (V0[Lane] & WidthMask) + (V1[Lane] & WidthMask);
+                u32 OF = (~(V0[Lane] ^ V1[Lane]) & (V0[Lane] ^ Sum)) & SignBit;
+                u32 AF = ((V0[Lane] & 0xf) + (V1[Lane] & 0xf)) & 0x10;
+                NewFlags[Lane] = LockstepArithFlags(NewFlags[Lane], Sum, Sum & WidthMask, SignBit, OF, AF);
+                R[Lane] = Sum & WidthMask;
+            }
+            WriteBack = true;
+        } break;
+        
+        case Op_sub:
+        case Op_cmp:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                u32 Diff = (V0[Lane] & WidthMask) - (V1[Lane] & WidthMask);
+                u32 OF = ((V0[Lane] ^ V1[Lane]) & (V0[Lane] ^ Diff)) & SignBit;
+                u32 AF = ((V0[Lane] & 0xf) - (V1[Lane] & 0xf)) & 0x10;
+                NewFlags[Lane] = LockstepArithFlags(NewFlags[Lane], Diff, Diff & WidthMask, SignBit, OF, AF);
+                R[Lane] = Diff & WidthMask;
+            }
+            WriteBack = (Instruction.Op == Op_sub);
+        } break;
+        
+        case Op_inc:
+        case Op_dec:
+        case Op_neg:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                u32 Unmasked = ((Instruction.Op == Op_inc) ? (V0[Lane] + 1) :
+                                (Instruction.Op == Op_dec) ? (V0[Lane] - 1) :
+                                (0 - V0[Lane]));
+                NewFlags[Lane] = LockstepArithFlags(NewFlags[Lane], Unmasked, Unmasked & WidthMask, SignBit, 0, 0);
+                R[Lane] = Unmasked & WidthMask;
+            }
+            WriteBack = true;
+        } break;
+        
+        case Op_not:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                R[Lane] = ~V0[Lane];
+            }
+            WriteBack = true;
+        } break;
+        
+        case Op_and:
+        case Op_or:
+        case Op_xor:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                u32 Unmasked = ((Instruction.Op == Op_and) ? (V0[Lane] & V1[Lane]) :
+                                (Instruction.Op == Op_or) ? (V0[Lane] | V1[Lane]) :
+                                (V0[Lane] ^ V1[Lane]));
+                R[Lane] = Unmasked & WidthMask;
+                NewFlags[Lane] = LockstepLogFlags(NewFlags[Lane], R[Lane], SignBit);
+            }
+            WriteBack = true;
+        } break;
+        
+        case Op_test:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                // NOTE: Like ExecInstruction, TEST does not mask its result to the operand width
+                NewFlags[Lane] = LockstepLogFlags(NewFlags[Lane], (u16)(V0[Lane] & V1[Lane]), SignBit);
+            }
+        } break;
+        
+        case Op_cbw:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                u32 New = (A[Lane] & 0xff) | ((A[Lane] & 0x80) ? 0xff00 : 0);
+                A[Lane] = SelectLane(Select[Lane], New, A[Lane]);
+            }
+        } break;
+        
+        case Op_cwd:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                u32 New = (A[Lane] & 0x8000) ? 0xffff : 0;
+                D[Lane] = SelectLane(Select[Lane], New, D[Lane]);
+            }
+        } break;
+        
+        case Op_lahf:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                u32 New = (A[Lane] & 0xff) | ((Flags[Lane] & FLAG_MASK_OLD_8080) << 8);
+                A[Lane] = SelectLane(Select[Lane], New, A[Lane]);
+            }
+        } break;
+        
+        case Op_sahf:
+        {
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                NewFlags[Lane] = (NewFlags[Lane] & FLAG_MASK_OLD_8080) | ((A[Lane] >> 8) & FLAG_MASK_OLD_8080);
+            }
+        } break;
+        
+        case Op_clc:
+        case Op_cmc:
+        case Op_stc:
+        case Op_cld:
+        case Op_std:
+        case Op_cli:
+        case Op_sti:
+        {
+            u32 Bit = (((Instruction.Op == Op_clc) || (Instruction.Op == Op_cmc) || (Instruction.Op == Op_stc)) ? Flag_CF :
+                       ((Instruction.Op == Op_cld) || (Instruction.Op == Op_std)) ? Flag_DF :
+                       Flag_IF);
+            u32 Set = ((Instruction.Op == Op_stc) || (Instruction.Op == Op_std) || (Instruction.Op == Op_sti)) ? Bit : 0;
+            u32 Toggle = (Instruction.Op == Op_cmc) ? Bit : 0;
+            u32 Clear = (Set || Toggle) ? 0 : Bit;
+            for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+            {
+                NewFlags[Lane] = ((NewFlags[Lane] & ~Clear) | Set) ^ Toggle;
+            }
+        } break;
+        
+        default:
+        {
+        } break;
+    }
+    
+    for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+    {
+        Flags[Lane] = SelectLane(Select[Lane], NewFlags[Lane], Flags[Lane]);
+    }
+    
+    if(WriteBack)
+    {
+        StoreLockstepOperand(Registers, Instruction.Operands[0], Select, R);
+    }
+    
+    u16 *IP = Registers->Lanes[Register_ip];
+    for(u32 Lane = 0; Lane < LOCKSTEP_LANE_COUNT; ++Lane)
+    {
+        IP[Lane] = SelectLane(Select[Lane], IP[Lane] + Instruction.Size, IP[Lane]);
+    }
+}
@@ -0,0 +1,30 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+#define LOCKSTEP_LANE_COUNT 16
+
+// NOTE: How many consecutive steps a lane can sit masked off before it is split out to run on its own
+#define LOCKSTEP_MAX_DIVERGED_STEPS 64
+
+struct lockstep_registers
+{
+    // NOTE: The register files of LOCKSTEP_LANE_COUNT machines, stored structure-of-arrays,
+    // so the same register of every lane is contiguous and one instruction can be applied
+    // to all lanes with wide loads and stores.
+    u16 Lanes[Register_count][LOCKSTEP_LANE_COUNT];
+};
+
+static void LoadLockstepLane(lockstep_registers *Registers, u32 Lane, register_state_8086 *Source);
+static void StoreLockstepLane(lockstep_registers *Registers, u32 Lane, register_state_8086 *Dest);
+
+static b32 IsLockstepInstruction(instruction Instruction);
+static void ExecLockstepInstruction(lockstep_registers *Registers, u32 LaneMask, instruction Instruction);
@@ -0,0 +1,36 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+// NOTE: A machine is an opaque handle. The library never allocates, so callers
+// get the number of bytes a machine needs from Sim86_GetMachineFootprint and
+// pass that storage to Sim86_CreateMachine. Freeing the storage frees the machine.
+typedef struct sim86_machine sim86_machine;
+
+typedef enum sim86_stop_reason : u32
+{
+    Sim86Stop_None,
+    
+    Sim86Stop_InstructionLimit,
+    Sim86Stop_Ret,
+    Sim86Stop_Hlt,
+    Sim86Stop_EndOfProgram, // NOTE: ip left the range of bytes given to Sim86_LoadProgram
+    Sim86Stop_Unimplemented,
+    Sim86Stop_UnrecognizedInstruction,
+} sim86_stop_reason;
+
+typedef struct sim86_run_result sim86_run_result;
+struct sim86_run_result
+{
+    u32 InstructionCount;
+    sim86_stop_reason StopReason;
+    u32 StopAddress;
+};
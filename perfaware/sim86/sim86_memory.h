@@ -10,12 +10,17 @@
    
    ======================================================================== */
 
+struct memory_observer;
+
 struct segmented_access
 {
     u8 *Memory;
     u32 Mask;
     u16 SegmentBase;
     u16 SegmentOffset;
+    
+    // NOTE: Only set on accesses into main memory. Register and decode accesses leave this null.
+    memory_observer *Observer;
 };
 
 static u32 GetHighestAddress(segmented_access SegMem);
@@ -0,0 +1,198 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+#if !SIM86_LIBRARY
+static b32 IsPow2(u32 Value)
+{
+    b32 Result = (Value && ((Value & (Value - 1)) == 0));
+    return Result;
+}
+
+static u32 Log2Pow2(u32 Value)
+{
+    u32 Result = 0;
+    while((1u << Result) < Value)
+    {
+        ++Result;
+    }
+    
+    return Result;
+}
+
+static b32 IsValid(memory_observer_config Config)
+{
+    b32 Result = IsPow2(Config.LineSize);
+    if(Config.CacheSize)
+    {
+        Result = (Result &&
+                  IsPow2(Config.CacheSize) &&
+                  IsPow2(Config.CacheWayCount) &&
+                  (Config.CacheSize >= (Config.LineSize*Config.CacheWayCount)));
+    }
+    
+    return Result;
+}
+
+static u32 GetMemoryObserverLineCount(u32 AddressSpaceSizePow2, memory_observer_config Config)
+{
+    u32 Result = (1 << AddressSpaceSizePow2) >> Log2Pow2(Config.LineSize);
+    return Result;
+}
+
+static u32 GetMemoryObserverCacheSetCount(memory_observer_config Config)
+{
+    u32 Result = 0;
+    if(Config.CacheSize)
+    {
+        Result = Config.CacheSize / (Config.LineSize*Config.CacheWayCount);
+    }
+    
+    return Result;
+}
+
+static u32 GetMemoryObserverFootprint(u32 AddressSpaceSizePow2, memory_observer_config Config)
+{
+    u32 Result = 0;
+    if(IsValid(Config))
+    {
+        Result = (sizeof(memory_observer) +
+                  GetMemoryObserverLineCount(AddressSpaceSizePow2, Config)*sizeof(memory_line_counts) +
+                  GetMemoryObserverCacheSetCount(Config)*Config.CacheWayCount*sizeof(cache_way));
+    }
+    
+    return Result;
+}
+
+static memory_observer *PlaceMemoryObserver(u32 AddressSpaceSizePow2, memory_observer_config Config, u32 FootprintSize, void *Footprint)
+{
+    // NOTE: The footprint is supplied by the caller (see GetMemoryObserverFootprint) so that this
+    // file doesn't need the CRT, and can be compiled into sim86_lib without it.
+    memory_observer *Result = 0;
+    
+    u32 RequiredSize = GetMemoryObserverFootprint(AddressSpaceSizePow2, Config);
+    if(RequiredSize && (FootprintSize >= RequiredSize))
+    {
+        u8 *At = (u8 *)Footprint;
+        
+        Result = (memory_observer *)At;
+        At += sizeof(memory_observer);
+        
+        Result->AddressMask = (1 << AddressSpaceSizePow2) - 1;
+        Result->LineShift = Log2Pow2(Config.LineSize);
+        Result->LineCount = GetMemoryObserverLineCount(AddressSpaceSizePow2, Config);
+        Result->Lines = (memory_line_counts *)At;
+        At += Result->LineCount*sizeof(memory_line_counts);
+        
+        Result->CacheSetCount = GetMemoryObserverCacheSetCount(Config);
+        if(Result->CacheSetCount)
+        {
+            Result->CacheWayCount = Config.CacheWayCount;
+            Result->CacheWays = (cache_way *)At;
+        }
+        else
+        {
+            Result->CacheWayCount = 0;
+            Result->CacheWays = 0;
+        }
+        
+        ResetMemoryObserver(Result);
+    }
+    
+    return Result;
+}
+
+static void ResetMemoryObserver(memory_observer *Observer)
+{
+    for(u32 LineIndex = 0; LineIndex < Observer->LineCount; ++LineIndex)
+    {
+        Observer->Lines[LineIndex] = {};
+    }
+    
+    for(u32 WayIndex = 0; WayIndex < (Observer->CacheSetCount*Observer->CacheWayCount); ++WayIndex)
+    {
+        Observer->CacheWays[WayIndex] = {};
+    }
+    
+    Observer->ReadCount = 0;
+    Observer->WriteCount = 0;
+    Observer->CacheUseClock = 0;
+    Observer->CacheHits = 0;
+    Observer->CacheMisses = 0;
+}
+#endif
+
+static void SimulateCacheAccess(memory_observer *Observer, u32 LineIndex)
+{
+    u32 SetIndex = LineIndex & (Observer->CacheSetCount - 1);
+    cache_way *Set = Observer->CacheWays + SetIndex*Observer->CacheWayCount;
+    
+    u64 UseClock = ++Observer->CacheUseClock;
+    
+    cache_way *Victim = Set;
+    for(u32 WayIndex = 0; WayIndex < Observer->CacheWayCount; ++WayIndex)
+    {
+        cache_way *Way = Set + WayIndex;
+        if(Way->Valid && (Way->LineIndex == LineIndex))
+        {
+            ++Observer->CacheHits;
+            Way->LastUsed = UseClock;
+            return;
+        }
+        
+        // NOTE: Empty ways have a LastUsed of zero, so they are always picked before evicting anything
+        if(Way->LastUsed < Victim->LastUsed)
+        {
+            Victim = Way;
+        }
+    }
+    
+    ++Observer->CacheMisses;
+    Victim->LineIndex = LineIndex;
+    Victim->Valid = true;
+    Victim->LastUsed = UseClock;
+}
+
+static void ObserveMemoryAccess(memory_observer *Observer, u32 AbsoluteAddress, b32 IsWrite)
+{
+    /* NOTE: Execution reads and writes memory one byte at a time, so a 16-bit
+       transfer is observed as two accesses. For the cache model this means the
+       second byte of an aligned word is always a hit, and the second byte of a
+       word that straddles a line boundary is charged to the next line, which is
+       what a byte-addressed cache would actually see. */
+    
+    u32 LineIndex = (AbsoluteAddress & Observer->AddressMask) >> Observer->LineShift;
+    memory_line_counts *Line = Observer->Lines + LineIndex;
+    
+    if(IsWrite)
+    {
+        ++Line->WriteCount;
+        ++Observer->WriteCount;
+    }
+    else
+    {
+        ++Line->ReadCount;
+        ++Observer->ReadCount;
+    }
+    
+    if(Observer->CacheWays)
+    {
+        SimulateCacheAccess(Observer, LineIndex);
+    }
+}
+
+#if !SIM86_LIBRARY
+static u32 GetAccessCount(memory_line_counts Line)
+{
+    u32 Result = Line.ReadCount + Line.WriteCount;
+    return Result;
+}
+#endif
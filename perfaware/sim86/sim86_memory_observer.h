@@ -0,0 +1,63 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+struct memory_observer_config
+{
+    u32 LineSize; // NOTE: Must be a power of two (16 and 64 are the usual choices)
+    
+    // NOTE: If CacheSize is zero, no cache is simulated, and only the per-line counts are recorded
+    u32 CacheSize;
+    u32 CacheWayCount;
+};
+
+struct memory_line_counts
+{
+    u32 ReadCount;
+    u32 WriteCount;
+};
+
+struct cache_way
+{
+    u32 LineIndex;
+    u32 Valid;
+    u64 LastUsed;
+};
+
+struct memory_observer
+{
+    u32 AddressMask;
+    u32 LineShift;
+    u32 LineCount;
+    memory_line_counts *Lines;
+    
+    u64 ReadCount;
+    u64 WriteCount;
+    
+    u32 CacheSetCount;
+    u32 CacheWayCount;
+    cache_way *CacheWays;
+    u64 CacheUseClock;
+    u64 CacheHits;
+    u64 CacheMisses;
+};
+
+#if !SIM86_LIBRARY
+static b32 IsValid(memory_observer_config Config);
+static u32 GetMemoryObserverFootprint(u32 AddressSpaceSizePow2, memory_observer_config Config);
+static memory_observer *PlaceMemoryObserver(u32 AddressSpaceSizePow2, memory_observer_config Config, u32 FootprintSize, void *Footprint);
+static void ResetMemoryObserver(memory_observer *Observer);
+#endif
+
+static void ObserveMemoryAccess(memory_observer *Observer, u32 AbsoluteAddress, b32 IsWrite);
+#if !SIM86_LIBRARY
+static u32 GetAccessCount(memory_line_counts Line);
+#endif
@@ -0,0 +1,33 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* NOTE: Host-side profiling of sim86 itself (how long decoding, execution,
+   clock estimation, and printing take on the machine running the simulator).
+   This is the bandwidth profiler from part 3 of the course. Compile with
+   -DPROFILER=1 to turn it on. Otherwise, the anchors compile to nothing. */
+
+#ifndef PROFILER
+#define PROFILER 0
+#endif
+
+#if PROFILER
+
+#include "../part3/listing_0100_bandwidth_profiler.cpp"
+
+#else
+
+#define TimeBandwidth(...)
+#define TimeBlock(...)
+#define TimeFunction
+#define ProfilerEndOfCompilationUnit
+
+#endif
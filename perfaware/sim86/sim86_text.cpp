@@ -42,6 +42,8 @@ static void PrintEffectiveAddressExpression(effective_address_expression Address
 
 static void PrintInstruction(instruction Instruction, FILE *Dest)
 {
+    TimeFunction;
+    
     u32 Flags = Instruction.Flags;
     u32 W = Flags & Inst_Wide;
     
@@ -234,3 +236,101 @@ static void ExplainTiming(instruction_timing Timing, instruction_clock_interval
         fprintf(Dest, ")");
     }
 }
+
+static void PrintHardwareClockLoss(hardware_clock_loss Loss, FILE *Dest)
+{
+    fprintf(Dest, "Clocks lost to DRAM refresh: ");
+    PrintClockInterval(Loss.Refresh, Dest);
+    fprintf(Dest, "\n");
+    
+    fprintf(Dest, "Clocks lost to wait states: ");
+    PrintClockInterval(Loss.WaitStates, Dest);
+    fprintf(Dest, "\n");
+}
+
+static u32 const HEATMAP_PAGE_SIZE_POW2 = 12;
+static u32 const HOTTEST_LINE_COUNT = 16;
+
+static void PrintMemoryObserverReport(memory_observer *Observer, FILE *Dest)
+{
+    u32 LineSize = (1 << Observer->LineShift);
+    
+    fprintf(Dest, "Memory accesses: %llu reads, %llu writes (%u-byte lines)\n",
+            Observer->ReadCount, Observer->WriteCount, LineSize);
+    
+    if(Observer->CacheWays)
+    {
+        u64 Total = Observer->CacheHits + Observer->CacheMisses;
+        double HitRate = Total ? (100.0 * (double)Observer->CacheHits / (double)Total) : 0.0;
+        fprintf(Dest, "Cache (%u bytes, %u-way, %u sets): %llu hits, %llu misses (%.2f%% hit rate)\n",
+                Observer->CacheSetCount*Observer->CacheWayCount*LineSize, Observer->CacheWayCount, Observer->CacheSetCount,
+                Observer->CacheHits, Observer->CacheMisses, HitRate);
+    }
+    
+    // NOTE: Insertion into a small fixed array is plenty here, since HOTTEST_LINE_COUNT is tiny compared to LineCount
+    u32 Hottest[HOTTEST_LINE_COUNT];
+    u32 HottestCount = 0;
+    for(u32 LineIndex = 0; LineIndex < Observer->LineCount; ++LineIndex)
+    {
+        u32 Count = GetAccessCount(Observer->Lines[LineIndex]);
+        if(Count)
+        {
+            u32 Slot = HottestCount;
+            while(Slot && (GetAccessCount(Observer->Lines[Hottest[Slot - 1]]) < Count))
+            {
+                if(Slot < HOTTEST_LINE_COUNT)
+                {
+                    Hottest[Slot] = Hottest[Slot - 1];
+                }
+                --Slot;
+            }
+            
+            if(Slot < HOTTEST_LINE_COUNT)
+            {
+                Hottest[Slot] = LineIndex;
+                if(HottestCount < HOTTEST_LINE_COUNT)
+                {
+                    ++HottestCount;
+                }
+            }
+        }
+    }
+    
+    if(HottestCount)
+    {
+        fprintf(Dest, "Hottest lines:\n");
+        for(u32 HotIndex = 0; HotIndex < HottestCount; ++HotIndex)
+        {
+            u32 LineIndex = Hottest[HotIndex];
+            memory_line_counts Line = Observer->Lines[LineIndex];
+            fprintf(Dest, "  0x%05x: %u reads, %u writes\n", LineIndex << Observer->LineShift, Line.ReadCount, Line.WriteCount);
+        }
+    }
+}
+
+static void WriteMemoryHeatmap(memory_observer *Observer, FILE *Dest)
+{
+    u32 LinesPerPage = 1;
+    if(HEATMAP_PAGE_SIZE_POW2 > Observer->LineShift)
+    {
+        LinesPerPage = (1 << (HEATMAP_PAGE_SIZE_POW2 - Observer->LineShift));
+    }
+    
+    fprintf(Dest, "Page,Address,Reads,Writes,TouchedLines\n");
+    for(u32 FirstLine = 0; FirstLine < Observer->LineCount; FirstLine += LinesPerPage)
+    {
+        u64 Reads = 0;
+        u64 Writes = 0;
+        u32 TouchedLines = 0;
+        for(u32 LineIndex = FirstLine; LineIndex < (FirstLine + LinesPerPage); ++LineIndex)
+        {
+            memory_line_counts Line = Observer->Lines[LineIndex];
+            Reads += Line.ReadCount;
+            Writes += Line.WriteCount;
+            TouchedLines += (GetAccessCount(Line) != 0);
+        }
+        
+        fprintf(Dest, "%u,0x%05x,%llu,%llu,%u\n", FirstLine / LinesPerPage, FirstLine << Observer->LineShift,
+                Reads, Writes, TouchedLines);
+    }
+}
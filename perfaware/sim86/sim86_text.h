@@ -11,3 +11,6 @@
    ======================================================================== */
 
 static void PrintInstruction(instruction Instruction, FILE *Dest);
+static void PrintHardwareClockLoss(hardware_clock_loss Loss, FILE *Dest);
+static void PrintMemoryObserverReport(memory_observer *Observer, FILE *Dest);
+static void WriteMemoryHeatmap(memory_observer *Observer, FILE *Dest);